@@ -0,0 +1,501 @@
+#include "hpp/autotune.h"
+#include "hpp/batched.h"
+#include "hpp/bench.h"
+#include "hpp/matmul.h"
+#include "hpp/matrix.h"
+#include "hpp/perf_counters.h"
+#include "hpp/roofline.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Command-line benchmark for the matmul kernels.
+//
+//   matmul_bench --shapes 256,512x128x64 --types int8,float
+//                --impls vector,blocked --threads 1,4 --format csv
+//
+// Shapes are MxNxK (C is M x N, A is M x K) or a single size for square.
+// --tune searches the kernel parameters for every type, shape and
+// implementation instead, and saves the winners to the tuning cache that
+// matmul() loads on startup.
+// Builds with MATMUL_ENABLE_PERF_COUNTERS also print per-kernel and per-phase
+// hardware counters (IPC, cycles/FLOP, bandwidth) after the results; with
+// CSV or JSON output they go to stderr. --impls auto runs MatMulImpl::AUTO;
+// set MATMUL_LOG_DISPATCH=1 to see what it picked.
+// With the ceilings saved by matmul_roofline, results also show each kernel's
+// percentage of its roofline (the lesser of the compute peak of its type and
+// its arithmetic intensity times the measured bandwidth).
+
+namespace {
+
+struct Shape {
+  size_t m, n, k;
+};
+
+struct Config {
+  std::vector<Shape> shapes = {{64, 64, 64}, {128, 128, 128}, {256, 256, 256}};
+  std::vector<std::string> types = {"int8", "int16", "int32", "float"};
+  std::vector<MatMulImpl> impls = {MatMulImpl::ASM_NAIVE, MatMulImpl::ASM_VECTOR,
+                                   MatMulImpl::ASM_BLOCKED};
+  std::vector<int> threads = {1};
+  bool threads_given = false;
+  int batch = 1;
+  int vlen = 0;
+  BenchOptions options;
+  uint32_t seed = 42;
+  bool verify = true;
+  std::string format = "table";
+  std::string output;
+  bool tune = false;
+  std::string tuning_cache = TuningCache::default_path();
+  std::string roofline = RooflineCeilings::default_path();
+  bool roofline_given = false;
+  RooflineCeilings ceilings;
+};
+
+struct Result {
+  std::string type;
+  MatMulImpl impl;
+  Shape shape;
+  int threads;
+  int batch;
+  int vlen;
+  BenchStats stats;
+  double gflops;
+  double gbps;
+  double peak_pct; // percent of the roofline, -1 without ceilings
+  std::string verified; // "pass", "fail" or "skipped"
+};
+
+std::vector<std::string> split(const std::string &text, char sep) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, sep))
+    if (!part.empty())
+      parts.push_back(part);
+  return parts;
+}
+
+int parse_int(const std::string &text) {
+  size_t used = 0;
+  int value = std::stoi(text, &used);
+  if (used != text.size())
+    throw std::invalid_argument("Not an integer: " + text);
+  return value;
+}
+
+Shape parse_shape(const std::string &text) {
+  std::vector<std::string> dims = split(text, 'x');
+  if (dims.size() == 1) {
+    size_t s = parse_int(dims[0]);
+    return {s, s, s};
+  }
+  if (dims.size() == 3)
+    return {size_t(parse_int(dims[0])), size_t(parse_int(dims[1])),
+            size_t(parse_int(dims[2]))};
+  throw std::invalid_argument("Shape must be N or MxNxK: " + text);
+}
+
+void print_usage() {
+  std::cout
+      << "Usage: matmul_bench [options]\n"
+         "  --shapes LIST    comma-separated N or MxNxK (default 64,128,256)\n"
+         "  --types LIST     int8,int16,int32,float,fp16,bf16\n"
+         "                   (default int8,int16,int32,float)\n"
+         "  --impls LIST     cpp,cpp_blocked,naive,vector,blocked,ime,strassen,\n"
+         "                   auto or all\n"
+         "                   (default naive,vector,blocked)\n"
+         "  --threads LIST   thread counts (default 1)\n"
+         "  --batch N        time matmul_batched over N products per run\n"
+         "  --vlen N         strip width cap for the vector kernels (0 = VLMAX)\n"
+         "  --warmup N       untimed runs before measuring (default 2)\n"
+         "  --reps N         timed runs (default 10)\n"
+         "  --seed N         input data seed (default 42)\n"
+         "  --no-verify      skip the check against the C++ reference\n"
+         "  --format F       table, csv or json (default table)\n"
+         "  --output FILE    write results to FILE instead of stdout\n"
+         "  --tune           search kernel parameters and save them to the\n"
+         "                   tuning cache instead of benchmarking\n"
+         "  --tuning-cache F tuning cache file (default $MATMUL_TUNING_CACHE\n"
+         "                   or ~/.cache/matmul_tuning.txt)\n"
+         "  --roofline FILE  ceilings from matmul_roofline (default\n"
+         "                   $MATMUL_ROOFLINE or ~/.cache/matmul_roofline.txt)\n";
+}
+
+Config parse_args(int argc, char *argv[]) {
+  Config config;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc)
+        throw std::invalid_argument("Missing value for " + arg);
+      return argv[++i];
+    };
+
+    if (arg == "--help" || arg == "-h") {
+      print_usage();
+      std::exit(0);
+    } else if (arg == "--shapes") {
+      config.shapes.clear();
+      for (const auto &s : split(value(), ','))
+        config.shapes.push_back(parse_shape(s));
+    } else if (arg == "--types") {
+      config.types = split(value(), ',');
+      for (const auto &t : config.types)
+        if (t != "int8" && t != "int16" && t != "int32" && t != "float" &&
+            t != "fp16" && t != "bf16")
+          throw std::invalid_argument("Unknown type: " + t);
+    } else if (arg == "--impls") {
+      config.impls.clear();
+      for (const auto &name : split(value(), ',')) {
+        bool found = false;
+        for (const auto &entry : implKeys()) {
+          if (name == "all" || name == entry.first) {
+            config.impls.push_back(entry.second);
+            found = true;
+          }
+        }
+        if (!found)
+          throw std::invalid_argument("Unknown implementation: " + name);
+      }
+    } else if (arg == "--threads") {
+      config.threads.clear();
+      config.threads_given = true;
+      for (const auto &t : split(value(), ','))
+        config.threads.push_back(std::max(1, parse_int(t)));
+    } else if (arg == "--batch") {
+      config.batch = std::max(1, parse_int(value()));
+    } else if (arg == "--vlen") {
+      config.vlen = parse_int(value());
+    } else if (arg == "--warmup") {
+      config.options.warmup = std::max(0, parse_int(value()));
+    } else if (arg == "--reps") {
+      config.options.repetitions = std::max(1, parse_int(value()));
+    } else if (arg == "--seed") {
+      config.seed = uint32_t(parse_int(value()));
+    } else if (arg == "--no-verify") {
+      config.verify = false;
+    } else if (arg == "--format") {
+      config.format = value();
+      if (config.format != "table" && config.format != "csv" &&
+          config.format != "json")
+        throw std::invalid_argument("Unknown format: " + config.format);
+    } else if (arg == "--output") {
+      config.output = value();
+    } else if (arg == "--tune") {
+      config.tune = true;
+    } else if (arg == "--tuning-cache") {
+      config.tuning_cache = value();
+    } else if (arg == "--roofline") {
+      config.roofline = value();
+      config.roofline_given = true;
+    } else {
+      throw std::invalid_argument("Unknown option: " + arg);
+    }
+  }
+  return config;
+}
+
+// Percent of the roofline of a batch of M x N x K products, -1 without
+// ceilings. IME kernels are held to the vmadot peak.
+template <typename T>
+double percent_of_peak(const Config &config, const std::string &type,
+                       MatMulImpl impl, const Shape &shape, size_t batch,
+                       int threads, double achieved_gflops) {
+  bool matrix_unit = resolve_impl<T>(impl, shape.m, shape.n, shape.k) ==
+                     MatMulImpl::ASM_IME;
+  return config.ceilings.percent_of_peak(
+      type, matmul_flops(shape.m, shape.n, shape.k) * double(batch),
+      matmul_bytes<T>(shape.m, shape.n, shape.k) * double(batch),
+      achieved_gflops, matrix_unit, threads);
+}
+
+// Batched runs stack the operands of every product: A is (batch * M) x K,
+// B is (batch * K) x N and C is (batch * M) x N
+template <typename T>
+void run_type_batched(const std::string &type, const Config &config,
+                      std::vector<Result> &results) {
+  const size_t batch = size_t(config.batch);
+  for (const Shape &shape : config.shapes) {
+    std::mt19937 gen(config.seed);
+    Matrix<T> a(batch * shape.m, shape.k), b(batch * shape.k, shape.n);
+    a.randomize(gen);
+    b.randomize(gen);
+
+    const size_t stride_a = shape.m * shape.k, stride_b = shape.k * shape.n,
+                 stride_c = shape.m * shape.n;
+    Matrix<T> reference(0, 0);
+    if (config.verify) {
+      reference = Matrix<T>(batch * shape.m, shape.n);
+      matmul_batched(int(batch), int(shape.m), int(shape.n), int(shape.k),
+                     a.data(), stride_a, b.data(), stride_b, reference.data(),
+                     stride_c, MatMulImpl::CPP_NAIVE, 1);
+    }
+
+    Matrix<T> c(batch * shape.m, shape.n);
+    for (MatMulImpl impl : config.impls) {
+      for (int threads : config.threads) {
+        Result r{type, impl, shape, threads, config.batch, config.vlen, {},
+                 0.0, 0.0, -1.0, "skipped"};
+        r.stats = benchmark(
+            [&] {
+              matmul_batched(int(batch), int(shape.m), int(shape.n),
+                             int(shape.k), a.data(), stride_a, b.data(),
+                             stride_b, c.data(), stride_c, impl, threads);
+            },
+            config.options);
+        r.gflops = gflops(matmul_flops(shape.m, shape.n, shape.k) * batch,
+                          r.stats.median_ms);
+        r.gbps = gbytes_per_second(
+            matmul_bytes<T>(shape.m, shape.n, shape.k) * batch,
+            r.stats.median_ms);
+        r.peak_pct = percent_of_peak<T>(config, type, impl, shape, batch,
+                                        threads, r.gflops);
+        if (config.verify)
+          r.verified = reference.equals(c, verify_epsilon<T>(shape.m, shape.n,
+                                                             shape.k, impl))
+                           ? "pass"
+                           : "fail";
+        results.push_back(r);
+      }
+    }
+  }
+}
+
+template <typename T>
+void run_type(const std::string &type, const Config &config,
+              std::vector<Result> &results) {
+  if (config.batch > 1) {
+    run_type_batched<T>(type, config, results);
+    return;
+  }
+
+  for (const Shape &shape : config.shapes) {
+    std::mt19937 gen(config.seed);
+    Matrix<T> a(shape.m, shape.k), b(shape.k, shape.n);
+    a.randomize(gen);
+    b.randomize(gen);
+
+    Matrix<T> reference(0, 0);
+    if (config.verify)
+      reference = matmul(a, b, MatMulImpl::CPP_NAIVE);
+
+    Matrix<T> c(shape.m, shape.n);
+    for (MatMulImpl impl : config.impls) {
+      for (int threads : config.threads) {
+        Result r{type, impl, shape, threads, 1, config.vlen, {}, 0.0, 0.0,
+                 -1.0, "skipped"};
+        r.stats = benchmark_matmul(a, b, c, impl, config.vlen, threads,
+                                   config.options);
+        r.gflops = gflops(matmul_flops(shape.m, shape.n, shape.k),
+                          r.stats.median_ms);
+        r.gbps = gbytes_per_second(
+            matmul_bytes<T>(shape.m, shape.n, shape.k), r.stats.median_ms);
+        r.peak_pct = percent_of_peak<T>(config, type, impl, shape, 1,
+                                        threads, r.gflops);
+        if (config.verify)
+          r.verified = reference.equals(c, verify_epsilon<T>(shape.m, shape.n,
+                                                             shape.k, impl))
+                           ? "pass"
+                           : "fail";
+        results.push_back(r);
+      }
+    }
+  }
+}
+
+template <typename T>
+void tune_type(const std::string &type, const Config &config,
+               std::ostream &os) {
+  AutotuneOptions options;
+  options.bench = config.options;
+  options.seed = config.seed;
+  if (config.threads_given)
+    options.threads = config.threads;
+  for (const Shape &shape : config.shapes) {
+    for (MatMulImpl impl : config.impls) {
+      if (impl == MatMulImpl::CPP_NAIVE || impl == MatMulImpl::AUTO)
+        continue;
+      TuneParams p = autotune<T>(shape.m, shape.n, shape.k, impl, options);
+      std::string dims = std::to_string(shape.m) + "x" +
+                         std::to_string(shape.n) + "x" +
+                         std::to_string(shape.k);
+      os << std::left << std::setw(7) << type << std::setw(13)
+         << getImplKey(impl) << std::setw(16) << dims << std::right
+         << std::setw(6) << p.vlen << std::setw(6) << p.lmul << std::setw(6)
+         << p.blocks.mc << std::setw(6) << p.blocks.kc << std::setw(6)
+         << p.blocks.nc << std::setw(7) << p.cutoff << std::setw(5)
+         << p.threads << std::fixed
+         << std::setprecision(3) << std::setw(11) << p.ms << "\n";
+    }
+  }
+}
+
+void write_table(std::ostream &os, const std::vector<Result> &results) {
+  os << "cpu: " << describe_cpu_features() << "\n";
+  os << std::left << std::setw(7) << "type" << std::setw(13) << "impl"
+     << std::setw(16) << "MxNxK" << std::right << std::setw(4) << "thr"
+     << std::setw(6) << "batch"
+     << std::setw(11) << "min ms" << std::setw(11) << "median ms"
+     << std::setw(11) << "p95 ms" << std::setw(10) << "GFLOP/s"
+     << std::setw(9) << "GB/s" << std::setw(7) << "%peak" << "  verify\n";
+  for (const Result &r : results) {
+    std::string shape = std::to_string(r.shape.m) + "x" +
+                        std::to_string(r.shape.n) + "x" +
+                        std::to_string(r.shape.k);
+    os << std::left << std::setw(7) << r.type << std::setw(13)
+       << getImplKey(r.impl) << std::setw(16) << shape << std::right
+       << std::setw(4) << r.threads << std::setw(6) << r.batch << std::fixed
+       << std::setprecision(3) << std::setw(11) << r.stats.min_ms
+       << std::setw(11) << r.stats.median_ms << std::setw(11) << r.stats.p95_ms
+       << std::setprecision(2) << std::setw(10) << r.gflops << std::setw(9)
+       << r.gbps << std::setw(7);
+    if (r.peak_pct >= 0.0)
+      os << std::setprecision(1) << r.peak_pct;
+    else
+      os << "-";
+    os << "  " << r.verified << "\n";
+  }
+}
+
+void write_csv(std::ostream &os, const std::vector<Result> &results) {
+  os << "type,impl,m,n,k,threads,batch,vlen,reps,min_ms,median_ms,p95_ms,"
+        "mean_ms,gflops,gbps,peak_pct,verified\n";
+  os << std::setprecision(6);
+  for (const Result &r : results) {
+    os << r.type << "," << getImplKey(r.impl) << "," << r.shape.m << ","
+       << r.shape.n << "," << r.shape.k << "," << r.threads << "," << r.batch
+       << "," << r.vlen << "," << r.stats.repetitions << ","
+       << r.stats.min_ms << "," << r.stats.median_ms << "," << r.stats.p95_ms
+       << "," << r.stats.mean_ms << "," << r.gflops << "," << r.gbps << ",";
+    if (r.peak_pct >= 0.0)
+      os << r.peak_pct;
+    os << "," << r.verified << "\n";
+  }
+}
+
+void write_json(std::ostream &os, const std::vector<Result> &results) {
+  os << std::setprecision(6) << "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    os << "  {\"type\": \"" << r.type << "\", \"impl\": \""
+       << getImplKey(r.impl) << "\", \"m\": " << r.shape.m
+       << ", \"n\": " << r.shape.n << ", \"k\": " << r.shape.k
+       << ", \"threads\": " << r.threads << ", \"batch\": " << r.batch
+       << ", \"vlen\": " << r.vlen << ", \"reps\": " << r.stats.repetitions
+       << ", \"min_ms\": " << r.stats.min_ms
+       << ", \"median_ms\": " << r.stats.median_ms
+       << ", \"p95_ms\": " << r.stats.p95_ms
+       << ", \"mean_ms\": " << r.stats.mean_ms << ", \"gflops\": " << r.gflops
+       << ", \"gbps\": " << r.gbps << ", \"peak_pct\": ";
+    if (r.peak_pct >= 0.0)
+      os << r.peak_pct;
+    else
+      os << "null";
+    os << ", \"verified\": \"" << r.verified
+       << "\"}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "]\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Config config;
+  try {
+    config = parse_args(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << "matmul_bench: " << e.what() << "\n";
+    print_usage();
+    return 2;
+  }
+
+  try {
+    if (!config.ceilings.load(config.roofline) && config.roofline_given) {
+      std::cerr << "matmul_bench: cannot open " << config.roofline << "\n";
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "matmul_bench: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (config.tune) {
+    std::cout << std::left << std::setw(7) << "type" << std::setw(13) << "impl"
+              << std::setw(16) << "MxNxK" << std::right << std::setw(6)
+              << "vlen" << std::setw(6) << "lmul" << std::setw(6) << "mc"
+              << std::setw(6) << "kc" << std::setw(6) << "nc" << std::setw(7)
+              << "cutoff" << std::setw(5) << "thr" << std::setw(11)
+              << "median ms" << "\n";
+    for (const std::string &type : config.types) {
+      if (type == "int8")
+        tune_type<int8_t>(type, config, std::cout);
+      else if (type == "int16")
+        tune_type<int16_t>(type, config, std::cout);
+      else if (type == "int32")
+        tune_type<int32_t>(type, config, std::cout);
+      else if (type == "fp16")
+        tune_type<float16>(type, config, std::cout);
+      else if (type == "bf16")
+        tune_type<bfloat16>(type, config, std::cout);
+      else
+        tune_type<float>(type, config, std::cout);
+    }
+    try {
+      TuningCache::instance().save(config.tuning_cache);
+    } catch (const std::exception &e) {
+      std::cerr << "matmul_bench: " << e.what() << "\n";
+      return 1;
+    }
+    std::cout << "Saved " << TuningCache::instance().size() << " entries to "
+              << config.tuning_cache << "\n";
+    return 0;
+  }
+
+  std::vector<Result> results;
+  for (const std::string &type : config.types) {
+    if (type == "int8")
+      run_type<int8_t>(type, config, results);
+    else if (type == "int16")
+      run_type<int16_t>(type, config, results);
+    else if (type == "int32")
+      run_type<int32_t>(type, config, results);
+    else if (type == "fp16")
+      run_type<float16>(type, config, results);
+    else if (type == "bf16")
+      run_type<bfloat16>(type, config, results);
+    else
+      run_type<float>(type, config, results);
+  }
+
+  std::ofstream file;
+  if (!config.output.empty()) {
+    file.open(config.output);
+    if (!file) {
+      std::cerr << "matmul_bench: cannot open " << config.output << "\n";
+      return 1;
+    }
+  }
+  std::ostream &os = config.output.empty() ? std::cout : file;
+
+  if (config.format == "csv")
+    write_csv(os, results);
+  else if (config.format == "json")
+    write_json(os, results);
+  else
+    write_table(os, results);
+  perf_report(config.format == "table" ? os : std::cerr);
+
+  bool failed = false;
+  for (const Result &r : results)
+    failed |= r.verified == "fail";
+  return failed ? 1 : 0;
+}
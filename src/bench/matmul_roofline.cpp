@@ -0,0 +1,216 @@
+#include "hpp/matmul.h"
+#include "hpp/roofline.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Roofline microbenchmarks for the target core.
+//
+//   matmul_roofline --sizes 16K,256K,4M,64M --lmuls 1,2,4,8
+//
+// Measures vector load / store bandwidth (unit stride, strided, indexed) at
+// each working set size and multiply-accumulate throughput (vfmacc, vmacc,
+// vwmacc, vmadot) at each SEW and LMUL, prints them with the per-type
+// ceilings they imply, and saves them to the roofline file that
+// matmul_bench --roofline reads to report each kernel's percent of peak.
+
+namespace {
+
+struct Config {
+  RooflineOptions options;
+  std::string output = RooflineCeilings::default_path();
+  bool save = true;
+};
+
+std::vector<std::string> split(const std::string &text, char sep) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, sep))
+    if (!part.empty())
+      parts.push_back(part);
+  return parts;
+}
+
+int parse_int(const std::string &text) {
+  size_t used = 0;
+  int value = std::stoi(text, &used);
+  if (used != text.size())
+    throw std::invalid_argument("Not an integer: " + text);
+  return value;
+}
+
+// Bytes, with an optional K, M or G suffix
+size_t parse_size(const std::string &text) {
+  size_t scale = 1;
+  std::string digits = text;
+  switch (text.empty() ? '\0' : text.back()) {
+  case 'K':
+  case 'k':
+    scale = size_t(1) << 10;
+    break;
+  case 'M':
+  case 'm':
+    scale = size_t(1) << 20;
+    break;
+  case 'G':
+  case 'g':
+    scale = size_t(1) << 30;
+    break;
+  }
+  if (scale != 1)
+    digits.pop_back();
+  int value = parse_int(digits);
+  if (value <= 0)
+    throw std::invalid_argument("Size must be positive: " + text);
+  return size_t(value) * scale;
+}
+
+std::string format_size(size_t bytes) {
+  if (bytes == 0)
+    return "-";
+  if (bytes % (size_t(1) << 20) == 0)
+    return std::to_string(bytes >> 20) + "M";
+  if (bytes % (size_t(1) << 10) == 0)
+    return std::to_string(bytes >> 10) + "K";
+  return std::to_string(bytes);
+}
+
+void print_usage() {
+  std::cout
+      << "Usage: matmul_roofline [options]\n"
+         "  --sizes LIST     working sets in bytes, K/M/G suffixes\n"
+         "                   (default 16K,256K,4M,64M)\n"
+         "  --lmuls LIST     register group sizes (default 1,2,4,8)\n"
+         "  --stride N       strided accesses, elements apart (default 16)\n"
+         "  --warmup N       untimed runs before measuring (default 1)\n"
+         "  --reps N         timed runs (default 5)\n"
+         "  --output FILE    roofline file to write (default $MATMUL_ROOFLINE\n"
+         "                   or ~/.cache/matmul_roofline.txt)\n"
+         "  --no-save        print the ceilings without saving them\n";
+}
+
+Config parse_args(int argc, char *argv[]) {
+  Config config;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc)
+        throw std::invalid_argument("Missing value for " + arg);
+      return argv[++i];
+    };
+
+    if (arg == "--help" || arg == "-h") {
+      print_usage();
+      std::exit(0);
+    } else if (arg == "--sizes") {
+      config.options.sizes.clear();
+      for (const auto &s : split(value(), ','))
+        config.options.sizes.push_back(parse_size(s));
+    } else if (arg == "--lmuls") {
+      config.options.lmuls.clear();
+      for (const auto &s : split(value(), ',')) {
+        int lmul = parse_int(s);
+        if (lmul != 1 && lmul != 2 && lmul != 4 && lmul != 8)
+          throw std::invalid_argument("LMUL must be 1, 2, 4 or 8: " + s);
+        config.options.lmuls.push_back(lmul);
+      }
+    } else if (arg == "--stride") {
+      config.options.stride = size_t(std::max(1, parse_int(value())));
+    } else if (arg == "--warmup") {
+      config.options.bench.warmup = std::max(0, parse_int(value()));
+    } else if (arg == "--reps") {
+      config.options.bench.repetitions = std::max(1, parse_int(value()));
+    } else if (arg == "--output") {
+      config.output = value();
+    } else if (arg == "--no-save") {
+      config.save = false;
+    } else {
+      throw std::invalid_argument("Unknown option: " + arg);
+    }
+  }
+  return config;
+}
+
+void write_table(std::ostream &os, const RooflineCeilings &ceilings) {
+  os << std::left << std::setw(9) << "kind" << std::setw(9) << "name"
+     << std::right << std::setw(5) << "sew" << std::setw(6) << "lmul"
+     << std::setw(8) << "bytes" << std::setw(12) << "value" << "\n";
+  for (const auto &entry : ceilings.entries()) {
+    const RooflineKey &k = entry.first;
+    os << std::left << std::setw(9) << k.kind << std::setw(9) << k.name
+       << std::right << std::setw(5) << k.sew << std::setw(6) << k.lmul
+       << std::setw(8) << format_size(k.bytes) << std::fixed
+       << std::setprecision(2) << std::setw(12) << entry.second
+       << (k.kind == "compute" ? " GFLOP/s" : " GB/s") << "\n";
+  }
+}
+
+// Per-type compute peaks against the bandwidth of the largest working set:
+// products below the ridge intensity (FLOP per byte) are memory bound
+void write_summary(std::ostream &os, const RooflineCeilings &ceilings,
+                   size_t largest) {
+  double bandwidth = ceilings.bandwidth_gbps(double(largest));
+  os << "\nUnit-stride load bandwidth at " << format_size(largest) << ": "
+     << std::fixed << std::setprecision(2) << bandwidth << " GB/s\n";
+  os << std::left << std::setw(12) << "type" << std::right << std::setw(14)
+     << "peak GFLOP/s" << std::setw(14) << "ridge FLOP/B" << "\n";
+  auto row = [&](const std::string &label, const std::string &type,
+                 bool matrix_unit) {
+    double peak = ceilings.peak_gflops(type, matrix_unit);
+    if (peak <= 0.0)
+      return;
+    os << std::left << std::setw(12) << label << std::right << std::setw(14)
+       << peak << std::setw(14) << (bandwidth > 0.0 ? peak / bandwidth : 0.0)
+       << "\n";
+  };
+  for (const char *type : {"int8", "int16", "int32", "float"})
+    row(type, type, false);
+  if (ceilings.peak_gflops("int8", true) > ceilings.peak_gflops("int8"))
+    row("int8 (IME)", "int8", true);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Config config;
+  try {
+    config = parse_args(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << "matmul_roofline: " << e.what() << "\n";
+    print_usage();
+    return 2;
+  }
+
+  std::cout << "cpu: " << describe_cpu_features() << "\n";
+  RooflineCeilings ceilings;
+  try {
+    ceilings = measure_roofline(config.options);
+  } catch (const std::exception &e) {
+    std::cerr << "matmul_roofline: " << e.what() << "\n";
+    return 1;
+  }
+
+  write_table(std::cout, ceilings);
+  size_t largest = config.options.sizes.empty()
+                       ? 0
+                       : *std::max_element(config.options.sizes.begin(),
+                                           config.options.sizes.end());
+  write_summary(std::cout, ceilings, largest);
+
+  if (config.save) {
+    try {
+      ceilings.save(config.output);
+    } catch (const std::exception &e) {
+      std::cerr << "matmul_roofline: " << e.what() << "\n";
+      return 1;
+    }
+    std::cout << "Saved " << ceilings.entries().size() << " ceilings to "
+              << config.output << "\n";
+  }
+  return 0;
+}
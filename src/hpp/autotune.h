@@ -0,0 +1,117 @@
+#pragma once
+
+#include "bench.h"
+#include "matmul.h"
+#include "tuning.h"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Autotuner for the kernel parameters in tuning.h.
+//
+// autotune() times candidate parameter sets for one (type, implementation,
+// shape) on random inputs and records the fastest in TuningCache::instance();
+// TuningCache::save() persists it. The search is greedy, one parameter at a
+// time starting from the defaults:
+//
+//   vector   strip width (vlen), then LMUL (float only)
+//   blocked  KC, then MC, then NC
+//   strassen recursion cutoff
+//   all      thread count, last, with the kernel parameters fixed
+//
+// MR x NR is fixed by the assembly micro-kernels. clamp_freq is not searched:
+// the integer vector kernels saturate once at the end of the K loop, so it
+// has no effect on their run time.
+
+struct AutotuneOptions {
+  BenchOptions bench = {1, 3};
+  std::vector<int> vlens = {0, 8, 16, 32, 64, 128};
+  std::vector<int> lmuls = {1, 2, 4};
+  std::vector<int> mcs = {32, 64, 128, 256};
+  std::vector<int> kcs = {128, 256, 512, 1024};
+  std::vector<int> ncs = {128, 256, 512, 1024};
+  std::vector<int> cutoffs = {64, 128, 256, 512};
+  std::vector<int> threads; // empty: 1, 2, 4, ... up to the pool size
+  uint32_t seed = 42;
+};
+
+template <typename T>
+TuneParams autotune(int m, int n, int k, MatMulImpl impl,
+                    const AutotuneOptions &options = AutotuneOptions()) {
+  if (impl == MatMulImpl::CPP_NAIVE)
+    throw std::invalid_argument(
+        "The C++ reference implementation has no parameters to tune");
+  if (impl == MatMulImpl::AUTO)
+    throw std::invalid_argument(
+        "AUTO picks among the tuned implementations; tune those instead");
+  if (m <= 0 || n <= 0 || k <= 0)
+    throw std::invalid_argument("Cannot tune an empty shape");
+
+  std::mt19937 gen(options.seed);
+  Matrix<T> a(m, k), b(k, n);
+  a.randomize(gen);
+  b.randomize(gen);
+  Matrix<T> c(m, n, typename Matrix<T>::Uninitialized{});
+
+  auto time = [&](const TuneParams &p) {
+    return benchmark(
+               [&] {
+                 call_asm_impl_parallel(a.data(), b.data(), c.data(), m, k, n,
+                                        impl, 0, p.threads, &p);
+               },
+               options.bench)
+        .median_ms;
+  };
+
+  TuneParams best;
+  best.threads = 1;
+  if (impl == MatMulImpl::ASM_BLOCKED)
+    best.blocks = BlockedTraits<T>::defaults();
+  best.ms = time(best);
+
+  // Try each value for one parameter, keeping the fastest. Blocks more than
+  // twice the matching dimension behave like smaller ones and are skipped.
+  auto search = [&](const std::vector<int> &values, int limit, auto set) {
+    for (int value : values) {
+      if (limit > 0 && value > 2 * limit)
+        continue;
+      TuneParams p = best;
+      set(p, value);
+      double ms = time(p);
+      if (ms < best.ms) {
+        best = p;
+        best.ms = ms;
+      }
+    }
+  };
+
+  if (impl == MatMulImpl::ASM_VECTOR) {
+    search(options.vlens, n, [](TuneParams &p, int v) { p.vlen = v; });
+    if constexpr (std::is_same_v<T, float>)
+      search(options.lmuls, 0, [](TuneParams &p, int v) { p.lmul = v; });
+  } else if (impl == MatMulImpl::ASM_BLOCKED) {
+    search(options.kcs, k, [](TuneParams &p, int v) { p.blocks.kc = v; });
+    search(options.mcs, m, [](TuneParams &p, int v) { p.blocks.mc = v; });
+    search(options.ncs, n, [](TuneParams &p, int v) { p.blocks.nc = v; });
+  } else if (impl == MatMulImpl::ASM_STRASSEN) {
+    search(options.cutoffs, std::min({m, n, k}),
+           [](TuneParams &p, int v) { p.cutoff = v; });
+  }
+
+  std::vector<int> threads = options.threads;
+  if (threads.empty()) {
+    int pool = ThreadPool::instance().num_threads();
+    for (int t = 2; t < pool; t *= 2)
+      threads.push_back(t);
+    if (pool > 1)
+      threads.push_back(pool);
+  }
+  search(threads, 0, [](TuneParams &p, int v) { p.threads = std::max(1, v); });
+
+  TuningCache::instance().insert(make_tune_key<T>(getImplKey(impl), m, n, k),
+                                 best);
+  return best;
+}
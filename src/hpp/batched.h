@@ -0,0 +1,173 @@
+#pragma once
+
+#include "matmul.h"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Batched GEMM: C_i = A_i * B_i for many products of one shape (m x k times
+// k x n, dense row-major).
+//
+// Shapes are validated and the kernel parameters looked up once for the whole
+// batch, and the batch is split into contiguous chunks over the thread pool.
+// With ASM_BLOCKED, products that fit in one cache block skip the per-call
+// driver: each chunk keeps its packing and accumulator buffers across its
+// items, and a B shared by the whole batch is packed only once.
+
+// Blocked path for products that fit in one block. a_at(i), b_at(i) and
+// c_at(i) return the operands of item i.
+template <typename T, typename GetA, typename GetB, typename GetC>
+void matmul_batched_single_block(int m, int n, int k, GetA a_at, GetB b_at,
+                                 GetC c_at, bool shared_b, int chunks,
+                                 int chunk_size, int batch, int threads) {
+  using Traits = BlockedTraits<T>;
+  using PackType = typename Traits::PackType;
+  using AccumulatorType = typename Traits::AccumulatorType;
+  constexpr bool accumulate_in_c = std::is_same_v<AccumulatorType, T>;
+  const size_t m_pad = size_t(m + Traits::MR - 1) / Traits::MR * Traits::MR;
+  const size_t n_pad = size_t(n + Traits::NR - 1) / Traits::NR * Traits::NR;
+
+  std::unique_ptr<PackType[], AlignedFree> shared_pack;
+  if (shared_b) {
+    shared_pack = make_aligned_buffer<PackType>(n_pad * k);
+    pack_b_block<PackType, Traits::NR>(b_at(0), n, 1, k, n,
+                                       shared_pack.get());
+  }
+
+  ThreadPool::instance().parallel_for(
+      chunks,
+      [&](int chunk) {
+        auto a_pack = make_aligned_buffer<PackType>(m_pad * k);
+        std::unique_ptr<PackType[], AlignedFree> b_pack;
+        if (!shared_b)
+          b_pack = make_aligned_buffer<PackType>(n_pad * k);
+        std::unique_ptr<AccumulatorType[], AlignedFree> acc;
+        if constexpr (!accumulate_in_c)
+          acc = make_aligned_buffer<AccumulatorType>(size_t(m) * n);
+
+        int end = std::min(batch, (chunk + 1) * chunk_size);
+        for (int i = chunk * chunk_size; i < end; ++i) {
+          const PackType *b_packed = shared_pack.get();
+          if (!shared_b) {
+            pack_b_block<PackType, Traits::NR>(b_at(i), n, 1, k, n,
+                                               b_pack.get());
+            b_packed = b_pack.get();
+          }
+          pack_a_block<PackType, Traits::MR>(a_at(i), k, 1, m, k,
+                                             a_pack.get());
+
+          T *c = c_at(i);
+          if constexpr (accumulate_in_c) {
+            std::fill(c, c + size_t(m) * n, T(0));
+            blocked_macro_kernel<T>(a_pack.get(), b_packed, m, n, k, c, n);
+          } else {
+            std::fill(acc.get(), acc.get() + size_t(m) * n,
+                      AccumulatorType(0));
+            blocked_macro_kernel<T>(a_pack.get(), b_packed, m, n, k,
+                                    acc.get(), n);
+            blocked_epilogue<T>(acc.get(), n, c, n, m, n, T(1), T(0));
+          }
+        }
+      },
+      threads);
+}
+
+template <typename T, typename GetA, typename GetB, typename GetC>
+void matmul_batched_impl(int batch, int m, int n, int k, GetA a_at, GetB b_at,
+                         GetC c_at, bool shared_b, MatMulImpl impl,
+                         int num_threads) {
+  if (batch < 0 || m < 0 || n < 0 || k < 0)
+    throw std::invalid_argument("Negative batch size or matrix dimension");
+  if (batch == 0 || m == 0 || n == 0)
+    return;
+
+  impl = resolve_impl<T>(impl, m, n, k);
+  MATMUL_PERF_SCOPE(std::string("batched/") + getImplKey(impl) + "/" +
+                        element_type_name<T>(),
+                    2.0 * batch * m * n * k);
+
+  ThreadPool &pool = ThreadPool::instance();
+  int threads = pool.num_threads();
+  if (num_threads > 0)
+    threads = std::min(threads, num_threads);
+
+  // A few chunks per thread so work stealing can even out the load
+  int chunks = std::min(batch, threads * 4);
+  int chunk_size = (batch + chunks - 1) / chunks;
+  chunks = (batch + chunk_size - 1) / chunk_size;
+
+  auto for_each_item = [&](auto &&run) {
+    pool.parallel_for(
+        chunks,
+        [&](int chunk) {
+          int end = std::min(batch, (chunk + 1) * chunk_size);
+          for (int i = chunk * chunk_size; i < end; ++i)
+            run(i);
+        },
+        threads);
+  };
+
+  if (impl == MatMulImpl::CPP_NAIVE) {
+    for_each_item([&](int i) {
+      gemm_cpp_naive(Transpose::No, Transpose::No, m, n, k, T(1), a_at(i),
+                     std::max(1, k), b_at(i), n, T(0), c_at(i), n);
+    });
+    return;
+  }
+
+  TuneParams params = tuned_params<T>(impl, m, n, k);
+  if (impl == MatMulImpl::ASM_BLOCKED) {
+    BlockSizes bs = tuned_blocks<T>(params);
+    if (k > 0 && m <= bs.mc && n <= bs.nc && k <= bs.kc) {
+      matmul_batched_single_block<T>(m, n, k, a_at, b_at, c_at, shared_b,
+                                     chunks, chunk_size, batch, threads);
+      return;
+    }
+  }
+
+  for_each_item([&](int i) {
+    call_asm_kernel(a_at(i), b_at(i), c_at(i), m, k, n, impl, params);
+  });
+}
+
+// Strided batch: A_i = a + i * stride_a, B_i = b + i * stride_b and
+// C_i = c + i * stride_c (strides in elements). A stride of 0 shares A or B
+// across the batch. num_threads = 0 uses the whole pool.
+template <typename T>
+void matmul_batched(int batch, int m, int n, int k, const T *a,
+                    size_t stride_a, const T *b, size_t stride_b, T *c,
+                    size_t stride_c,
+                    MatMulImpl impl = MatMulImpl::ASM_BLOCKED,
+                    int num_threads = 0) {
+  if ((stride_a != 0 && stride_a < size_t(m) * k) ||
+      (stride_b != 0 && stride_b < size_t(k) * n) ||
+      (batch > 1 && stride_c < size_t(m) * n))
+    throw std::invalid_argument("Batch stride smaller than one matrix");
+
+  matmul_batched_impl<T>(
+      batch, m, n, k, [=](int i) { return a + size_t(i) * stride_a; },
+      [=](int i) { return b + size_t(i) * stride_b; },
+      [=](int i) { return c + size_t(i) * stride_c; }, stride_b == 0, impl,
+      num_threads);
+}
+
+// Pointer-array batch: C_i = A_i * B_i for i in [0, batch)
+template <typename T>
+void matmul_batched(int batch, int m, int n, int k, const T *const *a,
+                    const T *const *b, T *const *c,
+                    MatMulImpl impl = MatMulImpl::ASM_BLOCKED,
+                    int num_threads = 0) {
+  if (batch > 0 && (!a || !b || !c))
+    throw std::invalid_argument("Null batch pointer array");
+
+  bool shared_b = true;
+  for (int i = 1; i < batch && shared_b; ++i)
+    shared_b = b[i] == b[0];
+
+  matmul_batched_impl<T>(
+      batch, m, n, k, [=](int i) { return a[i]; }, [=](int i) { return b[i]; },
+      [=](int i) { return c[i]; }, shared_b, impl, num_threads);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "matmul.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+// Benchmark harness shared by matmul_demo and matmul_bench.
+//
+// A run executes the kernel `warmup` times untimed, then `repetitions` times
+// timed individually, and reports min / median / p95 / mean. Output buffers
+// are allocated by the caller beforehand, so only the kernel is timed.
+
+struct BenchOptions {
+  int warmup = 2;
+  int repetitions = 10;
+};
+
+struct BenchStats {
+  double min_ms = 0.0;
+  double median_ms = 0.0;
+  double p95_ms = 0.0;
+  double mean_ms = 0.0;
+  int repetitions = 0;
+};
+
+template <typename F>
+BenchStats benchmark(F &&fn, const BenchOptions &options = BenchOptions()) {
+  for (int i = 0; i < options.warmup; ++i)
+    fn();
+
+  std::vector<double> samples;
+  samples.reserve(std::max(1, options.repetitions));
+  for (int i = 0; i < std::max(1, options.repetitions); ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  std::sort(samples.begin(), samples.end());
+  size_t n = samples.size();
+  BenchStats stats;
+  stats.repetitions = int(n);
+  stats.min_ms = samples.front();
+  stats.median_ms = n % 2 ? samples[n / 2]
+                          : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+  // Nearest-rank percentile
+  size_t rank = size_t(std::ceil(0.95 * double(n)));
+  stats.p95_ms = samples[std::min(n, std::max<size_t>(1, rank)) - 1];
+  double sum = 0.0;
+  for (double s : samples)
+    sum += s;
+  stats.mean_ms = sum / double(n);
+  return stats;
+}
+
+// Arithmetic work of one M x N x K multiplication (one multiply-add = 2)
+inline double matmul_flops(size_t m, size_t n, size_t k) {
+  return 2.0 * double(m) * double(n) * double(k);
+}
+
+// Compulsory memory traffic: read A and B once, write C once
+template <typename T> double matmul_bytes(size_t m, size_t n, size_t k) {
+  return double(sizeof(T)) *
+         (double(m) * double(k) + double(k) * double(n) + double(m) * double(n));
+}
+
+// Float tolerance for checking a result against the C++ reference. Kernels
+// that reduce across vector lanes sum in a different order, and the rounding
+// difference grows with the depth k of the dot products.
+template <typename T> T verify_epsilon(size_t k) {
+  if constexpr (is_floating_element_v<T>)
+    return T(float(NumericTraits<T>::epsilon()) *
+             std::max(1.0f, std::sqrt(float(k))));
+  else
+    return NumericTraits<T>::epsilon();
+}
+
+// Tolerance for one implementation on an M x N x K product: Strassen float
+// results may differ from the reference by about twice as much per level of
+// recursion (see strassen.h). AUTO is checked against what it resolves to.
+template <typename T>
+T verify_epsilon(size_t m, size_t n, size_t k, MatMulImpl impl) {
+  T epsilon = verify_epsilon<T>(k);
+  impl = resolve_impl<T>(impl, int(m), int(n), int(k));
+  if constexpr (is_floating_element_v<T>) {
+    if (impl == MatMulImpl::ASM_STRASSEN) {
+      int depth = strassen_depth(
+          int(m), int(k), int(n),
+          strassen_cutoff(tuned_params<T>(impl, int(m), int(n), int(k))));
+      epsilon = T(float(epsilon) * float(1 << depth));
+    }
+  }
+  return epsilon;
+}
+
+inline double gflops(double flops, double ms) {
+  return ms > 0.0 ? flops / (ms * 1e6) : 0.0;
+}
+
+inline double gbytes_per_second(double bytes, double ms) {
+  return ms > 0.0 ? bytes / (ms * 1e6) : 0.0;
+}
+
+// Time c = a * b with the given implementation into a preallocated c.
+// threads > 1 spreads the tiles over the thread pool, using the tuned
+// parameters of the whole shape like matmul_parallel.
+template <typename T>
+BenchStats benchmark_matmul(const Matrix<T> &a, const Matrix<T> &b,
+                            Matrix<T> &c, MatMulImpl impl, int vlen = 0,
+                            int threads = 1,
+                            const BenchOptions &options = BenchOptions()) {
+  impl = resolve_impl<T>(impl, a.rows(), b.cols(), a.cols());
+  if (threads > 1 && impl != MatMulImpl::CPP_NAIVE && a.is_contiguous() &&
+      b.is_contiguous() && c.is_contiguous()) {
+    std::optional<TuneParams> tuned = TuningCache::instance().find(
+        make_tune_key<T>(getImplKey(impl), a.rows(), b.cols(), a.cols()));
+    return benchmark(
+        [&] {
+          call_asm_impl_parallel(a.data(), b.data(), c.data(), a.rows(),
+                                 a.cols(), b.cols(), impl, vlen, threads,
+                                 tuned ? &*tuned : nullptr);
+        },
+        options);
+  }
+  return benchmark([&] { matmul(a, b, c, impl, vlen); }, options);
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include "buffer_pool.h"
+#include "matrix.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Cache-blocked GEMM driver (Goto/BLIS loop order).
+//
+//   for jc in N step NC        B block  (KC x NC) lives in L2
+//     for pc in K step KC      pack B block into NR-wide micro-panels
+//       for ic in M step MC    pack A block into MR-tall micro-panels
+//         for jr in NC step NR   B micro-panel (KC x NR) stays in L1
+//           for ir in MC step MR   assembly micro-kernel on one MR x NR tile
+//
+// Integer types accumulate into a wider MC x NC buffer and are saturated once
+// per element, matching matmul_cpp_naive. For them the ic loop moves outside
+// pc: the K x NC column block of B is packed once per jc, and each row block
+// is flushed to C as soon as its sums are complete. Packing reads A and B
+// through (row, column) strides, so sub-blocks and transposed operands are
+// handled without extra copies. The 16-bit float types are widened to fp32
+// while packing and run on the float micro-kernel: the software-convert path
+// for cores without Zvfh / Zvfbfwma.
+
+// Assembly micro-kernels: C[0:mr][0:nr] += Apanel(kc x 4) * Bpanel(kc x nr)
+extern "C" {
+void matmul_asm_ukernel_float(const float *a_pack, const float *b_pack,
+                              float *c, int kc, int mr, int nr, int ldc,
+                              int nr_pack);
+
+void matmul_asm_ukernel_int8(const int8_t *a_pack, const int8_t *b_pack,
+                             int32_t *c, int kc, int mr, int nr, int ldc,
+                             int nr_pack);
+
+void matmul_asm_ukernel_int16(const int16_t *a_pack, const int16_t *b_pack,
+                              int32_t *c, int kc, int mr, int nr, int ldc,
+                              int nr_pack);
+
+void matmul_asm_ukernel_int32(const int32_t *a_pack, const int32_t *b_pack,
+                              int64_t *c, int kc, int mr, int nr, int ldc,
+                              int nr_pack);
+}
+
+// Cache block sizes (in elements)
+struct BlockSizes {
+  int mc; // rows of A packed per block (A block ~ MC x KC in L2)
+  int kc; // depth of a packed block (B micro-panel ~ KC x NR in L1)
+  int nc; // columns of B packed per block
+};
+
+// Per-type micro-kernel, accumulator and default blocking.
+// Defaults target the SpacemiT K1 (32 KB L1D per core, 512 KB L2 per cluster).
+template <typename T> struct BlockedTraits;
+
+template <> struct BlockedTraits<float> {
+  using PackType = float;
+  using AccumulatorType = float;
+  static constexpr int MR = 4;
+  static constexpr int NR = 16;
+  static constexpr BlockSizes defaults() { return {64, 256, 256}; }
+
+  static void ukernel(const float *a, const float *b, float *c, int kc, int mr,
+                      int nr, int ldc) {
+    matmul_asm_ukernel_float(a, b, c, kc, mr, nr, ldc, NR);
+  }
+};
+
+template <> struct BlockedTraits<int8_t> {
+  using PackType = int8_t;
+  using AccumulatorType = int32_t;
+  static constexpr int MR = 4;
+  static constexpr int NR = 16;
+  static constexpr BlockSizes defaults() { return {128, 512, 512}; }
+
+  static void ukernel(const int8_t *a, const int8_t *b, int32_t *c, int kc,
+                      int mr, int nr, int ldc) {
+    matmul_asm_ukernel_int8(a, b, c, kc, mr, nr, ldc, NR);
+  }
+};
+
+template <> struct BlockedTraits<int16_t> {
+  using PackType = int16_t;
+  using AccumulatorType = int32_t;
+  static constexpr int MR = 4;
+  static constexpr int NR = 16;
+  static constexpr BlockSizes defaults() { return {128, 256, 256}; }
+
+  static void ukernel(const int16_t *a, const int16_t *b, int32_t *c, int kc,
+                      int mr, int nr, int ldc) {
+    matmul_asm_ukernel_int16(a, b, c, kc, mr, nr, ldc, NR);
+  }
+};
+
+template <> struct BlockedTraits<int32_t> {
+  using PackType = int32_t;
+  using AccumulatorType = int64_t;
+  static constexpr int MR = 4;
+  static constexpr int NR = 16;
+  static constexpr BlockSizes defaults() { return {64, 256, 256}; }
+
+  static void ukernel(const int32_t *a, const int32_t *b, int64_t *c, int kc,
+                      int mr, int nr, int ldc) {
+    matmul_asm_ukernel_int32(a, b, c, kc, mr, nr, ldc, NR);
+  }
+};
+
+// fp16 / bf16 panels are packed as fp32, so the float micro-kernel and
+// blocking apply unchanged
+template <> struct BlockedTraits<float16> : BlockedTraits<float> {};
+template <> struct BlockedTraits<bfloat16> : BlockedTraits<float> {};
+
+// 64-byte aligned scratch buffer for packed panels, recycled through the
+// buffer pool
+struct AlignedFree {
+  size_t bytes = 0;
+  void operator()(void *p) const { BufferPool::instance().release(p, bytes); }
+};
+
+template <typename T>
+std::unique_ptr<T[], AlignedFree> make_aligned_buffer(size_t count) {
+  size_t bytes = count * sizeof(T);
+  void *p = BufferPool::instance().acquire(bytes);
+  return std::unique_ptr<T[], AlignedFree>(static_cast<T *>(p),
+                                           AlignedFree{bytes});
+}
+
+// Pack an mc x kc block of A into MR-tall micro-panels. Element (i, k) of the
+// block is a[i * rs + k * cs], so a transposed A is just rs = 1, cs = lda.
+// Each panel stores kc columns of MR values; rows past mc are zero. Values
+// are converted from the source type S and multiplied by alpha on the way in
+// (floating point types only).
+template <typename T, int MR, typename S = T>
+void pack_a_block(const S *a, size_t rs, size_t cs, int mc, int kc, T *pack,
+                  T alpha = T(1)) {
+  for (int ir = 0; ir < mc; ir += MR) {
+    int mr = std::min(MR, mc - ir);
+    for (int k = 0; k < kc; ++k) {
+      for (int r = 0; r < mr; ++r) {
+        T value = T(a[(ir + r) * rs + k * cs]);
+        pack[k * MR + r] = alpha == T(1) ? value : T(alpha * value);
+      }
+      for (int r = mr; r < MR; ++r)
+        pack[k * MR + r] = T(0);
+    }
+    pack += kc * MR;
+  }
+}
+
+// Pack a kc x nc block of B into NR-wide micro-panels. Element (k, j) of the
+// block is b[k * rs + j * cs], converted from the source type S. Each panel
+// stores kc rows of NR values; columns past nc are zero.
+template <typename T, int NR, typename S = T>
+void pack_b_block(const S *b, size_t rs, size_t cs, int kc, int nc, T *pack) {
+  for (int jr = 0; jr < nc; jr += NR) {
+    int nr = std::min(NR, nc - jr);
+    for (int k = 0; k < kc; ++k) {
+      const S *row = b + k * rs + jr * cs;
+      if (cs == 1) {
+        std::transform(row, row + nr, pack + k * NR,
+                       [](S value) { return T(value); });
+      } else {
+        for (int j = 0; j < nr; ++j)
+          pack[k * NR + j] = T(row[j * cs]);
+      }
+      std::fill(pack + k * NR + nr, pack + (k + 1) * NR, T(0));
+    }
+    pack += kc * NR;
+  }
+}
+
+// Multiply a packed mc x kc block of A by a packed kc x nc block of B and add
+// the product into c (rows ldc apart): the jr / ir loops of the driver.
+template <typename T>
+void blocked_macro_kernel(const typename BlockedTraits<T>::PackType *a_pack,
+                          const typename BlockedTraits<T>::PackType *b_pack,
+                          int mc, int nc, int kc,
+                          typename BlockedTraits<T>::AccumulatorType *c,
+                          int ldc) {
+  using Traits = BlockedTraits<T>;
+  for (int jr = 0; jr < nc; jr += Traits::NR) {
+    int nr = std::min(Traits::NR, nc - jr);
+    const auto *b_panel = b_pack + size_t(jr) * kc;
+
+    for (int ir = 0; ir < mc; ir += Traits::MR) {
+      int mr = std::min(Traits::MR, mc - ir);
+      Traits::ukernel(a_pack + size_t(ir) * kc, b_panel,
+                      c + size_t(ir) * ldc + jr, kc, mr, nr, ldc);
+    }
+  }
+}
+
+// C = saturate(alpha * acc + beta * C) for an m x n block of wide integer
+// accumulators (rows ld_acc apart), or C = alpha * acc + beta * C rounded to
+// TC for fp32 accumulators. With beta == 0, C is not read.
+template <typename T, typename TC = T>
+void blocked_epilogue(const typename BlockedTraits<T>::AccumulatorType *acc,
+                      int ld_acc, TC *c, int ldc, int m, int n, T alpha,
+                      T beta) {
+  using EpilogueType =
+      std::conditional_t<std::is_integral_v<T>, int64_t,
+                         typename BlockedTraits<T>::AccumulatorType>;
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < n; ++j) {
+      TC &out = c[size_t(i) * ldc + j];
+      EpilogueType value =
+          EpilogueType(alpha) * EpilogueType(acc[size_t(i) * ld_acc + j]);
+      if (beta != T(0))
+        value += EpilogueType(beta) * EpilogueType(out);
+      out = clamp_int<TC, EpilogueType>(value);
+    }
+  }
+}
+
+// Whether gemm_blocked<T, TC> accumulates straight into C (same accumulator
+// and output type) or into a wide MC x NC buffer flushed per row block
+template <typename T, typename TC>
+constexpr bool blocked_accumulates_in_c =
+    std::is_same_v<typename BlockedTraits<T>::AccumulatorType, TC>;
+
+// The loop nest of gemm_blocked with the B side abstracted: pack_b(jc, pc,
+// kc_cur, nc_cur) returns the NR-wide micro-panels of the kc_cur x nc_cur
+// block of op(B) at (pc, jc), either packed on the spot or prepacked once
+// (packed.h). mc and nc are whole micro-panels; m and n are positive.
+//
+// Accumulating in C, the driver runs the Goto order above and uses each B
+// block before asking for the next. With a wide accumulator the ic loop runs
+// outside pc instead: every KC block of the column block is requested up
+// front (their panels must stay valid together until the next jc), so each
+// MC x NC accumulator block holds complete sums when it is flushed.
+template <typename T, typename TC, typename PackB>
+void gemm_blocked_driver(bool trans_a, int m, int n, int k, T alpha,
+                         const T *a, int lda, T beta, TC *c, int ldc, int mc,
+                         int kc, int nc, PackB &&pack_b) {
+  using Traits = BlockedTraits<T>;
+  using PackType = typename Traits::PackType;
+  using AccumulatorType = typename Traits::AccumulatorType;
+  constexpr int MR = Traits::MR;
+  constexpr bool accumulate_in_c = blocked_accumulates_in_c<T, TC>;
+
+  // Strides of op(A) as (row, column) element steps
+  const size_t a_rs = trans_a ? 1 : size_t(lda), a_cs = trans_a ? size_t(lda) : 1;
+
+  // Pack the mc_cur x kc_cur block of A at (ic, pc) and add its product with
+  // the packed B block into c_block (rows ldc_block apart)
+  auto a_pack = make_aligned_buffer<PackType>(size_t(mc) * kc);
+  auto multiply_block = [&](int ic, int mc_cur, int pc, int kc_cur,
+                            const PackType *b_pack, int nc_cur,
+                            AccumulatorType *c_block, int ldc_block) {
+    {
+      MATMUL_PERF_SCOPE(std::string("blocked/") + element_type_name<T>() +
+                        "/pack");
+      pack_a_block<PackType, MR>(a + ic * a_rs + pc * a_cs, a_rs, a_cs, mc_cur,
+                                 kc_cur, a_pack.get(),
+                                 accumulate_in_c ? PackType(alpha)
+                                                 : PackType(1));
+    }
+
+    MATMUL_PERF_SCOPE(std::string("blocked/") + element_type_name<T>() +
+                          "/compute",
+                      2.0 * mc_cur * nc_cur * kc_cur);
+    blocked_macro_kernel<T>(a_pack.get(), b_pack, mc_cur, nc_cur, kc_cur,
+                            c_block, ldc_block);
+  };
+
+  if constexpr (accumulate_in_c) {
+    // Apply beta up front; the micro-kernels then add alpha * A * B into C
+    if (beta != T(1)) {
+      for (int i = 0; i < m; ++i) {
+        TC *row = c + size_t(i) * ldc;
+        if (beta == T(0))
+          std::fill(row, row + n, TC(0));
+        else
+          for (int j = 0; j < n; ++j)
+            row[j] *= TC(beta);
+      }
+    }
+
+    for (int jc = 0; jc < n; jc += nc) {
+      int nc_cur = std::min(nc, n - jc);
+      for (int pc = 0; pc < k; pc += kc) {
+        int kc_cur = std::min(kc, k - pc);
+        const PackType *b_pack = pack_b(jc, pc, kc_cur, nc_cur);
+        for (int ic = 0; ic < m; ic += mc)
+          multiply_block(ic, std::min(mc, m - ic), pc, kc_cur, b_pack, nc_cur,
+                         c + size_t(ic) * ldc + jc, ldc);
+      }
+    }
+  } else {
+    auto acc = make_aligned_buffer<AccumulatorType>(size_t(mc) * nc);
+    std::vector<const PackType *> b_blocks((k + kc - 1) / kc);
+
+    for (int jc = 0; jc < n; jc += nc) {
+      int nc_cur = std::min(nc, n - jc);
+      for (int pc = 0; pc < k; pc += kc)
+        b_blocks[pc / kc] = pack_b(jc, pc, std::min(kc, k - pc), nc_cur);
+
+      for (int ic = 0; ic < m; ic += mc) {
+        int mc_cur = std::min(mc, m - ic);
+        std::fill(acc.get(), acc.get() + size_t(mc_cur) * nc_cur,
+                  AccumulatorType(0));
+        for (int pc = 0; pc < k; pc += kc)
+          multiply_block(ic, mc_cur, pc, std::min(kc, k - pc),
+                         b_blocks[pc / kc], nc_cur, acc.get(), nc_cur);
+
+        // Scale and saturate the finished block into C
+        MATMUL_PERF_SCOPE(std::string("blocked/") + element_type_name<T>() +
+                          "/epilogue");
+        blocked_epilogue<T, TC>(acc.get(), nc_cur, c + size_t(ic) * ldc + jc,
+                                ldc, mc_cur, nc_cur, alpha, beta);
+      }
+    }
+  }
+}
+
+// C = alpha * op(A) * op(B) + beta * C, where op(A) is m x k, op(B) is k x n
+// and every matrix is row-major with its own leading dimension. Transposed
+// operands are read through the packing routines, never copied up front.
+// With beta == 0, C is not read. Integer types accumulate op(A) * op(B) in
+// the wide accumulator and apply alpha, beta and saturation once per element.
+// 16-bit float inputs accumulate in fp32 and store C as TC: the input type,
+// or float to keep the fp32 result.
+template <typename T, typename TC = T>
+void gemm_blocked(bool trans_a, bool trans_b, int m, int n, int k, T alpha,
+                  const T *a, int lda, const T *b, int ldb, T beta, TC *c,
+                  int ldc, BlockSizes bs = BlockedTraits<T>::defaults()) {
+  using Traits = BlockedTraits<T>;
+  using PackType = typename Traits::PackType;
+  constexpr int MR = Traits::MR;
+  constexpr int NR = Traits::NR;
+
+  if (m <= 0 || n <= 0)
+    return;
+
+  // Strides of op(B) as (row, column) element steps
+  const size_t b_rs = trans_b ? 1 : size_t(ldb), b_cs = trans_b ? size_t(ldb) : 1;
+
+  // Round block sizes to whole micro-panels
+  int mc = std::max(MR, bs.mc / MR * MR);
+  int kc = std::max(1, bs.kc);
+  int nc = std::max(NR, bs.nc / NR * NR);
+
+  // One KC x NC block at a time, or the whole K x NC column block for the
+  // wide accumulators (see gemm_blocked_driver)
+  constexpr bool one_block = blocked_accumulates_in_c<T, TC>;
+  auto b_pack = make_aligned_buffer<PackType>(
+      size_t(nc) * (one_block ? kc : std::max(k, 1)));
+  gemm_blocked_driver<T, TC>(
+      trans_a, m, n, k, alpha, a, lda, beta, c, ldc, mc, kc, nc,
+      [&](int jc, int pc, int kc_cur, int nc_cur) {
+        MATMUL_PERF_SCOPE(std::string("blocked/") + element_type_name<T>() +
+                          "/pack");
+        PackType *block = b_pack.get() + (one_block ? 0 : size_t(pc) * nc);
+        pack_b_block<PackType, NR>(b + pc * b_rs + jc * b_cs, b_rs, b_cs,
+                                   kc_cur, nc_cur, block);
+        return static_cast<const PackType *>(block);
+      });
+}
+
+// C (a_rows x b_cols) = A (a_rows x a_cols) * B (a_cols x b_cols), row-major
+template <typename T>
+void matmul_blocked(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                    int b_cols, BlockSizes bs = BlockedTraits<T>::defaults()) {
+  gemm_blocked<T>(false, false, a_rows, b_cols, a_cols, T(1), a, a_cols, b,
+                  b_cols, T(0), c, b_cols, bs);
+}
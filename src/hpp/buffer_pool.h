@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Process-wide cache of 64-byte aligned buffers.
+//
+// Matrix storage and the packing buffers of the blocked driver are released
+// here instead of to malloc, keyed by their (64-byte rounded) size. The next
+// request of the same size reuses the block, so a benchmark or serving loop
+// that keeps producing same-shape temporaries stops hitting the allocator.
+// Cached memory is capped; blocks released past the cap are freed.
+class BufferPool {
+public:
+  static constexpr size_t alignment = 64;
+
+  // Never destroyed, so buffers freed during static destruction are safe
+  static BufferPool &instance() {
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+  }
+
+  void *acquire(size_t bytes) {
+    bytes = round_up(bytes);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = free_.find(bytes);
+      if (it != free_.end() && !it->second.empty()) {
+        void *p = it->second.back();
+        it->second.pop_back();
+        cached_bytes_ -= bytes;
+        return p;
+      }
+    }
+    void *p = std::aligned_alloc(alignment, bytes);
+    if (!p)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  void release(void *p, size_t bytes) {
+    if (!p)
+      return;
+    bytes = round_up(bytes);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (cached_bytes_ + bytes <= max_cached_bytes_) {
+        free_[bytes].push_back(p);
+        cached_bytes_ += bytes;
+        return;
+      }
+    }
+    std::free(p);
+  }
+
+  // Free every cached block
+  void trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &bucket : free_)
+      for (void *p : bucket.second)
+        std::free(p);
+    free_.clear();
+    cached_bytes_ = 0;
+  }
+
+  // Upper bound on memory kept for reuse (0 disables caching)
+  void set_max_cached_bytes(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      max_cached_bytes_ = bytes;
+      if (cached_bytes_ <= max_cached_bytes_)
+        return;
+    }
+    trim();
+  }
+
+  size_t cached_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+  }
+
+private:
+  BufferPool() = default;
+
+  static size_t round_up(size_t bytes) {
+    return bytes ? (bytes + alignment - 1) & ~(alignment - 1) : alignment;
+  }
+
+  mutable std::mutex mutex_;
+  std::unordered_map<size_t, std::vector<void *>> free_;
+  size_t cached_bytes_ = 0;
+  size_t max_cached_bytes_ = size_t(64) << 20;
+};
+
+// Standard allocator backed by BufferPool. Elements constructed without
+// arguments are default-initialized, so resizing a vector of a trivial type
+// leaves the new elements unset instead of zeroing them.
+template <typename T> struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U> PoolAllocator(const PoolAllocator<U> &) {}
+
+  T *allocate(size_t count) {
+    return static_cast<T *>(BufferPool::instance().acquire(count * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t count) {
+    BufferPool::instance().release(p, count * sizeof(T));
+  }
+
+  template <typename U> void construct(U *p) { ::new (static_cast<void *>(p)) U; }
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <typename U> bool operator==(const PoolAllocator<U> &) const {
+    return true;
+  }
+  template <typename U> bool operator!=(const PoolAllocator<U> &) const {
+    return false;
+  }
+};
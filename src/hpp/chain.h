@@ -0,0 +1,223 @@
+#pragma once
+
+#include "blocked.h"
+#include "matmul.h"
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Matrix chain products A0 * A1 * ... * An-1 (e.g. X * W1 * W2 * W3).
+//
+// A ChainPlan is built once for the operand shapes, given as n + 1
+// dimensions (Ai is dims[i] x dims[i + 1]). It picks the parenthesization
+// with the fewest multiply-adds by the classic O(n^3) dynamic program over
+// the dimensions, and lays the products out as a sequence of steps whose
+// intermediate results live in temporary buffers allocated with the plan. A
+// temporary is released as soon as its consumer has run, so a left-deep
+// chain ping-pongs between two buffers, and each buffer is sized for the
+// largest intermediate it ever holds. run() can then be called any number
+// of times with operands of those shapes, without allocating (except for
+// the returned result of the allocating overload).
+//
+// Float results depend on the order through rounding. Integer intermediates
+// are saturated to T after every product like matmul(), so different orders
+// agree only while nothing saturates; left_to_right() keeps the order of
+// repeated matmul() calls. A plan owns its buffers: use one per thread.
+
+template <typename T> class ChainPlan {
+public:
+  using Operands = std::vector<std::reference_wrapper<const Matrix<T>>>;
+
+  // Cheapest order for operands of shapes dims[i] x dims[i + 1]
+  explicit ChainPlan(std::vector<size_t> dims,
+                     MatMulImpl impl = MatMulImpl::AUTO, int vlen = 0)
+      : ChainPlan(std::move(dims), impl, vlen, false) {}
+
+  // Plain left-to-right order: ((A0 A1) A2) ...
+  static ChainPlan left_to_right(std::vector<size_t> dims,
+                                 MatMulImpl impl = MatMulImpl::AUTO,
+                                 int vlen = 0) {
+    return ChainPlan(std::move(dims), impl, vlen, true);
+  }
+
+  // Shapes of the operands of a chain, for the constructors
+  static std::vector<size_t> dims_of(const Operands &operands) {
+    if (operands.empty())
+      throw std::invalid_argument("Matrix chain needs at least one operand");
+    std::vector<size_t> dims = {operands.front().get().rows()};
+    for (const Matrix<T> &op : operands)
+      dims.push_back(op.cols());
+    return dims;
+  }
+
+  // Result = A0 * A1 * ... into a preallocated dims.front() x dims.back()
+  // matrix
+  void run(const Operands &operands, Matrix<T> &result) {
+    check_operands(operands);
+    if (result.rows() != dims_.front() || result.cols() != dims_.back())
+      throw std::invalid_argument("Result matrix has the wrong shape");
+
+    if (steps_.empty()) { // a single operand
+      const Matrix<T> &only = operands.front();
+      for (size_t i = 0; i < only.rows(); ++i)
+        for (size_t j = 0; j < only.cols(); ++j)
+          result.at(i, j) = only.at(i, j);
+      return;
+    }
+
+    for (const Step &step : steps_) {
+      Operand lhs = operand(operands, step.lhs, step.k);
+      Operand rhs = operand(operands, step.rhs, step.n);
+      T *out = step.out < 0 ? result.data() : buffers_[step.out].get();
+      int ldc = step.out < 0 ? int(result.stride()) : int(step.n);
+      matmul_strided(lhs.data, lhs.ld, rhs.data, rhs.ld, out, ldc,
+                     int(step.m), int(step.k), int(step.n), impl_, vlen_);
+    }
+  }
+
+  Matrix<T> run(const Operands &operands) {
+    Matrix<T> result(dims_.front(), dims_.back(),
+                     typename Matrix<T>::Uninitialized{});
+    run(operands, result);
+    return result;
+  }
+
+  // Multiply-adds of the planned order, and of plain left to right
+  double macs() const { return macs_; }
+  double left_to_right_macs() const {
+    double total = 0.0;
+    for (size_t j = 2; j < dims_.size(); ++j)
+      total += double(dims_[0]) * double(dims_[j - 1]) * double(dims_[j]);
+    return total;
+  }
+
+  size_t num_operands() const { return dims_.size() - 1; }
+  size_t num_buffers() const { return buffers_.size(); }
+
+  // Parenthesization, e.g. "((A0 A1) (A2 A3))"
+  std::string to_string() const { return order_; }
+
+private:
+  struct Step {
+    int lhs, rhs; // operand index, or -1 - buffer for an intermediate
+    int out;      // buffer index, or -1 for the result
+    size_t m, k, n;
+  };
+
+  struct Operand {
+    const T *data;
+    int ld;
+  };
+
+  ChainPlan(std::vector<size_t> dims, MatMulImpl impl, int vlen,
+            bool left_to_right)
+      : dims_(std::move(dims)), impl_(impl), vlen_(vlen) {
+    if (dims_.size() < 2)
+      throw std::invalid_argument("Matrix chain needs at least one operand");
+    const size_t n = dims_.size() - 1;
+
+    // cost[i][j]: fewest multiply-adds for Ai..Aj, split[i][j]: the last
+    // product is (Ai..As) (As+1..Aj)
+    std::vector<std::vector<double>> cost(n, std::vector<double>(n, 0.0));
+    std::vector<std::vector<size_t>> split(n, std::vector<size_t>(n, 0));
+    for (size_t len = 2; len <= n; ++len) {
+      for (size_t i = 0; i + len <= n; ++i) {
+        const size_t j = i + len - 1;
+        cost[i][j] = std::numeric_limits<double>::infinity();
+        for (size_t s = left_to_right ? j - 1 : i; s < j; ++s) {
+          double c = cost[i][s] + cost[s + 1][j] +
+                     double(dims_[i]) * double(dims_[s + 1]) *
+                         double(dims_[j + 1]);
+          if (c < cost[i][j]) {
+            cost[i][j] = c;
+            split[i][j] = s;
+          }
+        }
+      }
+    }
+    macs_ = cost[0][n - 1];
+
+    std::vector<size_t> buffer_sizes;
+    std::vector<int> free_buffers;
+    emit(split, 0, n - 1, true, buffer_sizes, free_buffers);
+    for (size_t size : buffer_sizes)
+      buffers_.push_back(make_aligned_buffer<T>(size));
+  }
+
+  // Append the steps computing Ai..Aj in post-order. Returns the operand
+  // holding the product: an input, or -1 - buffer for an intermediate.
+  int emit(const std::vector<std::vector<size_t>> &split, size_t i, size_t j,
+           bool root, std::vector<size_t> &buffer_sizes,
+           std::vector<int> &free_buffers) {
+    if (i == j) {
+      order_ += "A" + std::to_string(i);
+      return int(i);
+    }
+    const size_t s = split[i][j];
+    order_ += "(";
+    int lhs = emit(split, i, s, false, buffer_sizes, free_buffers);
+    order_ += " ";
+    int rhs = emit(split, s + 1, j, false, buffer_sizes, free_buffers);
+    order_ += ")";
+
+    // Inputs are still live here, so the output never aliases them
+    Step step{lhs, rhs, -1, dims_[i], dims_[s + 1], dims_[j + 1]};
+    if (!root) {
+      if (free_buffers.empty()) {
+        free_buffers.push_back(int(buffer_sizes.size()));
+        buffer_sizes.push_back(0);
+      }
+      step.out = free_buffers.back();
+      free_buffers.pop_back();
+      buffer_sizes[step.out] =
+          std::max(buffer_sizes[step.out], step.m * step.n);
+    }
+    for (int input : {lhs, rhs})
+      if (input < 0)
+        free_buffers.push_back(-1 - input);
+    steps_.push_back(step);
+    return step.out < 0 ? -1 : -1 - step.out;
+  }
+
+  void check_operands(const Operands &operands) const {
+    if (operands.size() != num_operands())
+      throw std::invalid_argument("Matrix chain has the wrong operand count");
+    for (size_t i = 0; i < operands.size(); ++i) {
+      const Matrix<T> &op = operands[i];
+      if (op.rows() != dims_[i] || op.cols() != dims_[i + 1])
+        throw std::invalid_argument("Matrix chain operand " +
+                                    std::to_string(i) +
+                                    " does not match the planned shape");
+    }
+  }
+
+  // Input index, or intermediate with cols columns stored densely
+  Operand operand(const Operands &operands, int index, size_t cols) const {
+    if (index >= 0) {
+      const Matrix<T> &op = operands[index];
+      return {op.data(), int(op.stride())};
+    }
+    return {buffers_[-1 - index].get(), int(cols)};
+  }
+
+  std::vector<size_t> dims_;
+  MatMulImpl impl_;
+  int vlen_;
+  double macs_ = 0.0;
+  std::vector<Step> steps_;
+  std::vector<std::unique_ptr<T[], AlignedFree>> buffers_;
+  std::string order_;
+};
+
+// One-off chain product in the cheapest order, e.g.
+// matmul_chain<float>({x, w1, w2, w3})
+template <typename T>
+Matrix<T> matmul_chain(const typename ChainPlan<T>::Operands &operands,
+                       MatMulImpl impl = MatMulImpl::AUTO, int vlen = 0) {
+  return ChainPlan<T>(ChainPlan<T>::dims_of(operands), impl, vlen)
+      .run(operands);
+}
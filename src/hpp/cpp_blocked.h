@@ -0,0 +1,184 @@
+#pragma once
+
+#include "blocked.h"
+#include "matrix.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+// Portable cache-blocked C++ engine (MatMulImpl::CPP_BLOCKED).
+//
+//   for jc in N step NC      B block (KC x NC) packed row-major, lives in L2
+//     for pc in K step KC
+//       for i in M step MR   MR rows of C updated together
+//         for p in KC          one element of A per row, broadcast
+//           for j in NC          C[i][j] += A[i][p] * B[p][j]
+//
+// The innermost loop is i-k-j: unit stride over a packed row of B and MR
+// __restrict rows of accumulators, which compilers auto-vectorize on any
+// target, and each B element loaded feeds MR multiply-adds. Tile sizes are
+// compile-time constants of CppBlockedTraits. Integer types accumulate into
+// a wide buffer and saturate once at the end like matmul_cpp_naive; fp16 /
+// bf16 are widened to fp32 while packing. Works for any arithmetic element
+// type, so it is also the fallback for types without assembly kernels.
+
+template <typename T> struct CppBlockedTraits {
+  // Element type of the packed B block and of the A values
+  using PackType = std::conditional_t<is_half_float_v<T>, float, T>;
+  using AccumulatorType = accumulator_t<T>;
+  static constexpr int MR = 4;   // rows of C per register tile
+  static constexpr int KC = 256; // depth of a packed B block
+  static constexpr int NC = 256; // columns of a packed B block
+};
+
+// acc[r][0:nc] += alpha * a[r][p] * b[p][0:nc] for MR rows r and p in
+// [0, kc). Element (r, p) of A is a[r * rs + p * cs]; b is packed kc x nc.
+template <typename T, int MR,
+          typename PackType = typename CppBlockedTraits<T>::PackType,
+          typename AccumulatorType = typename CppBlockedTraits<T>::AccumulatorType>
+inline void cpp_blocked_tile(const T *a, size_t rs, size_t cs,
+                             const PackType *b, int kc, int nc,
+                             AccumulatorType *acc, int ld_acc,
+                             PackType alpha) {
+  AccumulatorType *__restrict c[MR];
+  for (int r = 0; r < MR; ++r)
+    c[r] = acc + size_t(r) * ld_acc;
+
+  for (int p = 0; p < kc; ++p) {
+    const PackType *__restrict b_row = b + size_t(p) * nc;
+    AccumulatorType a_rp[MR];
+    for (int r = 0; r < MR; ++r)
+      a_rp[r] = AccumulatorType(alpha * PackType(a[r * rs + p * cs]));
+
+    if constexpr (MR == 4) {
+      AccumulatorType *__restrict c0 = c[0];
+      AccumulatorType *__restrict c1 = c[1];
+      AccumulatorType *__restrict c2 = c[2];
+      AccumulatorType *__restrict c3 = c[3];
+      for (int j = 0; j < nc; ++j) {
+        AccumulatorType b_pj = AccumulatorType(b_row[j]);
+        c0[j] += a_rp[0] * b_pj;
+        c1[j] += a_rp[1] * b_pj;
+        c2[j] += a_rp[2] * b_pj;
+        c3[j] += a_rp[3] * b_pj;
+      }
+    } else {
+      for (int r = 0; r < MR; ++r) {
+        AccumulatorType *__restrict c_r = c[r];
+        for (int j = 0; j < nc; ++j)
+          c_r[j] += a_rp[r] * AccumulatorType(b_row[j]);
+      }
+    }
+  }
+}
+
+// C = alpha * op(A) * op(B) + beta * C, where op(A) is m x k, op(B) is k x n
+// and every matrix is row-major with its own leading dimension (same
+// contract as gemm_blocked). With beta == 0, C is not read. C may be float
+// when A and B are 16-bit floats.
+template <typename T, typename TC = T>
+void gemm_cpp_blocked(bool trans_a, bool trans_b, int m, int n, int k, T alpha,
+                      const T *a, int lda, const T *b, int ldb, T beta, TC *c,
+                      int ldc) {
+  using Traits = CppBlockedTraits<T>;
+  using PackType = typename Traits::PackType;
+  using AccumulatorType = typename Traits::AccumulatorType;
+  using EpilogueType =
+      std::conditional_t<std::is_integral_v<T>, int64_t, AccumulatorType>;
+  constexpr int MR = Traits::MR;
+  constexpr int KC = Traits::KC;
+  constexpr int NC = Traits::NC;
+  constexpr bool accumulate_in_c = std::is_same_v<AccumulatorType, TC>;
+
+  if (m <= 0 || n <= 0)
+    return;
+
+  const size_t a_rs = trans_a ? 1 : size_t(lda), a_cs = trans_a ? size_t(lda) : 1;
+  const size_t b_rs = trans_b ? 1 : size_t(ldb), b_cs = trans_b ? size_t(ldb) : 1;
+
+  auto b_pack = make_aligned_buffer<PackType>(size_t(KC) * NC);
+  std::unique_ptr<AccumulatorType[], AlignedFree> acc;
+  if constexpr (accumulate_in_c) {
+    // Apply beta up front; the tiles then add alpha * A * B into C
+    for (int i = 0; i < m; ++i) {
+      TC *row = c + size_t(i) * ldc;
+      if (beta == T(0))
+        std::fill(row, row + n, TC(0));
+      else if (beta != T(1))
+        for (int j = 0; j < n; ++j)
+          row[j] *= TC(beta);
+    }
+  } else {
+    acc = make_aligned_buffer<AccumulatorType>(size_t(m) * NC);
+  }
+
+  for (int jc = 0; jc < n; jc += NC) {
+    const int nc = std::min(NC, n - jc);
+
+    AccumulatorType *c_block;
+    int ld_block;
+    if constexpr (accumulate_in_c) {
+      c_block = c + jc;
+      ld_block = ldc;
+    } else {
+      c_block = acc.get();
+      ld_block = nc;
+      std::fill(c_block, c_block + size_t(m) * nc, AccumulatorType(0));
+    }
+
+    for (int pc = 0; pc < k; pc += KC) {
+      const int kc = std::min(KC, k - pc);
+      {
+        MATMUL_PERF_SCOPE(std::string("cpp_blocked/") +
+                          element_type_name<T>() + "/pack");
+        for (int p = 0; p < kc; ++p) {
+          const T *src = b + (pc + p) * b_rs + jc * b_cs;
+          PackType *dst = b_pack.get() + size_t(p) * nc;
+          for (int j = 0; j < nc; ++j)
+            dst[j] = PackType(src[j * b_cs]);
+        }
+      }
+
+      MATMUL_PERF_SCOPE(std::string("cpp_blocked/") + element_type_name<T>() +
+                            "/compute",
+                        2.0 * m * nc * kc);
+      const PackType scale = accumulate_in_c ? PackType(alpha) : PackType(1);
+      const T *a_block = a + pc * a_cs;
+      int i = 0;
+      for (; i + MR <= m; i += MR)
+        cpp_blocked_tile<T, MR>(a_block + i * a_rs, a_rs, a_cs, b_pack.get(),
+                                kc, nc, c_block + size_t(i) * ld_block,
+                                ld_block, scale);
+      for (; i < m; ++i)
+        cpp_blocked_tile<T, 1>(a_block + i * a_rs, a_rs, a_cs, b_pack.get(),
+                               kc, nc, c_block + size_t(i) * ld_block,
+                               ld_block, scale);
+    }
+
+    // Scale and saturate the wide accumulators into this column block of C
+    if constexpr (!accumulate_in_c) {
+      for (int i = 0; i < m; ++i) {
+        const AccumulatorType *acc_row = c_block + size_t(i) * ld_block;
+        TC *c_row = c + size_t(i) * ldc + jc;
+        for (int j = 0; j < nc; ++j) {
+          EpilogueType value = EpilogueType(alpha) * EpilogueType(acc_row[j]);
+          if (beta != T(0))
+            value += EpilogueType(beta) * EpilogueType(c_row[j]);
+          c_row[j] = clamp_int<TC, EpilogueType>(value);
+        }
+      }
+    }
+  }
+}
+
+// C (a_rows x b_cols) = A (a_rows x a_cols) * B (a_cols x b_cols), row-major
+template <typename T>
+void matmul_cpp_blocked(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                        int b_cols) {
+  gemm_cpp_blocked<T>(false, false, a_rows, b_cols, a_cols, T(1), a,
+                      std::max(1, a_cols), b, std::max(1, b_cols), T(0), c,
+                      std::max(1, b_cols));
+}
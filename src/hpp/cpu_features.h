@@ -0,0 +1,94 @@
+#pragma once
+
+#include <csetjmp>
+#include <csignal>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+// Runtime CPU feature detection.
+//
+// Read once, on first use: the ISA string of /proc/cpuinfo, the V bit of
+// AT_HWCAP and, by running one vector instruction under a SIGILL handler,
+// whether the vector unit really executes and its VLEN. The kernel-reported
+// strings are informational (older kernels and QEMU disagree about what they
+// list); the probes decide. Vendor extensions (IME, Zvfh, Zvfbfwma) are probed
+// the same way by ime_available() and half_vector_available(), and only when
+// the vector unit is present. Host builds (MATMUL_HOST_BUILD) have no vector
+// unit to probe and report none.
+
+#ifndef MATMUL_HOST_BUILD
+extern "C" long matmul_asm_vlenb_probe();
+#endif
+
+inline sigjmp_buf &sigill_probe_env() {
+  static sigjmp_buf env;
+  return env;
+}
+
+inline void sigill_probe_handler(int) { siglongjmp(sigill_probe_env(), 1); }
+
+// Runs probe() under a temporary SIGILL handler. Returns its result, or
+// nothing if it trapped.
+inline std::optional<long> sigill_probe(long (*probe)()) {
+  struct sigaction action = {}, previous = {};
+  action.sa_handler = sigill_probe_handler;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGILL, &action, &previous);
+
+  std::optional<long> result;
+  if (sigsetjmp(sigill_probe_env(), 1) == 0)
+    result = probe();
+
+  sigaction(SIGILL, &previous, nullptr);
+  return result;
+}
+
+// ISA string of the first hart ("isa : rv64imafdcv_zicbom_..."), empty when
+// /proc/cpuinfo has none (non-RISC-V hosts, some emulators)
+inline std::string read_cpuinfo_isa(const std::string &path = "/proc/cpuinfo") {
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string key, colon, value;
+    if (fields >> key >> colon >> value && key == "isa" && colon == ":")
+      return value;
+  }
+  return "";
+}
+
+struct CpuFeatures {
+  std::string isa;      // ISA string from /proc/cpuinfo, may be empty
+  bool hwcap_v = false; // the kernel reports V in AT_HWCAP
+  bool rvv = false;     // vector instructions execute
+  int vlenb = 0;        // VLEN / 8, 0 without a vector unit
+
+  int vlen_bits() const { return vlenb * 8; }
+};
+
+inline CpuFeatures detect_cpu_features() {
+  CpuFeatures features;
+  features.isa = read_cpuinfo_isa();
+#if defined(__linux__) && defined(__riscv)
+  features.hwcap_v = (getauxval(AT_HWCAP) & (1UL << ('V' - 'A'))) != 0;
+#endif
+#ifndef MATMUL_HOST_BUILD
+  if (std::optional<long> vlenb = sigill_probe(matmul_asm_vlenb_probe)) {
+    features.rvv = *vlenb > 0;
+    features.vlenb = int(*vlenb);
+  }
+#endif
+  return features;
+}
+
+// Features of the core this process runs on, detected once
+inline const CpuFeatures &cpu_features() {
+  static const CpuFeatures features = detect_cpu_features();
+  return features;
+}
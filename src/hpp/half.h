@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// 16-bit floating point element types: IEEE binary16 (float16) and bfloat16.
+//
+// Both are storage formats. Arithmetic goes through float: the types convert
+// implicitly to float and explicitly from it (round to nearest even), so the
+// C++ reference and the packing routines accumulate in fp32 like the RVV
+// kernels do. On cores with Zfhmin the compiler converts float16 in
+// hardware; otherwise, and always for bfloat16 (its conversions are a
+// shift and a rounding add), the conversions below run in software.
+
+inline float half_bits_to_float(uint16_t h) {
+#if defined(__riscv_zfhmin) || defined(__riscv_zfh)
+  _Float16 value;
+  std::memcpy(&value, &h, sizeof(value));
+  return float(value);
+#else
+  uint32_t sign = uint32_t(h & 0x8000) << 16;
+  uint32_t exponent = (h >> 10) & 0x1f;
+  uint32_t mantissa = h & 0x3ff;
+  uint32_t bits;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13); // inf / NaN
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign; // signed zero
+  } else {
+    // Subnormal: mantissa * 2^-24 is exact in float
+    float value = float(mantissa) * (1.0f / 16777216.0f);
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits |= sign;
+  }
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+#endif
+}
+
+inline uint16_t float_to_half_bits(float f) {
+#if defined(__riscv_zfhmin) || defined(__riscv_zfh)
+  _Float16 value = static_cast<_Float16>(f);
+  uint16_t h;
+  std::memcpy(&h, &value, sizeof(h));
+  return h;
+#else
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+  uint32_t abs = bits & 0x7fffffff;
+
+  if (abs > 0x7f800000) // NaN: keep it quiet and non-zero
+    return uint16_t(sign | 0x7e00 | ((abs >> 13) & 0x3ff));
+  if (abs >= 0x477ff000) // rounds to >= 65520: overflow to infinity
+    return uint16_t(sign | 0x7c00);
+  if (abs < 0x38800000) {
+    // Result is subnormal (or zero): scale so the rounding of the float
+    // addition lands on the 2^-24 grid, round to nearest even for free
+    float scaled;
+    uint32_t abs_bits = abs;
+    std::memcpy(&scaled, &abs_bits, sizeof(scaled));
+    scaled += 0.5f;
+    uint32_t scaled_bits;
+    std::memcpy(&scaled_bits, &scaled, sizeof(scaled_bits));
+    return uint16_t(sign | (scaled_bits - 0x3f000000));
+  }
+  // Normal: rebias the exponent and round the 13 dropped bits to even
+  uint32_t rounded = abs + 0xfff + ((abs >> 13) & 1);
+  return uint16_t(sign | ((rounded - 0x38000000) >> 13));
+#endif
+}
+
+inline float bfloat16_bits_to_float(uint16_t h) {
+  uint32_t bits = uint32_t(h) << 16;
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline uint16_t float_to_bfloat16_bits(float f) {
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  if ((bits & 0x7fffffff) > 0x7f800000) // NaN: keep it quiet
+    return uint16_t((bits >> 16) | 0x40);
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return uint16_t(bits >> 16);
+}
+
+// IEEE 754 binary16: 1 sign, 5 exponent and 10 mantissa bits
+struct float16 {
+  uint16_t bits = 0;
+
+  float16() = default;
+  explicit float16(float value) : bits(float_to_half_bits(value)) {}
+  operator float() const { return half_bits_to_float(bits); }
+
+  static float16 from_bits(uint16_t bits) {
+    float16 h;
+    h.bits = bits;
+    return h;
+  }
+};
+
+// bfloat16: the upper half of an fp32 (1 sign, 8 exponent, 7 mantissa bits)
+struct bfloat16 {
+  uint16_t bits = 0;
+
+  bfloat16() = default;
+  explicit bfloat16(float value) : bits(float_to_bfloat16_bits(value)) {}
+  operator float() const { return bfloat16_bits_to_float(bits); }
+
+  static bfloat16 from_bits(uint16_t bits) {
+    bfloat16 h;
+    h.bits = bits;
+    return h;
+  }
+};
+
+static_assert(sizeof(float16) == 2 && sizeof(bfloat16) == 2,
+              "16-bit float types must be two bytes");
+
+template <typename T>
+inline constexpr bool is_half_float_v =
+    std::is_same_v<T, float16> || std::is_same_v<T, bfloat16>;
+
+// float, double and the 16-bit storage types
+template <typename T>
+inline constexpr bool is_floating_element_v =
+    std::is_floating_point_v<T> || is_half_float_v<T>;
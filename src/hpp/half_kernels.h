@@ -0,0 +1,82 @@
+#pragma once
+
+#include "cpu_features.h"
+#include "half.h"
+#include <optional>
+#include <type_traits>
+
+// RVV kernels for the 16-bit float types (fp16 with Zvfh, bf16 with
+// Zvfbfwma). Both widen their inputs into fp32 accumulators inside the
+// vector unit and store C as fp32 or rounded back to the input type. They
+// are built only when the assembler accepts the extension
+// (MATMUL_HAVE_ZVFH / MATMUL_HAVE_ZVFBFWMA) and used only when a SIGILL
+// probe shows the core executes it; otherwise the blocked driver widens the
+// operands in software while packing (see blocked.h).
+
+#ifdef MATMUL_HAVE_ZVFH
+extern "C" {
+void matmul_asm_vector_fp16(const float16 *a, const float16 *b, void *c,
+                            int a_rows, int a_cols, int b_cols, int c_fp32);
+
+long matmul_asm_zvfh_probe();
+}
+#endif
+
+#ifdef MATMUL_HAVE_ZVFBFWMA
+extern "C" {
+void matmul_asm_vector_bf16(const bfloat16 *a, const bfloat16 *b, void *c,
+                            int a_rows, int a_cols, int b_cols, int c_fp32);
+
+long matmul_asm_zvfbfwma_probe();
+}
+#endif
+
+// Runs probe() under a temporary SIGILL handler; true if it returned non-zero.
+// Cores without a vector unit are not probed.
+inline bool half_probe(long (*probe)()) {
+  if (!cpu_features().rvv)
+    return false;
+  std::optional<long> ok = sigill_probe(probe);
+  return ok && *ok != 0;
+}
+
+// True when the widening vector kernel for T is built and runs on this core.
+// Each probe runs once.
+template <typename T> inline bool half_vector_available() {
+  if constexpr (std::is_same_v<T, float16>) {
+#ifdef MATMUL_HAVE_ZVFH
+    static const bool available = half_probe(matmul_asm_zvfh_probe);
+    return available;
+#endif
+  } else if constexpr (std::is_same_v<T, bfloat16>) {
+#ifdef MATMUL_HAVE_ZVFBFWMA
+    static const bool available = half_probe(matmul_asm_zvfbfwma_probe);
+    return available;
+#endif
+  }
+  return false;
+}
+
+// C (a_rows x b_cols, fp32 if TC is float, else T) = A * B on dense
+// row-major operands. Only call when half_vector_available<T>() is true.
+template <typename T, typename TC>
+inline void matmul_vector_half([[maybe_unused]] const T *a,
+                               [[maybe_unused]] const T *b,
+                               [[maybe_unused]] TC *c,
+                               [[maybe_unused]] int a_rows,
+                               [[maybe_unused]] int a_cols,
+                               [[maybe_unused]] int b_cols) {
+  static_assert(is_half_float_v<T> &&
+                    (std::is_same_v<TC, T> || std::is_same_v<TC, float>),
+                "16-bit float kernels store fp32 or the input type");
+  [[maybe_unused]] constexpr int c_fp32 = std::is_same_v<TC, float>;
+  if constexpr (std::is_same_v<T, float16>) {
+#ifdef MATMUL_HAVE_ZVFH
+    matmul_asm_vector_fp16(a, b, c, a_rows, a_cols, b_cols, c_fp32);
+#endif
+  } else {
+#ifdef MATMUL_HAVE_ZVFBFWMA
+    matmul_asm_vector_bf16(a, b, c, a_rows, a_cols, b_cols, c_fp32);
+#endif
+  }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "blocked.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+// SpacemiT IME (Integrated Matrix Extension) int8 backend.
+//
+// vmadot multiplies a 4 x 8 int8 tile by an 8 x 4 int8 tile into a 4 x 4
+// int32 tile, with the operands held in single 256-bit vector registers. The
+// kernel wants both matrices re-laid out into those tiles:
+//
+//   A: per 4-row strip, per 8-deep k tile, 32 bytes row-major (4 x 8)
+//   B: per 16-column block, per k tile, four 32-byte tiles each holding
+//      4 columns of 8 consecutive k values (the tile transposed)
+//
+// Strips, blocks and k tiles past the matrix edge are zero-padded, so the
+// kernel never sees a partial tile. Cores without IME (or VLEN != 256, e.g.
+// plain QEMU) are detected at runtime and fall back to the RVV kernels.
+
+#ifdef MATMUL_HAVE_IME
+extern "C" {
+void matmul_asm_ime_int8(const int8_t *a_pack, const int8_t *b_pack, int8_t *c,
+                         int m_strips, int n_blocks, int k_tiles, int int_min,
+                         int int_max, int ldc);
+
+long matmul_asm_ime_probe();
+}
+#endif
+
+// Tile geometry of the int8 vmadot kernel
+struct ImeInt8Traits {
+  static constexpr int MR = 4;     // rows per A tile / C strip
+  static constexpr int KT = 8;     // k values per tile
+  static constexpr int NR = 16;    // columns per C block (four 4-wide tiles)
+  static constexpr int VLENB = 32; // register width the tile format assumes
+};
+
+// True when vmadot executes and VLEN matches the tile format. The probe runs
+// once, under a temporary SIGILL handler, and only on cores with a vector unit.
+inline bool ime_available() {
+#ifdef MATMUL_HAVE_IME
+  static const bool available = [] {
+    if (!cpu_features().rvv)
+      return false;
+    std::optional<long> vlenb = sigill_probe(matmul_asm_ime_probe);
+    return vlenb && *vlenb == ImeInt8Traits::VLENB;
+  }();
+  return available;
+#else
+  return false;
+#endif
+}
+
+// Pack A (rows x cols, row-major, rows lda apart) into 4 x 8 tiles, strip by
+// strip
+inline void pack_ime_a(const int8_t *a, int rows, int cols, size_t lda,
+                       int8_t *pack) {
+  constexpr int MR = ImeInt8Traits::MR, KT = ImeInt8Traits::KT;
+  for (int i0 = 0; i0 < rows; i0 += MR) {
+    for (int k0 = 0; k0 < cols; k0 += KT) {
+      for (int r = 0; r < MR; ++r)
+        for (int kk = 0; kk < KT; ++kk) {
+          int i = i0 + r, k = k0 + kk;
+          *pack++ = (i < rows && k < cols) ? a[size_t(i) * lda + k] : 0;
+        }
+    }
+  }
+}
+
+// Pack B (rows x cols, row-major, rows ldb apart) into transposed 8 x 4
+// tiles, four per 16-column block and k tile
+inline void pack_ime_b(const int8_t *b, int rows, int cols, size_t ldb,
+                       int8_t *pack) {
+  constexpr int KT = ImeInt8Traits::KT, NR = ImeInt8Traits::NR;
+  for (int j0 = 0; j0 < cols; j0 += NR) {
+    for (int k0 = 0; k0 < rows; k0 += KT) {
+      for (int c = 0; c < NR; ++c)
+        for (int kk = 0; kk < KT; ++kk) {
+          int j = j0 + c, k = k0 + kk;
+          *pack++ = (j < cols && k < rows) ? b[size_t(k) * ldb + j] : 0;
+        }
+    }
+  }
+}
+
+// Bytes of B (rows x cols) in the tile order of pack_ime_b
+inline size_t ime_b_pack_size(int rows, int cols) {
+  constexpr int KT = ImeInt8Traits::KT, NR = ImeInt8Traits::NR;
+  return size_t((rows + KT - 1) / KT * KT) * size_t((cols + NR - 1) / NR * NR);
+}
+
+#ifdef MATMUL_HAVE_IME
+// C (a_rows x b_cols, rows ldc apart) = A (rows lda apart) * B, with B
+// already in pack_ime_b order (e.g. a PackedMatrix, see packed.h), int32
+// accumulation and saturation to [int_min, int_max]. Only call when
+// ime_available() is true.
+inline void matmul_ime_int8_packed(const int8_t *a, size_t lda,
+                                   const int8_t *b_pack, int8_t *c, size_t ldc,
+                                   int a_rows, int a_cols, int b_cols,
+                                   int int_min, int int_max) {
+  using Traits = ImeInt8Traits;
+  if (a_rows <= 0 || b_cols <= 0)
+    return;
+
+  int m_strips = (a_rows + Traits::MR - 1) / Traits::MR;
+  int n_blocks = (b_cols + Traits::NR - 1) / Traits::NR;
+  int k_tiles = (a_cols + Traits::KT - 1) / Traits::KT;
+  int m_pad = m_strips * Traits::MR;
+  int n_pad = n_blocks * Traits::NR;
+  int k_pad = k_tiles * Traits::KT;
+
+  auto a_pack = make_aligned_buffer<int8_t>(size_t(m_pad) * k_pad);
+  {
+    MATMUL_PERF_SCOPE("ime/int8/pack");
+    pack_ime_a(a, a_rows, a_cols, lda, a_pack.get());
+  }
+
+  // Clamping and narrowing are fused into the kernel, so compute covers the
+  // epilogue too
+  MATMUL_PERF_SCOPE("ime/int8/compute", 2.0 * m_pad * n_pad * k_pad);
+
+  // The kernel writes whole 4 x 16 blocks with 32-bit stores; go through a
+  // padded buffer unless C already has that shape and alignment.
+  bool direct = m_pad == a_rows && n_pad == b_cols && ldc % 4 == 0 &&
+                reinterpret_cast<uintptr_t>(c) % 4 == 0;
+  if (direct) {
+    matmul_asm_ime_int8(a_pack.get(), b_pack, c, m_strips, n_blocks, k_tiles,
+                        int_min, int_max, int(ldc));
+    return;
+  }
+
+  auto c_pad = make_aligned_buffer<int8_t>(size_t(m_pad) * n_pad);
+  matmul_asm_ime_int8(a_pack.get(), b_pack, c_pad.get(), m_strips, n_blocks,
+                      k_tiles, int_min, int_max, n_pad);
+  for (int i = 0; i < a_rows; ++i)
+    std::copy_n(c_pad.get() + size_t(i) * n_pad, b_cols,
+                c + size_t(i) * ldc);
+}
+
+// C (a_rows x b_cols) = A * B with int32 accumulation and saturation to
+// [int_min, int_max]. Only call when ime_available() is true.
+inline void matmul_ime_int8(const int8_t *a, const int8_t *b, int8_t *c,
+                            int a_rows, int a_cols, int b_cols, int int_min,
+                            int int_max) {
+  if (a_rows <= 0 || b_cols <= 0)
+    return;
+
+  auto b_pack = make_aligned_buffer<int8_t>(ime_b_pack_size(a_cols, b_cols));
+  {
+    MATMUL_PERF_SCOPE("ime/int8/pack");
+    pack_ime_b(b, a_cols, b_cols, b_cols, b_pack.get());
+  }
+  matmul_ime_int8_packed(a, a_cols, b_pack.get(), c, b_cols, a_rows, a_cols,
+                         b_cols, int_min, int_max);
+}
+#endif
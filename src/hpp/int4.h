@@ -0,0 +1,250 @@
+#pragma once
+
+#include "matmul.h"
+#include "matrix.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// int4 weight-only quantized GEMM, for decode-phase GEMV where streaming the
+// weights is the bottleneck: 4-bit weights move half the bytes of int8.
+//
+// Int4Matrix holds weights W (k x n) as symmetric 4-bit values with one fp32
+// scale per group of group_size consecutive rows and column:
+//
+//   W[p][j] ~ Q[p][j] * scale[p / group_size][j],  Q in [-8, 7]
+//
+// Rows are packed in pairs, low nibble first: byte (p / 2, j) holds Q[p][j]
+// in bits 0-3 and Q[p + 1][j] in bits 4-7 (zero past the last row). The
+// kernels load a run of bytes at unit stride and get two weight rows of as
+// many columns, unpacked in registers with two shifts.
+//
+// matmul_int4 multiplies activations A (m x k) by such weights into fp32 C:
+//
+//   float A           each nibble row is dequantized once per strip and
+//                     multiply-added into fp32 accumulators
+//   fp16 / bf16 A     widened to fp32, then as float
+//   int8 A            with per-row (or per-tensor) scales, see
+//                     quantize_activations: int32 accumulators per group
+//                     (int8 x int4 products, vwmacc), each group folded into
+//                     fp32 with its column scales, times the row scale
+//
+// matmul_int4_cpp_naive dequantizes A and W and runs the C++ reference, the
+// ground truth for validation; kernel results differ from it by rounding
+// only (fused multiply-adds, per-group partial sums).
+
+extern "C" {
+// C (fp32) = diag(a_scale) * A (int8) * dequant(Q)
+void matmul_asm_int4_int8(const int8_t *a, int lda, const float *a_scale,
+                          const uint8_t *b, const float *scales, float *c,
+                          int ldc, int a_rows, int a_cols, int b_cols,
+                          int group_size, int vlen);
+
+// C (fp32) = A (fp32) * dequant(Q)
+void matmul_asm_int4_float(const float *a, int lda, const uint8_t *b,
+                           const float *scales, float *c, int ldc, int a_rows,
+                           int a_cols, int b_cols, int group_size, int vlen);
+}
+
+class Int4Matrix {
+public:
+  Int4Matrix() = default;
+
+  // Symmetric per-group quantization: scale = max |w| / 7 over each group
+  // of group_size rows of a column, Q = round(w / scale). group_size must be
+  // even, so a byte's two rows always share a group.
+  static Int4Matrix quantize(const Matrix<float> &w, int group_size = 32) {
+    if (group_size < 2 || group_size % 2 != 0)
+      throw std::invalid_argument("int4 group size must be even and >= 2");
+
+    Int4Matrix q;
+    q.rows_ = w.rows();
+    q.cols_ = w.cols();
+    q.group_size_ = group_size;
+    q.data_.assign((q.rows_ + 1) / 2 * q.cols_, 0);
+    q.scales_.assign(q.num_groups() * q.cols_, 0.0f);
+
+    for (size_t g = 0; g < q.num_groups(); ++g) {
+      const size_t p0 = g * group_size;
+      const size_t p1 = std::min(q.rows_, p0 + group_size);
+      for (size_t j = 0; j < q.cols_; ++j) {
+        float max_abs = 0.0f;
+        for (size_t p = p0; p < p1; ++p)
+          max_abs = std::max(max_abs, std::fabs(w.at(p, j)));
+        const float scale = max_abs / 7.0f;
+        q.scales_[g * q.cols_ + j] = scale;
+        for (size_t p = p0; p < p1; ++p) {
+          int value = scale == 0.0f ? 0 : int(std::nearbyint(w.at(p, j) / scale));
+          q.set(p, j, std::clamp(value, -8, 7));
+        }
+      }
+    }
+    return q;
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  int group_size() const { return group_size_; }
+  size_t num_groups() const {
+    return (rows_ + size_t(group_size_) - 1) / size_t(group_size_);
+  }
+
+  // Quantized value Q[p][j]
+  int value(size_t p, size_t j) const {
+    uint8_t byte = data_[p / 2 * cols_ + j];
+    int nibble = p % 2 ? byte >> 4 : byte & 0xF;
+    return nibble >= 8 ? nibble - 16 : nibble;
+  }
+
+  float scale(size_t group, size_t j) const {
+    return scales_[group * cols_ + j];
+  }
+
+  // W as fp32: Q * scale
+  Matrix<float> dequantize() const {
+    Matrix<float> w(rows_, cols_, Matrix<float>::Uninitialized{});
+    for (size_t p = 0; p < rows_; ++p)
+      for (size_t j = 0; j < cols_; ++j)
+        w.at(p, j) = float(value(p, j)) * scale(p / group_size_, j);
+    return w;
+  }
+
+  // Packed row pairs, (rows + 1) / 2 x cols bytes, and the scales,
+  // num_groups() x cols
+  const uint8_t *data() const { return data_.data(); }
+  const float *scales() const { return scales_.data(); }
+  size_t num_bytes() const {
+    return data_.size() + scales_.size() * sizeof(float);
+  }
+
+private:
+  void set(size_t p, size_t j, int value) {
+    uint8_t &byte = data_[p / 2 * cols_ + j];
+    uint8_t nibble = uint8_t(value) & 0xF;
+    byte = p % 2 ? uint8_t((byte & 0x0F) | (nibble << 4))
+                 : uint8_t((byte & 0xF0) | nibble);
+  }
+
+  size_t rows_ = 0, cols_ = 0;
+  int group_size_ = 2;
+  std::vector<uint8_t> data_;
+  std::vector<float> scales_;
+};
+
+// Symmetric per-row int8 quantization of activations: scale = max |a| / 127
+// per row, Q = round(a / scale). Returns the row scales.
+inline std::vector<float> quantize_activations(const Matrix<float> &a,
+                                               Matrix<int8_t> &q) {
+  if (q.rows() != a.rows() || q.cols() != a.cols())
+    throw std::invalid_argument("Quantized activations have the wrong shape");
+  std::vector<float> scales(a.rows());
+  for (size_t i = 0; i < a.rows(); ++i) {
+    float max_abs = 0.0f;
+    for (size_t p = 0; p < a.cols(); ++p)
+      max_abs = std::max(max_abs, std::fabs(a.at(i, p)));
+    scales[i] = max_abs / 127.0f;
+    for (size_t p = 0; p < a.cols(); ++p)
+      q.at(i, p) = scales[i] == 0.0f
+                       ? int8_t(0)
+                       : int8_t(std::clamp(
+                             int(std::nearbyint(a.at(i, p) / scales[i])),
+                             -127, 127));
+  }
+  return scales;
+}
+
+inline void check_int4_shapes(size_t a_rows, size_t a_cols,
+                              const Int4Matrix &b, const Matrix<float> &c) {
+  if (a_cols != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a_rows || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong shape");
+}
+
+// C = A * dequant(B) for float, fp16 or bf16 activations
+template <typename T>
+void matmul_int4(const Matrix<T> &a, const Int4Matrix &b, Matrix<float> &c,
+                 int vlen = 0) {
+  static_assert(std::is_same_v<T, float> || is_half_float_v<T>,
+                "int4 activations are float, fp16, bf16 or int8");
+  check_int4_shapes(a.rows(), a.cols(), b, c);
+
+  if constexpr (is_half_float_v<T>) {
+    Matrix<float> wide(a.rows(), a.cols(), Matrix<float>::Uninitialized{});
+    for (size_t i = 0; i < a.rows(); ++i)
+      for (size_t p = 0; p < a.cols(); ++p)
+        wide.at(i, p) = float(a.at(i, p));
+    matmul_int4(wide, b, c, vlen);
+  } else {
+    MATMUL_PERF_SCOPE("int4/float", 2.0 * double(a.rows()) *
+                                        double(b.rows()) * double(b.cols()));
+    matmul_asm_int4_float(a.data(), int(a.stride()), b.data(), b.scales(),
+                          c.data(), int(c.stride()), int(a.rows()),
+                          int(a.cols()), int(b.cols()), b.group_size(), vlen);
+  }
+}
+
+// C = diag(a_scales) * A * dequant(B) for int8 activations with one scale per
+// row, or a single one for the whole of A
+inline void matmul_int4(const Matrix<int8_t> &a,
+                        const std::vector<float> &a_scales,
+                        const Int4Matrix &b, Matrix<float> &c, int vlen = 0) {
+  check_int4_shapes(a.rows(), a.cols(), b, c);
+  if (a_scales.size() != 1 && a_scales.size() != a.rows())
+    throw std::invalid_argument("Activation scales must have 1 or rows entries");
+
+  std::vector<float> row_scales = a_scales;
+  if (a_scales.size() == 1)
+    row_scales.assign(a.rows(), a_scales.front());
+  MATMUL_PERF_SCOPE("int4/int8", 2.0 * double(a.rows()) * double(b.rows()) *
+                                     double(b.cols()));
+  matmul_asm_int4_int8(a.data(), int(a.stride()), row_scales.data(), b.data(),
+                       b.scales(), c.data(), int(c.stride()), int(a.rows()),
+                       int(a.cols()), int(b.cols()), b.group_size(), vlen);
+}
+
+template <typename T>
+Matrix<float> matmul_int4(const Matrix<T> &a, const Int4Matrix &b,
+                          int vlen = 0) {
+  Matrix<float> c(a.rows(), b.cols(), Matrix<float>::Uninitialized{});
+  matmul_int4(a, b, c, vlen);
+  return c;
+}
+
+inline Matrix<float> matmul_int4(const Matrix<int8_t> &a,
+                                 const std::vector<float> &a_scales,
+                                 const Int4Matrix &b, int vlen = 0) {
+  Matrix<float> c(a.rows(), b.cols(), Matrix<float>::Uninitialized{});
+  matmul_int4(a, a_scales, b, c, vlen);
+  return c;
+}
+
+// C++ reference: dequantize the weights (and int8 activations) and multiply
+// in fp32
+template <typename T>
+Matrix<float> matmul_int4_cpp_naive(const Matrix<T> &a, const Int4Matrix &b) {
+  Matrix<float> wide(a.rows(), a.cols(), Matrix<float>::Uninitialized{});
+  for (size_t i = 0; i < a.rows(); ++i)
+    for (size_t p = 0; p < a.cols(); ++p)
+      wide.at(i, p) = float(a.at(i, p));
+  return matmul(wide, b.dequantize(), MatMulImpl::CPP_NAIVE);
+}
+
+inline Matrix<float> matmul_int4_cpp_naive(const Matrix<int8_t> &a,
+                                           const std::vector<float> &a_scales,
+                                           const Int4Matrix &b) {
+  if (a_scales.size() != 1 && a_scales.size() != a.rows())
+    throw std::invalid_argument("Activation scales must have 1 or rows entries");
+  Matrix<float> wide(a.rows(), a.cols(), Matrix<float>::Uninitialized{});
+  for (size_t i = 0; i < a.rows(); ++i)
+    for (size_t p = 0; p < a.cols(); ++p)
+      wide.at(i, p) =
+          float(a.at(i, p)) * a_scales[a_scales.size() == 1 ? 0 : i];
+  return matmul(wide, b.dequantize(), MatMulImpl::CPP_NAIVE);
+}
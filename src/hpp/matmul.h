@@ -1,44 +1,86 @@
 #pragma once
 
+#include "blocked.h"
+#include "cpp_blocked.h"
+#include "cpu_features.h"
+#include "half_kernels.h"
+#include "ime.h"
 #include "matrix.h"
+#include "perf_counters.h"
+#include "quant.h"
+#include "skinny.h"
+#include "strassen.h"
+#include "thread_pool.h"
+#include "tuning.h"
 #include <algorithm>
+#include <cstdlib>
+#include <iostream>
 #include <limits>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <string>
 #include <type_traits>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Implementation types
 enum class MatMulImpl {
-  CPP_NAIVE,  // C++ naive implementation
-  ASM_NAIVE,  // Assembly naive implementation
-  ASM_VECTOR, // Assembly with vector instructions
+  CPP_NAIVE,    // C++ naive implementation
+  CPP_BLOCKED,  // Portable cache-blocked C++ engine (cpp_blocked.h)
+  ASM_NAIVE,    // Assembly naive implementation
+  ASM_VECTOR,   // Assembly with vector instructions
+  ASM_BLOCKED,  // Cache-blocked driver with assembly micro-kernels
+  ASM_IME,      // SpacemiT IME (vmadot) kernels, RVV fallback
+  ASM_STRASSEN, // Strassen-Winograd recursion over the blocked kernels
+  AUTO,         // Chosen per call from the CPU features and shape
+};
+
+// Operand layout for gemm
+enum class Transpose {
+  No,  // use the matrix as stored
+  Yes, // use its transpose
 };
 
 // Implementation name mapping
 inline std::string getImplName(MatMulImpl impl) {
   static const std::unordered_map<MatMulImpl, std::string> implNames = {
       {MatMulImpl::CPP_NAIVE, "C++ Naive"},
+      {MatMulImpl::CPP_BLOCKED, "C++ Blocked"},
       {MatMulImpl::ASM_NAIVE, "Assembly Naive"},
-      {MatMulImpl::ASM_VECTOR, "Assembly Vector"}};
+      {MatMulImpl::ASM_VECTOR, "Assembly Vector"},
+      {MatMulImpl::ASM_BLOCKED, "Assembly Blocked"},
+      {MatMulImpl::ASM_IME, "Assembly IME"},
+      {MatMulImpl::ASM_STRASSEN, "Assembly Strassen"},
+      {MatMulImpl::AUTO, "Auto"}};
 
   auto it = implNames.find(impl);
   return it != implNames.end() ? it->second : "Unknown";
 }
 
-// Generic clamping for any numeric type
-template <typename T, typename AccumulatorT = T>
-T clamp_int(AccumulatorT value) {
-  if constexpr (std::is_integral_v<T>) {
-    // For integral types, clamp to type limits
-    if (value > static_cast<AccumulatorT>(std::numeric_limits<T>::max()))
-      return std::numeric_limits<T>::max();
-    if (value < static_cast<AccumulatorT>(std::numeric_limits<T>::min()))
-      return std::numeric_limits<T>::min();
-  }
-  // For floating types, no explicit clamping (IEEE handles overflow/underflow)
-  return static_cast<T>(value);
+// Short implementation names used on command lines and in the tuning cache
+inline const std::vector<std::pair<std::string, MatMulImpl>> &implKeys() {
+  static const std::vector<std::pair<std::string, MatMulImpl>> keys = {
+      {"cpp", MatMulImpl::CPP_NAIVE},
+      {"cpp_blocked", MatMulImpl::CPP_BLOCKED},
+      {"naive", MatMulImpl::ASM_NAIVE},
+      {"vector", MatMulImpl::ASM_VECTOR},
+      {"blocked", MatMulImpl::ASM_BLOCKED},
+      {"ime", MatMulImpl::ASM_IME},
+      {"strassen", MatMulImpl::ASM_STRASSEN},
+      {"auto", MatMulImpl::AUTO}};
+  return keys;
+}
+
+inline std::string getImplKey(MatMulImpl impl) {
+  for (const auto &entry : implKeys())
+    if (entry.second == impl)
+      return entry.first;
+  return "unknown";
 }
 
 // C++ reference implementation template
@@ -48,15 +90,11 @@ Matrix<T> matmul_cpp_naive(const Matrix<T> &a, const Matrix<T> &b) {
     throw std::invalid_argument(
         "Matrix dimensions mismatch for multiplication");
 
-  Matrix<T> result(a.rows(), b.cols());
+  Matrix<T> result(a.rows(), b.cols(), typename Matrix<T>::Uninitialized{});
 
   for (size_t i = 0; i < a.rows(); ++i) {
     for (size_t j = 0; j < b.cols(); ++j) {
-      // Choose appropriate accumulator type based on T
-      using AccumulatorType = std::conditional_t<
-          std::is_integral_v<T>,
-          std::conditional_t<sizeof(T) < sizeof(int32_t), int32_t, int64_t>, T>;
-
+      using AccumulatorType = accumulator_t<T>;
       AccumulatorType sum = static_cast<AccumulatorType>(0);
 
       for (size_t k = 0; k < a.cols(); ++k)
@@ -78,7 +116,8 @@ void matmul_asm_naive_float(const float *a, const float *b, float *c,
                             int a_rows, int a_cols, int b_cols);
 
 void matmul_asm_vector_float(const float *a, const float *b, float *c,
-                             int a_rows, int a_cols, int b_cols, int vlen);
+                             int a_rows, int a_cols, int b_cols, int vlen,
+                             int lmul);
 
 // Integer implementations
 // For int8_t
@@ -123,6 +162,13 @@ template <typename T> struct VectorOpTraits {
   }
 };
 
+template <> struct VectorOpTraits<float> {
+  static constexpr int element_width() { return 1 << 5; }
+
+  // Register group size used by the float vector kernel (1, 2 or 4)
+  static constexpr int lmul() { return 4; }
+};
+
 template <> struct VectorOpTraits<int8_t> {
   static constexpr int element_width() {
     return 1 << 3;
@@ -197,70 +243,531 @@ template <> struct VectorOpTraits<int32_t> {
   }
 };
 
+// Counter scope for one kernel call, named "<impl>/<type>", with its FLOPs
+// and compulsory A/B/C traffic for cycles/FLOP and bandwidth
+#define MATMUL_PERF_KERNEL_SCOPE(T, impl, m, k, n)                             \
+  MATMUL_PERF_SCOPE(getImplName(impl) + "/" + element_type_name<T>(),         \
+                    2.0 * double(m) * double(n) * double(k),                   \
+                    double(sizeof(T)) * (double(m) * double(k) +               \
+                                         double(k) * double(n) +               \
+                                         double(m) * double(n)))
+
+// Run one assembly implementation with explicit kernel parameters
 template <typename T>
-inline void call_asm_impl(const T *a, const T *b, T *c, int a_rows, int a_cols,
-                          int b_cols, MatMulImpl impl, int vlen) {
-  // Default implementation
+inline void call_asm_kernel(const T *a, const T *b, T *c, int a_rows,
+                            int a_cols, int b_cols, MatMulImpl impl,
+                            const TuneParams &params) {
+  // Types without assembly kernels can still use the portable C++ engine
+  if (impl == MatMulImpl::CPP_BLOCKED) {
+    matmul_cpp_blocked(a, b, c, a_rows, a_cols, b_cols);
+    return;
+  }
   throw std::runtime_error(
       "Unsupported element type for matrix multiplication");
 }
 
-// Update specializations to pass the vlen parameter
 template <>
-inline void call_asm_impl<float>(const float *a, const float *b, float *c,
-                                 int a_rows, int a_cols, int b_cols,
-                                 MatMulImpl impl, int vlen) {
-  if (impl == MatMulImpl::ASM_NAIVE)
+inline void call_asm_kernel<float>(const float *a, const float *b, float *c,
+                                   int a_rows, int a_cols, int b_cols,
+                                   MatMulImpl impl, const TuneParams &params) {
+  if (impl == MatMulImpl::ASM_IME)
+    impl = MatMulImpl::ASM_VECTOR; // IME has no float tiles
+  if (impl == MatMulImpl::ASM_STRASSEN &&
+      !strassen_shape(a_rows, a_cols, b_cols, strassen_cutoff(params)))
+    impl = MatMulImpl::ASM_BLOCKED; // Too small to recurse
+  MATMUL_PERF_KERNEL_SCOPE(float, impl, a_rows, a_cols, b_cols);
+
+  if (impl == MatMulImpl::CPP_BLOCKED)
+    matmul_cpp_blocked(a, b, c, a_rows, a_cols, b_cols);
+  else if (impl == MatMulImpl::ASM_STRASSEN)
+    matmul_strassen(a, b, c, a_rows, a_cols, b_cols, params);
+  // GEMV and skinny shapes go to the unit-stride kernels of skinny.h
+  else if (impl != MatMulImpl::ASM_NAIVE &&
+           skinny_shape(a_rows, a_cols, b_cols))
+    matmul_skinny(a, b, c, a_rows, a_cols, b_cols);
+  else if (impl == MatMulImpl::ASM_NAIVE)
     matmul_asm_naive_float(a, b, c, a_rows, a_cols, b_cols);
   else if (impl == MatMulImpl::ASM_VECTOR)
-    matmul_asm_vector_float(a, b, c, a_rows, a_cols, b_cols, vlen);
+    matmul_asm_vector_float(a, b, c, a_rows, a_cols, b_cols, params.vlen,
+                            params.lmul > 0 ? params.lmul
+                                            : VectorOpTraits<float>::lmul());
+  else if (impl == MatMulImpl::ASM_BLOCKED)
+    matmul_blocked(a, b, c, a_rows, a_cols, b_cols,
+                   tuned_blocks<float>(params));
 }
 
 template <>
-inline void call_asm_impl<int8_t>(const int8_t *a, const int8_t *b, int8_t *c,
-                                  int a_rows, int a_cols, int b_cols,
-                                  MatMulImpl impl, int vlen) {
-  if (impl == MatMulImpl::ASM_NAIVE) {
+inline void call_asm_kernel<int8_t>(const int8_t *a, const int8_t *b,
+                                    int8_t *c, int a_rows, int a_cols,
+                                    int b_cols, MatMulImpl impl,
+                                    const TuneParams &params) {
+  if (impl == MatMulImpl::ASM_IME && !ime_available())
+    impl = MatMulImpl::ASM_VECTOR; // No IME on this core
+  if (impl == MatMulImpl::ASM_STRASSEN &&
+      !strassen_shape(a_rows, a_cols, b_cols, strassen_cutoff(params)))
+    impl = MatMulImpl::ASM_BLOCKED; // Too small to recurse
+  MATMUL_PERF_KERNEL_SCOPE(int8_t, impl, a_rows, a_cols, b_cols);
+
+  if (impl == MatMulImpl::CPP_BLOCKED) {
+    matmul_cpp_blocked(a, b, c, a_rows, a_cols, b_cols);
+  } else if (impl == MatMulImpl::ASM_STRASSEN) {
+    matmul_strassen(a, b, c, a_rows, a_cols, b_cols, params);
+  } else if (impl != MatMulImpl::ASM_NAIVE &&
+             skinny_shape(a_rows, a_cols, b_cols)) {
+    matmul_skinny(a, b, c, a_rows, a_cols, b_cols);
+  } else if (impl == MatMulImpl::ASM_NAIVE) {
     matmul_asm_naive_int8(a, b, c, a_rows, a_cols, b_cols,
                           VectorOpTraits<int8_t>::min_value(),
                           VectorOpTraits<int8_t>::max_value());
   } else if (impl == MatMulImpl::ASM_VECTOR) {
-    int clamp_freq = VectorOpTraits<int8_t>::clamp_frequency(a_rows, b_cols);
+    int clamp_freq =
+        params.clamp_freq > 0
+            ? params.clamp_freq
+            : VectorOpTraits<int8_t>::clamp_frequency(a_rows, b_cols);
     matmul_asm_vector_int8(
         a, b, c, a_rows, a_cols, b_cols, VectorOpTraits<int8_t>::min_value(),
-        VectorOpTraits<int8_t>::max_value(), clamp_freq, vlen);
+        VectorOpTraits<int8_t>::max_value(), clamp_freq, params.vlen);
+  } else if (impl == MatMulImpl::ASM_BLOCKED) {
+    matmul_blocked(a, b, c, a_rows, a_cols, b_cols,
+                   tuned_blocks<int8_t>(params));
   }
+#ifdef MATMUL_HAVE_IME
+  else if (impl == MatMulImpl::ASM_IME) {
+    matmul_ime_int8(a, b, c, a_rows, a_cols, b_cols,
+                    VectorOpTraits<int8_t>::min_value(),
+                    VectorOpTraits<int8_t>::max_value());
+  }
+#endif
 }
 
 template <>
-inline void call_asm_impl<int16_t>(const int16_t *a, const int16_t *b,
-                                   int16_t *c, int a_rows, int a_cols,
-                                   int b_cols, MatMulImpl impl, int vlen) {
-  if (impl == MatMulImpl::ASM_NAIVE) {
+inline void call_asm_kernel<int16_t>(const int16_t *a, const int16_t *b,
+                                     int16_t *c, int a_rows, int a_cols,
+                                     int b_cols, MatMulImpl impl,
+                                     const TuneParams &params) {
+  if (impl == MatMulImpl::ASM_IME)
+    impl = MatMulImpl::ASM_VECTOR; // IME tiles are int8 only
+  if (impl == MatMulImpl::ASM_STRASSEN &&
+      !strassen_shape(a_rows, a_cols, b_cols, strassen_cutoff(params)))
+    impl = MatMulImpl::ASM_BLOCKED; // Too small to recurse
+  MATMUL_PERF_KERNEL_SCOPE(int16_t, impl, a_rows, a_cols, b_cols);
+
+  if (impl == MatMulImpl::CPP_BLOCKED) {
+    matmul_cpp_blocked(a, b, c, a_rows, a_cols, b_cols);
+  } else if (impl == MatMulImpl::ASM_STRASSEN) {
+    matmul_strassen(a, b, c, a_rows, a_cols, b_cols, params);
+  } else if (impl != MatMulImpl::ASM_NAIVE &&
+             skinny_shape(a_rows, a_cols, b_cols)) {
+    matmul_skinny(a, b, c, a_rows, a_cols, b_cols);
+  } else if (impl == MatMulImpl::ASM_NAIVE) {
     matmul_asm_naive_int16(a, b, c, a_rows, a_cols, b_cols,
                            VectorOpTraits<int16_t>::min_value(),
                            VectorOpTraits<int16_t>::max_value());
   } else if (impl == MatMulImpl::ASM_VECTOR) {
-    int clamp_freq = VectorOpTraits<int16_t>::clamp_frequency(a_rows, b_cols);
+    int clamp_freq =
+        params.clamp_freq > 0
+            ? params.clamp_freq
+            : VectorOpTraits<int16_t>::clamp_frequency(a_rows, b_cols);
     matmul_asm_vector_int16(
         a, b, c, a_rows, a_cols, b_cols, VectorOpTraits<int16_t>::min_value(),
-        VectorOpTraits<int16_t>::max_value(), clamp_freq, vlen);
+        VectorOpTraits<int16_t>::max_value(), clamp_freq, params.vlen);
+  } else if (impl == MatMulImpl::ASM_BLOCKED) {
+    matmul_blocked(a, b, c, a_rows, a_cols, b_cols,
+                   tuned_blocks<int16_t>(params));
   }
 }
 
 template <>
-inline void call_asm_impl<int32_t>(const int32_t *a, const int32_t *b,
-                                   int32_t *c, int a_rows, int a_cols,
-                                   int b_cols, MatMulImpl impl, int vlen) {
-  if (impl == MatMulImpl::ASM_NAIVE) {
+inline void call_asm_kernel<int32_t>(const int32_t *a, const int32_t *b,
+                                     int32_t *c, int a_rows, int a_cols,
+                                     int b_cols, MatMulImpl impl,
+                                     const TuneParams &params) {
+  if (impl == MatMulImpl::ASM_IME)
+    impl = MatMulImpl::ASM_VECTOR; // IME tiles are int8 only
+  if (impl == MatMulImpl::ASM_STRASSEN &&
+      !strassen_shape(a_rows, a_cols, b_cols, strassen_cutoff(params)))
+    impl = MatMulImpl::ASM_BLOCKED; // Too small to recurse
+  MATMUL_PERF_KERNEL_SCOPE(int32_t, impl, a_rows, a_cols, b_cols);
+
+  if (impl == MatMulImpl::CPP_BLOCKED) {
+    matmul_cpp_blocked(a, b, c, a_rows, a_cols, b_cols);
+  } else if (impl == MatMulImpl::ASM_STRASSEN) {
+    matmul_strassen(a, b, c, a_rows, a_cols, b_cols, params);
+  } else if (impl != MatMulImpl::ASM_NAIVE &&
+             skinny_shape(a_rows, a_cols, b_cols)) {
+    matmul_skinny(a, b, c, a_rows, a_cols, b_cols);
+  } else if (impl == MatMulImpl::ASM_NAIVE) {
     matmul_asm_naive_int32(a, b, c, a_rows, a_cols, b_cols,
                            VectorOpTraits<int32_t>::min_value(),
                            VectorOpTraits<int32_t>::max_value());
   } else if (impl == MatMulImpl::ASM_VECTOR) {
-    int clamp_freq = VectorOpTraits<int32_t>::clamp_frequency(a_rows, b_cols);
+    int clamp_freq =
+        params.clamp_freq > 0
+            ? params.clamp_freq
+            : VectorOpTraits<int32_t>::clamp_frequency(a_rows, b_cols);
     matmul_asm_vector_int32(
         a, b, c, a_rows, a_cols, b_cols, VectorOpTraits<int32_t>::min_value(),
-        VectorOpTraits<int32_t>::max_value(), clamp_freq, vlen);
+        VectorOpTraits<int32_t>::max_value(), clamp_freq, params.vlen);
+  } else if (impl == MatMulImpl::ASM_BLOCKED) {
+    matmul_blocked(a, b, c, a_rows, a_cols, b_cols,
+                   tuned_blocks<int32_t>(params));
+  }
+}
+
+// 16-bit float inputs, C stored as TC (the input type, or float). There are
+// no naive or IME kernels, so those run the widening vector kernel; without
+// Zvfh / Zvfbfwma every implementation takes the blocked driver, which widens
+// A and B to fp32 in software while packing. Strassen recurses in fp32.
+template <typename T, typename TC>
+inline void call_asm_kernel_half(const T *a, const T *b, TC *c, int a_rows,
+                                 int a_cols, int b_cols, MatMulImpl impl,
+                                 const TuneParams &params) {
+  if (impl == MatMulImpl::ASM_STRASSEN &&
+      !strassen_shape(a_rows, a_cols, b_cols, strassen_cutoff(params)))
+    impl = MatMulImpl::ASM_BLOCKED; // Too small to recurse
+  if (impl != MatMulImpl::ASM_BLOCKED && impl != MatMulImpl::ASM_STRASSEN &&
+      impl != MatMulImpl::CPP_BLOCKED)
+    impl = half_vector_available<T>() ? MatMulImpl::ASM_VECTOR
+                                      : MatMulImpl::ASM_BLOCKED;
+  MATMUL_PERF_KERNEL_SCOPE(T, impl, a_rows, a_cols, b_cols);
+
+  if (impl == MatMulImpl::CPP_BLOCKED)
+    gemm_cpp_blocked<T, TC>(false, false, a_rows, b_cols, a_cols, T(1.0f), a,
+                            std::max(1, a_cols), b, std::max(1, b_cols),
+                            T(0.0f), c, std::max(1, b_cols));
+  else if (impl == MatMulImpl::ASM_STRASSEN)
+    matmul_strassen<T, TC>(a, b, c, a_rows, a_cols, b_cols, params);
+  else if (impl == MatMulImpl::ASM_VECTOR)
+    matmul_vector_half(a, b, c, a_rows, a_cols, b_cols);
+  else
+    gemm_blocked<T, TC>(false, false, a_rows, b_cols, a_cols, T(1.0f), a,
+                        std::max(1, a_cols), b, std::max(1, b_cols), T(0.0f),
+                        c, std::max(1, b_cols), tuned_blocks<T>(params));
+}
+
+template <>
+inline void call_asm_kernel<float16>(const float16 *a, const float16 *b,
+                                     float16 *c, int a_rows, int a_cols,
+                                     int b_cols, MatMulImpl impl,
+                                     const TuneParams &params) {
+  call_asm_kernel_half(a, b, c, a_rows, a_cols, b_cols, impl, params);
+}
+
+template <>
+inline void call_asm_kernel<bfloat16>(const bfloat16 *a, const bfloat16 *b,
+                                      bfloat16 *c, int a_rows, int a_cols,
+                                      int b_cols, MatMulImpl impl,
+                                      const TuneParams &params) {
+  call_asm_kernel_half(a, b, c, a_rows, a_cols, b_cols, impl, params);
+}
+
+// Tuned parameters for one kernel call, from the tuning cache entry of its
+// shape bucket (defaults if there is none)
+template <typename T>
+TuneParams tuned_params(MatMulImpl impl, int m, int n, int k) {
+  auto params =
+      TuningCache::instance().find(make_tune_key<T>(getImplKey(impl), m, n, k));
+  return params ? *params : TuneParams();
+}
+
+// Shape thresholds of MatMulImpl::AUTO for shapes the tuning cache does not
+// cover
+struct AutoShape {
+  // Below this m * n * k, or with fewer rows or columns than a few
+  // micro-tiles, packing for the blocked driver does not pay off
+  static constexpr double blocked_min_volume = 64.0 * 64.0 * 64.0;
+  static constexpr int blocked_min_dim = 16;
+};
+
+struct ImplChoice {
+  MatMulImpl impl;
+  const char *reason; // why it was chosen, for the dispatch log
+};
+
+// True if impl can run for T on this core. Host builds run every
+// implementation on the portable kernels.
+template <typename T> bool impl_runnable(MatMulImpl impl) {
+#ifdef MATMUL_HOST_BUILD
+  return impl != MatMulImpl::AUTO;
+#else
+  if (impl == MatMulImpl::CPP_NAIVE || impl == MatMulImpl::CPP_BLOCKED)
+    return true;
+  if (impl == MatMulImpl::ASM_NAIVE) // scalar kernels, none for 16-bit floats
+    return !is_half_float_v<T>;
+  return impl != MatMulImpl::AUTO && cpu_features().rvv;
+#endif
+}
+
+// The implementation MatMulImpl::AUTO runs for an m x k by k x n product:
+// the fastest one tuned for this shape bucket, if it runs here; otherwise
+// the portable engine without a vector unit, the vector kernels (which route
+// GEMV and skinny shapes to skinny.h) for small shapes, IME for large int8
+// products when the core has it and the blocked driver for the rest.
+// Strassen rounds differently, so it is only chosen when tuned.
+template <typename T> ImplChoice select_impl(int m, int n, int k) {
+  if (std::optional<std::string> key =
+          TuningCache::instance().fastest(make_tune_key<T>("", m, n, k)))
+    for (const auto &entry : implKeys())
+      if (entry.first == *key && impl_runnable<T>(entry.second))
+        return {entry.second, "tuned"};
+
+#ifdef MATMUL_HOST_BUILD
+  return {MatMulImpl::CPP_BLOCKED, "host build"};
+#else
+  if (!cpu_features().rvv)
+    return {MatMulImpl::CPP_BLOCKED, "no vector unit"};
+  if (skinny_shape(m, k, n))
+    return {MatMulImpl::ASM_VECTOR, "skinny shape"};
+  if (double(m) * double(n) * double(k) < AutoShape::blocked_min_volume ||
+      std::min(m, n) < AutoShape::blocked_min_dim)
+    return {MatMulImpl::ASM_VECTOR, "small shape"};
+  if constexpr (std::is_same_v<T, int8_t>)
+    if (ime_available())
+      return {MatMulImpl::ASM_IME, "IME"};
+  return {MatMulImpl::ASM_BLOCKED, "large shape"};
+#endif
+}
+
+// One line on the detected features, e.g.
+// "isa=rv64imafdcv_... rvv=1 vlen=256 zvfh=0 zvfbfwma=0 ime=1"
+inline std::string describe_cpu_features() {
+#ifdef MATMUL_HOST_BUILD
+  return "host build (portable C++ kernels)";
+#else
+  const CpuFeatures &f = cpu_features();
+  std::ostringstream os;
+  os << "isa=" << (f.isa.empty() ? "unknown" : f.isa) << " hwcap_v="
+     << f.hwcap_v << " rvv=" << f.rvv << " vlen=" << f.vlen_bits()
+     << " zvfh=" << half_vector_available<float16>()
+     << " zvfbfwma=" << half_vector_available<bfloat16>()
+     << " ime=" << ime_available();
+  return os.str();
+#endif
+}
+
+// MATMUL_LOG_DISPATCH=1 logs the CPU features and each distinct AUTO choice
+// (per type and shape bucket) to stderr
+inline bool dispatch_log_enabled() {
+  static const bool enabled = [] {
+    const char *env = std::getenv("MATMUL_LOG_DISPATCH");
+    return env && *env && std::string(env) != "0";
+  }();
+  return enabled;
+}
+
+inline void log_dispatch_once(const std::string &line) {
+  static std::mutex mutex;
+  static std::set<std::string> logged;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (logged.empty())
+    std::cerr << "matmul: cpu " << describe_cpu_features() << "\n";
+  if (logged.insert(line).second)
+    std::cerr << "matmul: " << line << "\n";
+}
+
+// impl with AUTO replaced by the choice for this shape
+template <typename T>
+MatMulImpl resolve_impl(MatMulImpl impl, int m, int n, int k) {
+  if (impl != MatMulImpl::AUTO)
+    return impl;
+  ImplChoice choice = select_impl<T>(m, n, k);
+  if (dispatch_log_enabled()) {
+    // Shapes are shown as the upper bounds of their tuning buckets
+    TuneKey key = make_tune_key<T>("", m, n, k);
+    log_dispatch_once("auto " + key.type + " " +
+                      std::to_string(1L << key.m_bucket) + "x" +
+                      std::to_string(1L << key.n_bucket) + "x" +
+                      std::to_string(1L << key.k_bucket) + " -> " +
+                      getImplKey(choice.impl) + " (" + choice.reason + ")");
+  }
+  return choice.impl;
+}
+
+// Run one assembly implementation with tuned parameters. A non-zero vlen
+// overrides the tuned strip width.
+template <typename T>
+inline void call_asm_impl(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                          int b_cols, MatMulImpl impl, int vlen) {
+  impl = resolve_impl<T>(impl, a_rows, b_cols, a_cols);
+  TuneParams params = tuned_params<T>(impl, a_rows, b_cols, a_cols);
+  if (vlen > 0)
+    params.vlen = vlen;
+  call_asm_kernel(a, b, c, a_rows, a_cols, b_cols, impl, params);
+}
+
+// C++ reference for gemm: C = alpha * op(A) * op(B) + beta * C. C may be
+// float when A and B are 16-bit floats (fp32 output).
+template <typename T, typename TC = T>
+void gemm_cpp_naive(Transpose trans_a, Transpose trans_b, int m, int n, int k,
+                    T alpha, const T *a, int lda, const T *b, int ldb, T beta,
+                    TC *c, int ldc) {
+  using AccumulatorType = accumulator_t<T>;
+  using EpilogueType =
+      std::conditional_t<std::is_integral_v<T>, int64_t, AccumulatorType>;
+
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < n; ++j) {
+      AccumulatorType sum = static_cast<AccumulatorType>(0);
+      for (int p = 0; p < k; ++p) {
+        T a_ip = trans_a == Transpose::Yes ? a[size_t(p) * lda + i]
+                                           : a[size_t(i) * lda + p];
+        T b_pj = trans_b == Transpose::Yes ? b[size_t(j) * ldb + p]
+                                           : b[size_t(p) * ldb + j];
+        sum += static_cast<AccumulatorType>(a_ip) *
+               static_cast<AccumulatorType>(b_pj);
+      }
+
+      TC &out = c[size_t(i) * ldc + j];
+      EpilogueType value = EpilogueType(alpha) * EpilogueType(sum);
+      if (beta != T(0))
+        value += EpilogueType(beta) * EpilogueType(out);
+      out = clamp_int<TC, EpilogueType>(value);
+    }
+  }
+}
+
+// BLAS-style GEMM on caller-owned memory:
+//   C (m x n) = alpha * op(A) * op(B) + beta * C
+// op(A) is m x k and op(B) is k x n. All matrices are row-major with leading
+// dimensions lda, ldb, ldc (elements between consecutive rows as stored).
+// With beta == 0, C is not read. CPP_NAIVE runs the C++ reference and
+// CPP_BLOCKED the portable C++ engine; every other implementation uses the
+// blocked driver, whose packing handles strides and transposes natively.
+template <typename T>
+void gemm(Transpose trans_a, Transpose trans_b, int m, int n, int k, T alpha,
+          const T *a, int lda, const T *b, int ldb, T beta, T *c, int ldc,
+          MatMulImpl impl = MatMulImpl::ASM_BLOCKED) {
+  if (m < 0 || n < 0 || k < 0)
+    throw std::invalid_argument("Negative matrix dimension");
+  if (lda < std::max(1, trans_a == Transpose::Yes ? m : k) ||
+      ldb < std::max(1, trans_b == Transpose::Yes ? k : n) ||
+      ldc < std::max(1, n))
+    throw std::invalid_argument("Leading dimension too small");
+
+  impl = resolve_impl<T>(impl, m, n, k);
+  if (impl == MatMulImpl::CPP_NAIVE)
+    gemm_cpp_naive(trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c,
+                   ldc);
+  else if (impl == MatMulImpl::CPP_BLOCKED)
+    gemm_cpp_blocked(trans_a == Transpose::Yes, trans_b == Transpose::Yes, m,
+                     n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+  else
+    gemm_blocked(trans_a == Transpose::Yes, trans_b == Transpose::Yes, m, n, k,
+                 alpha, a, lda, b, ldb, beta, c, ldc,
+                 tuned_blocks<T>(
+                     tuned_params<T>(MatMulImpl::ASM_BLOCKED, m, n, k)));
+}
+
+// gemm on matrix views; shapes are taken from the views
+template <typename T, typename TA, typename TB>
+void gemm(Transpose trans_a, Transpose trans_b, T alpha, MatrixView<TA> a,
+          MatrixView<TB> b, T beta, MatrixView<T> c,
+          MatMulImpl impl = MatMulImpl::ASM_BLOCKED) {
+  static_assert(std::is_same_v<std::remove_const_t<TA>, T> &&
+                    std::is_same_v<std::remove_const_t<TB>, T>,
+                "gemm operands must share one element type");
+
+  size_t m = trans_a == Transpose::Yes ? a.cols() : a.rows();
+  size_t k = trans_a == Transpose::Yes ? a.rows() : a.cols();
+  size_t b_rows = trans_b == Transpose::Yes ? b.cols() : b.rows();
+  size_t n = trans_b == Transpose::Yes ? b.rows() : b.cols();
+  if (b_rows != k || c.rows() != m || c.cols() != n)
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+
+  gemm(trans_a, trans_b, int(m), int(n), int(k), alpha, a.data(), int(a.ld()),
+       b.data(), int(b.ld()), beta, c.data(), int(c.ld()), impl);
+}
+
+// C (m x n) = A (m x k) * B (k x n) on caller-owned row-major memory with
+// leading dimensions lda, ldb, ldc. The assembly kernels expect rows packed
+// back to back, so strided operands are handed to the stride-aware blocked
+// driver instead.
+template <typename T>
+void matmul_strided(const T *a, int lda, const T *b, int ldb, T *c, int ldc,
+                    int m, int k, int n,
+                    MatMulImpl impl = MatMulImpl::CPP_NAIVE, int vlen = 0) {
+  impl = resolve_impl<T>(impl, m, n, k);
+  if (impl == MatMulImpl::CPP_NAIVE) {
+    gemm_cpp_naive(Transpose::No, Transpose::No, m, n, k, T(1), a, lda, b, ldb,
+                   T(0), c, ldc);
+  } else if (impl == MatMulImpl::CPP_BLOCKED) {
+    gemm_cpp_blocked(false, false, m, n, k, T(1), a, lda, b, ldb, T(0), c,
+                     ldc);
+  } else if (lda == k && ldb == n && ldc == n) {
+    call_asm_impl(a, b, c, m, k, n, impl, vlen);
+  } else {
+    gemm_blocked(false, false, m, n, k, T(1), a, lda, b, ldb, T(0), c, ldc,
+                 tuned_blocks<T>(
+                     tuned_params<T>(MatMulImpl::ASM_BLOCKED, m, n, k)));
+  }
+}
+
+// Multiply into a caller-owned result (no allocation). c must already be
+// a.rows() x b.cols().
+template <typename T>
+void matmul(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c,
+            MatMulImpl impl = MatMulImpl::CPP_NAIVE, int vlen = 0) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a.rows() || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong shape");
+
+  matmul_strided(a.data(), int(a.stride()), b.data(), int(b.stride()),
+                 c.data(), int(c.stride()), int(a.rows()), int(a.cols()),
+                 int(b.cols()), impl, vlen);
+}
+
+// Multiply views into a caller-owned result view, e.g. with weights mapped
+// from a file (matrix_file.h); c must be a.rows() x b.cols()
+template <typename T, typename TA, typename TB>
+void matmul(MatrixView<TA> a, MatrixView<TB> b, MatrixView<T> c,
+            MatMulImpl impl = MatMulImpl::CPP_NAIVE, int vlen = 0) {
+  static_assert(std::is_same_v<std::remove_const_t<TA>, T> &&
+                    std::is_same_v<std::remove_const_t<TB>, T>,
+                "matmul operands must share one element type");
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a.rows() || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong shape");
+
+  matmul_strided<T>(a.data(), int(a.ld()), b.data(), int(b.ld()), c.data(),
+                    int(c.ld()), int(a.rows()), int(a.cols()), int(b.cols()),
+                    impl, vlen);
+}
+
+// fp16 / bf16 inputs with the fp32 result kept: c must be a.rows() x
+// b.cols(). Accumulation is fp32 for every implementation, so this only
+// skips the final rounding to 16 bits.
+template <typename T, typename = std::enable_if_t<is_half_float_v<T>>>
+void matmul(const Matrix<T> &a, const Matrix<T> &b, Matrix<float> &c,
+            MatMulImpl impl = MatMulImpl::CPP_NAIVE) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a.rows() || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong shape");
+
+  const int m = a.rows(), n = b.cols(), k = a.cols();
+  impl = resolve_impl<T>(impl, m, n, k);
+  if (impl == MatMulImpl::CPP_NAIVE) {
+    gemm_cpp_naive(Transpose::No, Transpose::No, m, n, k, T(1.0f), a.data(),
+                   int(a.stride()), b.data(), int(b.stride()), T(0.0f),
+                   c.data(), int(c.stride()));
+  } else if (impl == MatMulImpl::CPP_BLOCKED) {
+    gemm_cpp_blocked<T, float>(false, false, m, n, k, T(1.0f), a.data(),
+                               int(a.stride()), b.data(), int(b.stride()),
+                               T(0.0f), c.data(), int(c.stride()));
+  } else if (a.is_contiguous() && b.is_contiguous() && c.is_contiguous()) {
+    call_asm_kernel_half(a.data(), b.data(), c.data(), m, k, n, impl,
+                         tuned_params<T>(impl, m, n, k));
+  } else {
+    gemm_blocked<T, float>(
+        false, false, m, n, k, T(1.0f), a.data(), int(a.stride()), b.data(),
+        int(b.stride()), T(0.0f), c.data(), int(c.stride()),
+        tuned_blocks<T>(tuned_params<T>(MatMulImpl::ASM_BLOCKED, m, n, k)));
   }
 }
 
@@ -272,15 +779,134 @@ Matrix<T> matmul(const Matrix<T> &a, const Matrix<T> &b,
     throw std::invalid_argument(
         "Matrix dimensions mismatch for multiplication");
 
-  // For C++ reference implementation, call directly
-  if (impl == MatMulImpl::CPP_NAIVE)
-    return matmul_cpp_naive(a, b);
+  // Every implementation writes all of C, so skip zero-filling the result
+  Matrix<T> result(a.rows(), b.cols(), typename Matrix<T>::Uninitialized{});
+  matmul(a, b, result, impl, vlen);
+
+  return result;
+}
 
-  // For assembly implementations, prepare data and call the assembly function
-  Matrix<T> result(a.rows(), b.cols());
+// Run one of the call_asm_impl kernels on tiles of C spread over the thread
+// pool. C is cut into row tiles aligned to the micro-kernel height; when there
+// are too few rows to keep every thread busy, the columns are split as well.
+// The kernels expect dense row-major operands, so column tiles read a dense
+// copy of their B slab, made once per column tile and shared by all its row
+// tiles, and write a private C tile. Every tile runs with params when given,
+// otherwise with the tuned parameters of its shape.
+template <typename T>
+void call_asm_impl_parallel(const T *a, const T *b, T *c, int a_rows,
+                            int a_cols, int b_cols, MatMulImpl impl, int vlen,
+                            int num_threads = 0,
+                            const TuneParams *params = nullptr) {
+  impl = resolve_impl<T>(impl, a_rows, b_cols, a_cols);
+  auto run = [&](const T *a_tile, const T *b_tile, T *c_tile, int rows,
+                 int cols) {
+    if (!params) {
+      call_asm_impl(a_tile, b_tile, c_tile, rows, a_cols, cols, impl, vlen);
+      return;
+    }
+    TuneParams tile_params = *params;
+    if (vlen > 0)
+      tile_params.vlen = vlen;
+    call_asm_kernel(a_tile, b_tile, c_tile, rows, a_cols, cols, impl,
+                    tile_params);
+  };
+
+  ThreadPool &pool = ThreadPool::instance();
+  int threads = pool.num_threads();
+  if (num_threads > 0)
+    threads = std::min(threads, num_threads);
+  if (threads <= 1 || a_rows <= 0 || b_cols <= 0) {
+    run(a, b, c, a_rows, b_cols);
+    return;
+  }
 
-  call_asm_impl(a.data(), b.data(), result.data(), a.rows(), a.cols(), b.cols(),
-                impl, vlen);
+  constexpr int row_align = 4;  // micro-kernel rows
+  constexpr int col_align = 16; // micro-kernel columns
+  auto round_up = [](int x, int m) { return (x + m - 1) / m * m; };
+
+  // Aim for a few tiles per thread so work stealing can even out the load
+  const int target_tiles = threads * 4;
+  int tile_rows = round_up((a_rows + target_tiles - 1) / target_tiles, row_align);
+  int row_tiles = (a_rows + tile_rows - 1) / tile_rows;
+
+  int tile_cols = b_cols;
+  if (row_tiles < target_tiles && b_cols >= 2 * col_align) {
+    int col_tiles = std::min((target_tiles + row_tiles - 1) / row_tiles,
+                             b_cols / col_align);
+    tile_cols = round_up((b_cols + col_tiles - 1) / col_tiles, col_align);
+  }
+  int col_tiles = (b_cols + tile_cols - 1) / tile_cols;
+
+  // Slab of column tile ct: a_cols x cols, at offset a_cols * c0
+  std::unique_ptr<T[], AlignedFree> b_slabs;
+  if (col_tiles > 1) {
+    b_slabs = make_aligned_buffer<T>(size_t(a_cols) * b_cols);
+    pool.parallel_for(
+        col_tiles,
+        [&](int ct) {
+          int c0 = ct * tile_cols;
+          int cols = std::min(tile_cols, b_cols - c0);
+          T *slab = b_slabs.get() + size_t(a_cols) * c0;
+          for (int k = 0; k < a_cols; ++k)
+            std::copy_n(b + size_t(k) * b_cols + c0, cols,
+                        slab + size_t(k) * cols);
+        },
+        threads);
+  }
+
+  pool.parallel_for(
+      row_tiles * col_tiles,
+      [&](int tile) {
+        int r0 = (tile / col_tiles) * tile_rows;
+        int c0 = (tile % col_tiles) * tile_cols;
+        int rows = std::min(tile_rows, a_rows - r0);
+        int cols = std::min(tile_cols, b_cols - c0);
+        const T *a_tile = a + size_t(r0) * a_cols;
+
+        if (col_tiles == 1) {
+          run(a_tile, b, c + size_t(r0) * b_cols, rows, b_cols);
+          return;
+        }
+
+        auto c_tile = make_aligned_buffer<T>(size_t(rows) * cols);
+        run(a_tile, b_slabs.get() + size_t(a_cols) * c0, c_tile.get(), rows,
+            cols);
+        for (int i = 0; i < rows; ++i)
+          std::copy_n(c_tile.get() + size_t(i) * cols, cols,
+                      c + size_t(r0 + i) * b_cols + c0);
+      },
+      threads);
+}
+
+// Multi-threaded matmul on the shared thread pool. num_threads = 0 takes the
+// thread count from the tuning cache, or the whole pool if the shape is not
+// tuned. The C++ reference implementation and padded matrices run through
+// the single-threaded matmul.
+template <typename T>
+Matrix<T> matmul_parallel(const Matrix<T> &a, const Matrix<T> &b,
+                          MatMulImpl impl = MatMulImpl::ASM_BLOCKED,
+                          int vlen = 0, int num_threads = 0) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+
+  impl = resolve_impl<T>(impl, a.rows(), b.cols(), a.cols());
+  if (impl == MatMulImpl::CPP_NAIVE || !a.is_contiguous() ||
+      !b.is_contiguous())
+    return matmul(a, b, impl, vlen);
+
+  // A tuned entry for the whole shape also fixes the tile parameters
+  std::optional<TuneParams> tuned = TuningCache::instance().find(
+      make_tune_key<T>(getImplKey(impl), a.rows(), b.cols(), a.cols()));
+  if (tuned && num_threads == 0)
+    num_threads = tuned->threads;
+
+  Matrix<T> result(a.rows(), b.cols(), typename Matrix<T>::Uninitialized{});
+
+  call_asm_impl_parallel(a.data(), b.data(), result.data(), a.rows(), a.cols(),
+                         b.cols(), impl, vlen, num_threads,
+                         tuned ? &*tuned : nullptr);
 
   return result;
-}
\ No newline at end of file
+}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "buffer_pool.h"
+#include "half.h"
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <iomanip>
+#include <limits>
 #include <ostream>
 #include <random>
 #include <stdexcept>
@@ -24,20 +27,139 @@ template <> struct NumericTraits<int8_t> {
   static constexpr int8_t random_max() { return 127; }
 };
 
+// 16-bit floats: one output rounding is ~3 (fp16) or ~2 (bf16) decimal digits
+template <> struct NumericTraits<float16> {
+  static float16 epsilon() { return float16(1e-2f); }
+  static float16 random_min() { return float16(-1.0f); }
+  static float16 random_max() { return float16(1.0f); }
+};
+
+template <> struct NumericTraits<bfloat16> {
+  static bfloat16 epsilon() { return bfloat16(5e-2f); }
+  static bfloat16 random_min() { return bfloat16(-1.0f); }
+  static bfloat16 random_max() { return bfloat16(1.0f); }
+};
+
 // Add more specializations for other types as needed
 
+// Short element type label ("int8", "float", ...) for reports and caches
+template <typename T> const char *element_type_name() { return "unknown"; }
+template <> inline const char *element_type_name<float>() { return "float"; }
+template <> inline const char *element_type_name<int8_t>() { return "int8"; }
+template <> inline const char *element_type_name<int16_t>() { return "int16"; }
+template <> inline const char *element_type_name<int32_t>() { return "int32"; }
+template <> inline const char *element_type_name<float16>() { return "fp16"; }
+template <> inline const char *element_type_name<bfloat16>() { return "bf16"; }
+
+// Accumulator of the C++ reference and the kernels: int32 for int8/int16,
+// int64 for int32, fp32 for float and the 16-bit float types
+template <typename T>
+using accumulator_t = std::conditional_t<
+    std::is_integral_v<T>,
+    std::conditional_t<sizeof(T) < sizeof(int32_t), int32_t, int64_t>,
+    std::conditional_t<is_half_float_v<T>, float, T>>;
+
+// Generic clamping for any numeric type
+template <typename T, typename AccumulatorT = T>
+T clamp_int(AccumulatorT value) {
+  if constexpr (std::is_integral_v<T>) {
+    // For integral types, clamp to type limits
+    if (value > static_cast<AccumulatorT>(std::numeric_limits<T>::max()))
+      return std::numeric_limits<T>::max();
+    if (value < static_cast<AccumulatorT>(std::numeric_limits<T>::min()))
+      return std::numeric_limits<T>::min();
+  }
+  // For floating types, no explicit clamping (IEEE handles overflow/underflow)
+  return static_cast<T>(value);
+}
+
+// Non-owning view of a row-major matrix whose rows are ld elements apart
+// (ld >= cols). Use MatrixView<const T> for read-only operands.
+template <typename T> class MatrixView {
+public:
+  MatrixView(T *data, size_t rows, size_t cols, size_t ld)
+      : data_(data), rows_(rows), cols_(cols), ld_(ld) {
+    if (ld_ < cols_) {
+      throw std::invalid_argument("Leading dimension smaller than column count");
+    }
+  }
+
+  MatrixView(T *data, size_t rows, size_t cols)
+      : MatrixView(data, rows, cols, cols) {}
+
+  // Allow MatrixView<T> -> MatrixView<const T>
+  template <typename U, typename = std::enable_if_t<
+                            std::is_same_v<const U, T> && !std::is_same_v<U, T>>>
+  MatrixView(const MatrixView<U> &other)
+      : MatrixView(other.data(), other.rows(), other.cols(), other.ld()) {}
+
+  // Access elements
+  T &at(size_t row, size_t col) const {
+    if (row >= rows_ || col >= cols_) {
+      throw std::out_of_range("Matrix indices out of bounds");
+    }
+    return data_[row * ld_ + col];
+  }
+
+  // Sub-matrix sharing this view's storage
+  MatrixView block(size_t row, size_t col, size_t rows, size_t cols) const {
+    if (row + rows > rows_ || col + cols > cols_) {
+      throw std::out_of_range("Block exceeds matrix bounds");
+    }
+    return MatrixView(data_ + row * ld_ + col, rows, cols, ld_);
+  }
+
+  // View properties
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  size_t ld() const { return ld_; }
+  T *data() const { return data_; }
+
+private:
+  T *data_;
+  size_t rows_;
+  size_t cols_;
+  size_t ld_;
+};
+
+// Row-major matrix with 64-byte aligned, pooled storage. Rows are stride()
+// elements apart; the stride equals cols() unless the matrix was created
+// with padded(), in which case every row starts on an aligned boundary and
+// the padding past cols() is kept at zero.
 template <typename T> class Matrix {
 public:
+  using Storage = std::vector<T, PoolAllocator<T>>;
+
+  // Tag for constructing without initializing the elements
+  struct Uninitialized {};
+
   // Constructors
   Matrix(size_t rows, size_t cols)
-      : rows_(rows), cols_(cols), data_(rows * cols, static_cast<T>(0)) {}
+      : rows_(rows), cols_(cols), stride_(cols),
+        data_(rows * cols, static_cast<T>(0)) {}
+
+  // Elements are left unset; for results that are about to be overwritten
+  Matrix(size_t rows, size_t cols, Uninitialized)
+      : rows_(rows), cols_(cols), stride_(cols) {
+    data_.resize(rows * cols);
+  }
 
   Matrix(size_t rows, size_t cols, const std::vector<T> &data)
-      : rows_(rows), cols_(cols) {
+      : rows_(rows), cols_(cols), stride_(cols) {
     if (data.size() != rows * cols) {
       throw std::invalid_argument("Data size doesn't match matrix dimensions");
     }
-    data_ = data;
+    data_.assign(data.begin(), data.end());
+  }
+
+  // Zero-filled matrix whose rows are padded to a multiple of
+  // row_align_bytes, so each row starts on a cache line. The assembly
+  // kernels take dense rows only: padded operands go to the stride-aware
+  // blocked driver
+  static Matrix padded(size_t rows, size_t cols, size_t row_align_bytes = 64) {
+    size_t align = std::max<size_t>(1, row_align_bytes / sizeof(T));
+    size_t stride = (cols + align - 1) / align * align;
+    return Matrix(rows, cols, Stride{stride});
   }
 
   // Access elements
@@ -45,41 +167,60 @@ public:
     if (row >= rows_ || col >= cols_) {
       throw std::out_of_range("Matrix indices out of bounds");
     }
-    return data_[row * cols_ + col];
+    return data_[row * stride_ + col];
   }
 
   const T &at(size_t row, size_t col) const {
     if (row >= rows_ || col >= cols_) {
       throw std::out_of_range("Matrix indices out of bounds");
     }
-    return data_[row * cols_ + col];
+    return data_[row * stride_ + col];
   }
 
   // Matrix properties
   size_t rows() const { return rows_; }
   size_t cols() const { return cols_; }
+  size_t stride() const { return stride_; }
+  bool is_contiguous() const { return stride_ == cols_; }
 
   // Raw data access (needed for assembly implementations)
   T *data() { return data_.data(); }
   const T *data() const { return data_.data(); }
 
+  // Non-owning views of the whole matrix
+  MatrixView<T> view() { return MatrixView<T>(data(), rows_, cols_, stride_); }
+  MatrixView<const T> view() const {
+    return MatrixView<const T>(data(), rows_, cols_, stride_);
+  }
+
   // Utility functions
-  void fill(T value) { std::fill(data_.begin(), data_.end(), value); }
+  void fill(T value) {
+    for (size_t i = 0; i < rows_; ++i)
+      std::fill_n(row_data(i), cols_, value);
+  }
 
   void randomize(T min = NumericTraits<T>::random_min(),
                  T max = NumericTraits<T>::random_max()) {
     std::random_device rd;
     std::mt19937 gen(rd());
+    randomize(gen, min, max);
+  }
 
+  // Draw from a caller-provided generator (fixed seeds give repeatable data)
+  void randomize(std::mt19937 &gen, T min = NumericTraits<T>::random_min(),
+                 T max = NumericTraits<T>::random_max()) {
     if constexpr (std::is_integral_v<T>) {
       std::uniform_int_distribution<int> dist(min, max);
-      for (auto &val : data_)
-        val = static_cast<T>(dist(gen));
+      for (size_t i = 0; i < rows_; ++i)
+        for (size_t j = 0; j < cols_; ++j)
+          row_data(i)[j] = static_cast<T>(dist(gen));
 
     } else {
-      std::uniform_real_distribution<float> dist(min, max);
-      for (auto &val : data_)
-        val = static_cast<T>(dist(gen));
+      std::uniform_real_distribution<float> dist(static_cast<float>(min),
+                                                 static_cast<float>(max));
+      for (size_t i = 0; i < rows_; ++i)
+        for (size_t j = 0; j < cols_; ++j)
+          row_data(i)[j] = static_cast<T>(dist(gen));
     }
   }
 
@@ -89,13 +230,17 @@ public:
       return false;
     }
 
-    for (size_t i = 0; i < data_.size(); ++i) {
-      if constexpr (std::is_floating_point_v<T>) {
-        if (std::fabs(data_[i] - other.data_[i]) > epsilon)
-          return false;
-      } else {
-        if (data_[i] != other.data_[i])
-          return false;
+    for (size_t i = 0; i < rows_; ++i) {
+      const T *row = row_data(i);
+      const T *other_row = other.row_data(i);
+      for (size_t j = 0; j < cols_; ++j) {
+        if constexpr (is_floating_element_v<T>) {
+          if (std::fabs(float(row[j]) - float(other_row[j])) > float(epsilon))
+            return false;
+        } else {
+          if (row[j] != other_row[j])
+            return false;
+        }
       }
     }
     return true;
@@ -107,9 +252,9 @@ public:
     for (size_t i = 0; i < matrix.rows_; ++i) {
       os << "  ";
       for (size_t j = 0; j < matrix.cols_; ++j) {
-        if constexpr (std::is_floating_point_v<T>) {
+        if constexpr (is_floating_element_v<T>) {
           os << std::setw(9) << std::fixed << std::setprecision(4)
-             << matrix.at(i, j) << " ";
+             << float(matrix.at(i, j)) << " ";
         } else {
           os << std::setw(6) << matrix.at(i, j) << " ";
         }
@@ -120,7 +265,19 @@ public:
   }
 
 private:
+  struct Stride {
+    size_t elements;
+  };
+
+  Matrix(size_t rows, size_t cols, Stride stride)
+      : rows_(rows), cols_(cols), stride_(stride.elements),
+        data_(rows * stride.elements, static_cast<T>(0)) {}
+
+  T *row_data(size_t row) { return data_.data() + row * stride_; }
+  const T *row_data(size_t row) const { return data_.data() + row * stride_; }
+
   size_t rows_;
   size_t cols_;
-  std::vector<T> data_;
+  size_t stride_;
+  Storage data_;
 };
\ No newline at end of file
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "matrix.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+// Binary matrix files, read back through mmap without copying.
+//
+// A file is a 128-byte header followed, at data_offset, by the elements as
+// they are laid out in memory:
+//
+//   offset  size  field
+//        0     8  magic "RVMATRIX"
+//        8     2  version (1)
+//       10     2  header size (128)
+//       12     1  element type (MatrixFileType)
+//       13     1  layout (MatrixFileLayout)
+//       14     2  data alignment in bytes (power of two, >= 64)
+//       16     8  rows
+//       24     8  cols
+//       32     8  stride: elements between rows (row-major layout)
+//       40     8  data offset, a multiple of the alignment
+//       48     8  data size in bytes
+//       56     8  checksum of the data (matrix_file_checksum)
+//       64    16  packing parameters mr, nr, kc, nc (uint32, 0 when unused)
+//       80    48  reserved, zero
+//
+// All fields are little-endian (the byte order of every supported target).
+// Row-major data keeps the stride and padding of the saved Matrix. Packed
+// layouts (micro-kernel panels, IME tiles) are stored as produced by the
+// packing code, with the parameters needed to interpret them, and are only
+// readable as raw bytes.
+//
+// MappedMatrix<T> maps the file read-only and shares the page cache, so the
+// weights cost no parse, no copy and no second resident copy; view() hands
+// them to gemm() and matmul() directly.
+
+enum class MatrixFileType : uint8_t {
+  Float32 = 1,
+  Int8 = 2,
+  Int16 = 3,
+  Int32 = 4,
+  Float16 = 5,
+  BFloat16 = 6,
+};
+
+enum class MatrixFileLayout : uint8_t {
+  RowMajor = 0,
+  PackedPanels = 1, // blocked micro-kernel panels (see blocked.h)
+  PackedIme = 2,    // IME vmadot tiles (see ime.h)
+};
+
+template <typename T> MatrixFileType matrix_file_type() {
+  if constexpr (std::is_same_v<T, float>)
+    return MatrixFileType::Float32;
+  else if constexpr (std::is_same_v<T, int8_t>)
+    return MatrixFileType::Int8;
+  else if constexpr (std::is_same_v<T, int16_t>)
+    return MatrixFileType::Int16;
+  else if constexpr (std::is_same_v<T, int32_t>)
+    return MatrixFileType::Int32;
+  else if constexpr (std::is_same_v<T, float16>)
+    return MatrixFileType::Float16;
+  else if constexpr (std::is_same_v<T, bfloat16>)
+    return MatrixFileType::BFloat16;
+  else
+    static_assert(sizeof(T) == 0, "No matrix file type for this element");
+}
+
+struct MatrixFileHeader {
+  char magic[8];
+  uint16_t version;
+  uint16_t header_size;
+  MatrixFileType type;
+  MatrixFileLayout layout;
+  uint16_t alignment;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t stride;
+  uint64_t data_offset;
+  uint64_t data_bytes;
+  uint64_t checksum;
+  uint32_t pack_mr, pack_nr, pack_kc, pack_nc;
+  uint8_t reserved[48];
+};
+
+static_assert(sizeof(MatrixFileHeader) == 128 &&
+                  offsetof(MatrixFileHeader, rows) == 16 &&
+                  offsetof(MatrixFileHeader, checksum) == 56 &&
+                  offsetof(MatrixFileHeader, pack_mr) == 64,
+              "MatrixFileHeader layout is part of the file format");
+
+constexpr char kMatrixFileMagic[8] = {'R', 'V', 'M', 'A', 'T', 'R', 'I', 'X'};
+constexpr uint16_t kMatrixFileVersion = 1;
+
+// FNV-1a over the data as 64-bit little-endian words, then the tail bytes
+inline uint64_t matrix_file_checksum(const void *data, size_t bytes) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  uint64_t hash = 14695981039346656037ULL;
+  constexpr uint64_t prime = 1099511628211ULL;
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, p + i, sizeof(word));
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < bytes; ++i)
+    hash = (hash ^ p[i]) * prime;
+  return hash;
+}
+
+// Write a header and bytes of data, padded to alignment. Fills in magic,
+// version, sizes, offset and checksum; throws std::runtime_error on failure.
+inline void write_matrix_file(const std::string &path,
+                              MatrixFileHeader header, const void *data,
+                              size_t bytes, size_t alignment = 64) {
+  if (alignment < 64 || (alignment & (alignment - 1)) || alignment > 32768)
+    throw std::invalid_argument(
+        "Matrix file alignment must be a power of two in [64, 32768]");
+
+  std::memcpy(header.magic, kMatrixFileMagic, sizeof(header.magic));
+  header.version = kMatrixFileVersion;
+  header.header_size = sizeof(MatrixFileHeader);
+  header.alignment = uint16_t(alignment);
+  header.data_offset =
+      (sizeof(MatrixFileHeader) + alignment - 1) / alignment * alignment;
+  header.data_bytes = bytes;
+  header.checksum = matrix_file_checksum(data, bytes);
+  std::memset(header.reserved, 0, sizeof(header.reserved));
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("Cannot write matrix file " + path);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  static const char zeros[32768] = {};
+  out.write(zeros, std::streamsize(header.data_offset - sizeof(header)));
+  out.write(static_cast<const char *>(data), std::streamsize(bytes));
+  if (!out)
+    throw std::runtime_error("Cannot write matrix file " + path);
+}
+
+// Save a row-major matrix, padding and stride included
+template <typename T>
+void save_matrix(const std::string &path, const Matrix<T> &matrix,
+                 size_t alignment = 64) {
+  MatrixFileHeader header = {};
+  header.type = matrix_file_type<T>();
+  header.layout = MatrixFileLayout::RowMajor;
+  header.rows = matrix.rows();
+  header.cols = matrix.cols();
+  header.stride = matrix.stride();
+  write_matrix_file(path, header, matrix.data(),
+                    matrix.rows() * matrix.stride() * sizeof(T), alignment);
+}
+
+// Read-only memory mapping of a matrix file. The header is validated on
+// open; the checksum too, unless verify_checksum is false (it reads every
+// page once). Throws std::runtime_error for unreadable or malformed files
+// and for a type other than T.
+template <typename T> class MappedMatrix {
+public:
+  explicit MappedMatrix(const std::string &path, bool verify_checksum = true) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error("Cannot open matrix file " + path + ": " +
+                               std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        size_t(st.st_size) < sizeof(MatrixFileHeader)) {
+      ::close(fd);
+      throw std::runtime_error("Truncated matrix file " + path);
+    }
+    size_ = size_t(st.st_size);
+    void *base = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+      throw std::runtime_error("Cannot map matrix file " + path + ": " +
+                               std::strerror(errno));
+    base_ = base;
+
+    try {
+      validate(path, verify_checksum);
+    } catch (...) {
+      ::munmap(base_, size_);
+      throw;
+    }
+  }
+
+  MappedMatrix(MappedMatrix &&other) noexcept
+      : base_(std::exchange(other.base_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  MappedMatrix &operator=(MappedMatrix &&other) noexcept {
+    if (this != &other) {
+      if (base_)
+        ::munmap(base_, size_);
+      base_ = std::exchange(other.base_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  MappedMatrix(const MappedMatrix &) = delete;
+  MappedMatrix &operator=(const MappedMatrix &) = delete;
+
+  ~MappedMatrix() {
+    if (base_)
+      ::munmap(base_, size_);
+  }
+
+  const MatrixFileHeader &header() const {
+    return *static_cast<const MatrixFileHeader *>(base_);
+  }
+
+  size_t rows() const { return header().rows; }
+  size_t cols() const { return header().cols; }
+  size_t stride() const { return header().stride; }
+  MatrixFileLayout layout() const { return header().layout; }
+
+  // The data as stored (any layout), aligned to header().alignment
+  const void *bytes() const {
+    return static_cast<const char *>(base_) + header().data_offset;
+  }
+  size_t num_bytes() const { return header().data_bytes; }
+
+  // Row-major data; throws std::logic_error for packed layouts
+  const T *data() const {
+    if (layout() != MatrixFileLayout::RowMajor)
+      throw std::logic_error("Packed matrix file has no row-major view");
+    return static_cast<const T *>(bytes());
+  }
+
+  MatrixView<const T> view() const {
+    return MatrixView<const T>(data(), rows(), cols(), stride());
+  }
+
+  // Copy into an owned, contiguous Matrix
+  Matrix<T> to_matrix() const {
+    Matrix<T> matrix(rows(), cols(), typename Matrix<T>::Uninitialized{});
+    MatrixView<const T> v = view();
+    for (size_t i = 0; i < rows(); ++i)
+      std::memcpy(matrix.data() + i * cols(), v.data() + i * v.ld(),
+                  cols() * sizeof(T));
+    return matrix;
+  }
+
+private:
+  void validate(const std::string &path, bool verify_checksum) const {
+    const MatrixFileHeader &h = header();
+    auto fail = [&](const std::string &what) {
+      throw std::runtime_error("Malformed matrix file " + path + ": " + what);
+    };
+    if (std::memcmp(h.magic, kMatrixFileMagic, sizeof(h.magic)) != 0)
+      fail("bad magic");
+    if (h.version != kMatrixFileVersion)
+      fail("unsupported version " + std::to_string(h.version));
+    if (h.header_size != sizeof(MatrixFileHeader))
+      fail("unexpected header size");
+    if (h.type != matrix_file_type<T>())
+      throw std::runtime_error("Matrix file " + path +
+                               " holds another element type");
+    if (h.alignment < 64 || (h.alignment & (h.alignment - 1)) ||
+        h.data_offset % h.alignment != 0 ||
+        h.data_offset < sizeof(MatrixFileHeader))
+      fail("misaligned data");
+    if (h.data_offset > size_ || h.data_bytes > size_ - h.data_offset)
+      fail("data extends past the end of the file");
+    if (h.layout == MatrixFileLayout::RowMajor) {
+      if (h.stride < h.cols)
+        fail("stride smaller than the column count");
+      if (h.rows != 0 && h.stride > (h.data_bytes / sizeof(T)) / h.rows)
+        fail("data smaller than rows x stride");
+    } else if (h.layout != MatrixFileLayout::PackedPanels &&
+               h.layout != MatrixFileLayout::PackedIme) {
+      fail("unknown layout");
+    }
+    if (verify_checksum &&
+        matrix_file_checksum(bytes(), h.data_bytes) != h.checksum)
+      fail("checksum mismatch");
+  }
+
+  void *base_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "blocked.h"
+#include "ime.h"
+#include "matmul.h"
+#include "matrix.h"
+#include "matrix_file.h"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Weights packed once for repeated products A * B, where B is fixed and A
+// changes on every call (inference).
+//
+// Every matmul() packs B again, reading it through its row stride. A
+// PackedMatrix does that once and keeps B in the order the kernels consume
+// it, so matmul(a, packed) only packs A. It holds one of two layouts:
+//
+//   PackedPanels  the blocked driver's micro-panels (blocked.h): column
+//                 blocks of NC, each cut into depth blocks of KC, each a run
+//                 of NR-wide panels of KC rows. The (pc, jc) block starts at
+//                 element jc * k + pc * round_up(nc_cur, NR).
+//   PackedIme     pack_ime_b tiles over the whole of B (ime.h), for int8 on
+//                 cores with IME
+//
+// KC and NC are fixed at pack time; MC still follows the tuned blocks of each
+// call's shape. A PackedMatrix is immutable after construction, so threads
+// can share one, and copies share the packed data. save_packed_matrix()
+// writes it to a matrix file that PackedMatrix(MappedMatrix) maps back
+// without packing again; the file records the panel geometry, which must
+// match the kernels of the build that reads it.
+
+template <typename T> class PackedMatrix {
+public:
+  using Traits = BlockedTraits<T>;
+  using PackType = typename Traits::PackType;
+
+  // Pack b. int8 weights take the IME tile order when the core has IME and
+  // impl is ASM_IME or AUTO; everything else takes blocked panels with the
+  // KC x NC blocks of bs, rounded to whole micro-panels.
+  explicit PackedMatrix(MatrixView<const T> b,
+                        MatMulImpl impl = MatMulImpl::AUTO,
+                        BlockSizes bs = Traits::defaults())
+      : rows_(b.rows()), cols_(b.cols()) {
+    if constexpr (std::is_same_v<T, int8_t>)
+      if ((impl == MatMulImpl::ASM_IME || impl == MatMulImpl::AUTO) &&
+          ime_available())
+        layout_ = MatrixFileLayout::PackedIme;
+
+    if (layout_ == MatrixFileLayout::PackedIme) {
+      if constexpr (std::is_same_v<T, int8_t>) {
+        size_ = ime_b_pack_size(int(rows_), int(cols_));
+        auto pack = allocate();
+        pack_ime_b(b.data(), int(rows_), int(cols_), b.ld(), pack);
+      }
+      return;
+    }
+
+    kc_ = std::max(1, bs.kc);
+    nc_ = std::max(Traits::NR, bs.nc / Traits::NR * Traits::NR);
+    size_ = rows_ * round_up(cols_);
+    PackType *pack = allocate();
+    const int k = int(rows_), n = int(cols_);
+    for (int jc = 0; jc < n; jc += nc_) {
+      int nc_cur = std::min(nc_, n - jc);
+      for (int pc = 0; pc < k; pc += kc_) {
+        int kc_cur = std::min(kc_, k - pc);
+        pack_b_block<PackType, Traits::NR>(b.data() + pc * b.ld() + jc,
+                                           b.ld(), 1, kc_cur, nc_cur,
+                                           pack + offset(jc, pc, nc_cur));
+      }
+    }
+  }
+
+  explicit PackedMatrix(const Matrix<T> &b, MatMulImpl impl = MatMulImpl::AUTO,
+                        BlockSizes bs = Traits::defaults())
+      : PackedMatrix(b.view(), impl, bs) {}
+
+  // Adopt a file written by save_packed_matrix, keeping it mapped. Throws
+  // std::runtime_error if the file is not packed for this build's kernels.
+  explicit PackedMatrix(MappedMatrix<T> file)
+      : rows_(file.rows()), cols_(file.cols()), layout_(file.layout()) {
+    const MatrixFileHeader &h = file.header();
+    if (layout_ == MatrixFileLayout::PackedIme) {
+      if (!std::is_same_v<T, int8_t> || !ime_available())
+        throw std::runtime_error("IME-packed matrix needs an int8 IME core");
+      if (h.pack_mr != uint32_t(ImeInt8Traits::MR) ||
+          h.pack_nr != uint32_t(ImeInt8Traits::NR) ||
+          h.pack_kc != uint32_t(ImeInt8Traits::KT))
+        throw std::runtime_error("Matrix file has another IME tile shape");
+      size_ = ime_b_pack_size(int(rows_), int(cols_));
+    } else if (layout_ == MatrixFileLayout::PackedPanels) {
+      if (h.pack_mr != uint32_t(Traits::MR) ||
+          h.pack_nr != uint32_t(Traits::NR) || h.pack_kc == 0 ||
+          h.pack_nc == 0 || h.pack_nc % Traits::NR != 0)
+        throw std::runtime_error("Matrix file has another panel shape");
+      kc_ = int(h.pack_kc);
+      nc_ = int(h.pack_nc);
+      size_ = rows_ * round_up(cols_);
+    } else {
+      throw std::runtime_error("Matrix file is not packed");
+    }
+    if (file.num_bytes() != size_ * sizeof(PackType))
+      throw std::runtime_error("Packed matrix file has the wrong data size");
+
+    auto mapped = std::make_shared<MappedMatrix<T>>(std::move(file));
+    data_ = static_cast<const PackType *>(mapped->bytes());
+    storage_ = std::move(mapped);
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  MatrixFileLayout layout() const { return layout_; }
+
+  // Depth and width of the panel blocks (0 for IME tiles)
+  int kc() const { return kc_; }
+  int nc() const { return nc_; }
+
+  // The packed elements, size() of them
+  const PackType *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Panels of the kc_cur x nc_cur block at depth pc and column jc
+  const PackType *panels(int jc, int pc, int nc_cur) const {
+    return data_ + offset(jc, pc, nc_cur);
+  }
+
+private:
+  static size_t round_up(size_t cols) {
+    return (cols + Traits::NR - 1) / Traits::NR * Traits::NR;
+  }
+
+  size_t offset(int jc, int pc, int nc_cur) const {
+    return size_t(jc) * rows_ + size_t(pc) * round_up(size_t(nc_cur));
+  }
+
+  PackType *allocate() {
+    auto buffer = make_aligned_buffer<PackType>(std::max<size_t>(size_, 1));
+    AlignedFree deleter = buffer.get_deleter();
+    PackType *pack = buffer.release();
+    storage_ = std::shared_ptr<PackType>(pack, deleter);
+    data_ = pack;
+    return pack;
+  }
+
+  size_t rows_, cols_;
+  MatrixFileLayout layout_ = MatrixFileLayout::PackedPanels;
+  int kc_ = 0, nc_ = 0;
+  size_t size_ = 0;
+  const PackType *data_ = nullptr;
+  std::shared_ptr<const void> storage_;
+};
+
+// Write packed weights with their panel geometry (see matrix_file.h)
+template <typename T>
+void save_packed_matrix(const std::string &path, const PackedMatrix<T> &packed,
+                        size_t alignment = 64) {
+  using Traits = BlockedTraits<T>;
+  MatrixFileHeader header = {};
+  header.type = matrix_file_type<T>();
+  header.layout = packed.layout();
+  header.rows = packed.rows();
+  header.cols = packed.cols();
+  if (packed.layout() == MatrixFileLayout::PackedIme) {
+    header.pack_mr = ImeInt8Traits::MR;
+    header.pack_nr = ImeInt8Traits::NR;
+    header.pack_kc = ImeInt8Traits::KT;
+  } else {
+    header.pack_mr = Traits::MR;
+    header.pack_nr = Traits::NR;
+    header.pack_kc = uint32_t(packed.kc());
+    header.pack_nc = uint32_t(packed.nc());
+  }
+  write_matrix_file(path, header, packed.data(),
+                    packed.size() * sizeof(typename Traits::PackType),
+                    alignment);
+}
+
+// C (m x b.cols(), rows ldc apart) = A (m x b.rows(), rows lda apart) * B
+// with B prepacked: only A is packed per call. Saturation and rounding match
+// matmul() with ASM_BLOCKED (or ASM_IME for IME tiles). TC is T, or float
+// for fp16 / bf16 to keep the fp32 result.
+template <typename T, typename TC = T>
+void matmul_packed(const T *a, int lda, const PackedMatrix<T> &b, TC *c,
+                   int ldc, int m) {
+  const int k = int(b.rows()), n = int(b.cols());
+  if (m < 0)
+    throw std::invalid_argument("Negative matrix dimension");
+  if (lda < k || ldc < n)
+    throw std::invalid_argument("Leading dimension too small");
+  if (m == 0 || n == 0)
+    return;
+
+  MATMUL_PERF_SCOPE(std::string("packed/") + element_type_name<T>(),
+                    2.0 * double(m) * double(n) * double(k));
+  if (b.layout() == MatrixFileLayout::PackedIme) {
+#ifdef MATMUL_HAVE_IME
+    if constexpr (std::is_same_v<T, int8_t> && std::is_same_v<TC, int8_t>) {
+      matmul_ime_int8_packed(a, size_t(lda), b.data(), c, size_t(ldc), m, k,
+                             n, VectorOpTraits<int8_t>::min_value(),
+                             VectorOpTraits<int8_t>::max_value());
+      return;
+    }
+#endif
+    throw std::logic_error("IME-packed matrix on a build without IME");
+  }
+
+  using Traits = BlockedTraits<T>;
+  BlockSizes bs =
+      tuned_blocks<T>(tuned_params<T>(MatMulImpl::ASM_BLOCKED, m, n, k));
+  int mc = std::max(Traits::MR, bs.mc / Traits::MR * Traits::MR);
+  gemm_blocked_driver<T, TC>(
+      false, m, n, k, T(1), a, lda, T(0), c, ldc, mc, b.kc(), b.nc(),
+      [&](int jc, int pc, int, int nc_cur) {
+        return b.panels(jc, pc, nc_cur);
+      });
+}
+
+// Multiply by prepacked weights into a caller-owned result: c must be
+// a.rows() x b.cols()
+template <typename T, typename TC>
+void matmul(const Matrix<T> &a, const PackedMatrix<T> &b, Matrix<TC> &c) {
+  static_assert(std::is_same_v<TC, T> ||
+                    (is_half_float_v<T> && std::is_same_v<TC, float>),
+                "C must have the input type, or float for 16-bit floats");
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a.rows() || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong shape");
+
+  matmul_packed<T, TC>(a.data(), int(a.stride()), b, c.data(),
+                       int(c.stride()), int(a.rows()));
+}
+
+// Views, e.g. activations inside a larger buffer
+template <typename T, typename TA, typename TC>
+void matmul(MatrixView<TA> a, const PackedMatrix<T> &b, MatrixView<TC> c) {
+  static_assert(std::is_same_v<std::remove_const_t<TA>, T>,
+                "matmul operands must share one element type");
+  static_assert(std::is_same_v<TC, T> ||
+                    (is_half_float_v<T> && std::is_same_v<TC, float>),
+                "C must have the input type, or float for 16-bit floats");
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a.rows() || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong shape");
+
+  matmul_packed<T, TC>(a.data(), int(a.ld()), b, c.data(), int(c.ld()),
+                       int(a.rows()));
+}
+
+template <typename T>
+Matrix<T> matmul(const Matrix<T> &a, const PackedMatrix<T> &b) {
+  // matmul_packed writes all of C, so skip zero-filling the result
+  Matrix<T> result(a.rows(), b.cols(), typename Matrix<T>::Uninitialized{});
+  matmul(a, b, result);
+  return result;
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+// Opt-in hardware counter instrumentation.
+//
+// Build with -DMATMUL_ENABLE_PERF_COUNTERS=ON (defines MATMUL_PERF_COUNTERS)
+// to record cycles, retired instructions and cache misses per kernel and per
+// phase. MATMUL_PERF_SCOPE(name[, flops, bytes]) attributes everything up to
+// the end of the enclosing block to `name`; perf_report() prints the totals
+// with IPC, cycles per FLOP and achieved bandwidth. Without the option the
+// macro expands to nothing and perf_report() is an empty inline function.
+//
+// Counters come from perf_event_open when the kernel allows it (this also
+// provides cache misses). Otherwise RISC-V falls back to rdcycle/rdinstret,
+// probed once since Linux may disable them in user mode. Each thread opens
+// its own counters, so work on the thread pool is attributed correctly.
+
+#include <ostream>
+
+#ifdef MATMUL_PERF_COUNTERS
+
+#include "cpu_features.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct PerfSample {
+  uint64_t ns = 0;
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t cache_misses = 0;
+};
+
+struct PerfTotals {
+  uint64_t calls = 0;
+  PerfSample sample;
+  double flops = 0.0;
+  double bytes = 0.0;
+};
+
+// Per-thread counter source
+class PerfCounterGroup {
+public:
+  PerfCounterGroup() {
+#ifdef __linux__
+    fd_cycles_ = open_event(PERF_COUNT_HW_CPU_CYCLES);
+    fd_instructions_ = open_event(PERF_COUNT_HW_INSTRUCTIONS);
+    fd_cache_misses_ = open_event(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    use_rdcycle_ = (fd_cycles_ < 0 || fd_instructions_ < 0) && rdcycle_usable();
+  }
+
+  ~PerfCounterGroup() {
+#ifdef __linux__
+    for (int fd : {fd_cycles_, fd_instructions_, fd_cache_misses_})
+      if (fd >= 0)
+        close(fd);
+#endif
+  }
+
+  PerfCounterGroup(const PerfCounterGroup &) = delete;
+  PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+  static PerfCounterGroup &this_thread() {
+    thread_local PerfCounterGroup group;
+    return group;
+  }
+
+  PerfSample read() const {
+    PerfSample s;
+    s.ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count());
+    if (use_rdcycle_) {
+      s.cycles = rdcycle();
+      s.instructions = rdinstret();
+    } else {
+      s.cycles = read_fd(fd_cycles_);
+      s.instructions = read_fd(fd_instructions_);
+    }
+    s.cache_misses = read_fd(fd_cache_misses_);
+    return s;
+  }
+
+private:
+#ifdef __linux__
+  static int open_event(uint64_t config) {
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+
+  static uint64_t read_fd(int fd) {
+    uint64_t value = 0;
+#ifdef __linux__
+    if (fd >= 0 && ::read(fd, &value, sizeof(value)) != sizeof(value))
+      value = 0;
+#endif
+    return value;
+  }
+
+  static uint64_t rdcycle() {
+    uint64_t value = 0;
+#ifdef __riscv
+    __asm__ volatile("rdcycle %0" : "=r"(value));
+#endif
+    return value;
+  }
+
+  static uint64_t rdinstret() {
+    uint64_t value = 0;
+#ifdef __riscv
+    __asm__ volatile("rdinstret %0" : "=r"(value));
+#endif
+    return value;
+  }
+
+  // rdcycle traps when the kernel has not enabled user access
+  static bool rdcycle_usable() {
+#ifdef __riscv
+    static const bool usable = sigill_probe([]() -> long {
+                                 rdcycle();
+                                 rdinstret();
+                                 return 1;
+                               }).has_value();
+    return usable;
+#else
+    return false;
+#endif
+  }
+
+  int fd_cycles_ = -1;
+  int fd_instructions_ = -1;
+  int fd_cache_misses_ = -1;
+  bool use_rdcycle_ = false;
+};
+
+// Process-wide totals, keyed by scope name
+class PerfRegistry {
+public:
+  static PerfRegistry &instance() {
+    static PerfRegistry *registry = new PerfRegistry();
+    return *registry;
+  }
+
+  void add(const std::string &name, const PerfSample &delta, double flops,
+           double bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PerfTotals &t = totals_[name];
+    t.calls++;
+    t.sample.ns += delta.ns;
+    t.sample.cycles += delta.cycles;
+    t.sample.instructions += delta.instructions;
+    t.sample.cache_misses += delta.cache_misses;
+    t.flops += flops;
+    t.bytes += bytes;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    totals_.clear();
+  }
+
+  void report(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (totals_.empty())
+      return;
+    os << "\nPerformance counters:\n"
+       << std::left << std::setw(32) << "  scope" << std::right
+       << std::setw(8) << "calls" << std::setw(12) << "ms" << std::setw(12)
+       << "Mcycles" << std::setw(12) << "Minstr" << std::setw(7) << "IPC"
+       << std::setw(11) << "cyc/FLOP" << std::setw(9) << "GB/s"
+       << std::setw(12) << "cache miss" << "\n";
+    for (const auto &entry : totals_) {
+      const PerfTotals &t = entry.second;
+      double ms = double(t.sample.ns) * 1e-6;
+      double ipc = t.sample.cycles
+                       ? double(t.sample.instructions) / double(t.sample.cycles)
+                       : 0.0;
+      double cycles_per_flop = t.flops > 0.0 ? double(t.sample.cycles) / t.flops
+                                             : 0.0;
+      double gbps = t.sample.ns ? t.bytes / double(t.sample.ns) : 0.0;
+      os << "  " << std::left << std::setw(30) << entry.first << std::right
+         << std::setw(8) << t.calls << std::fixed << std::setprecision(3)
+         << std::setw(12) << ms << std::setw(12)
+         << double(t.sample.cycles) * 1e-6 << std::setw(12)
+         << double(t.sample.instructions) * 1e-6 << std::setprecision(2)
+         << std::setw(7) << ipc << std::setprecision(3) << std::setw(11)
+         << cycles_per_flop << std::setprecision(2) << std::setw(9) << gbps
+         << std::setw(12) << t.sample.cache_misses << "\n";
+    }
+  }
+
+private:
+  PerfRegistry() = default;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, PerfTotals> totals_;
+};
+
+// Records counters from construction to destruction under `name`
+class PerfScope {
+public:
+  explicit PerfScope(std::string name, double flops = 0.0, double bytes = 0.0)
+      : name_(std::move(name)), flops_(flops), bytes_(bytes),
+        start_(PerfCounterGroup::this_thread().read()) {}
+
+  ~PerfScope() {
+    PerfSample end = PerfCounterGroup::this_thread().read();
+    PerfSample delta;
+    delta.ns = end.ns - start_.ns;
+    delta.cycles = end.cycles - start_.cycles;
+    delta.instructions = end.instructions - start_.instructions;
+    delta.cache_misses = end.cache_misses - start_.cache_misses;
+    PerfRegistry::instance().add(name_, delta, flops_, bytes_);
+  }
+
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+  std::string name_;
+  double flops_;
+  double bytes_;
+  PerfSample start_;
+};
+
+#define MATMUL_PERF_CONCAT_(a, b) a##b
+#define MATMUL_PERF_CONCAT(a, b) MATMUL_PERF_CONCAT_(a, b)
+#define MATMUL_PERF_SCOPE(...)                                                 \
+  PerfScope MATMUL_PERF_CONCAT(matmul_perf_scope_, __LINE__)(__VA_ARGS__)
+
+inline void perf_report(std::ostream &os) {
+  PerfRegistry::instance().report(os);
+}
+
+inline void perf_reset() { PerfRegistry::instance().reset(); }
+
+#else
+
+#define MATMUL_PERF_SCOPE(...) ((void)0)
+
+inline void perf_report(std::ostream &) {}
+inline void perf_reset() {}
+
+#endif
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "matrix.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Quantized int8 GEMM.
+//
+// matmul_int32 returns the raw int32 accumulators of A * B. matmul_requant
+// computes the real-valued product of two affine-quantized matrices
+//
+//   C = (A - a_zero_point) * (B - b_zero_point) + bias
+//
+// and requantizes it to int8 or uint8 in the kernel epilogue, while the
+// accumulators are still in vector registers:
+//
+//   q = clamp(round(C * scale) + c_zero_point)
+//
+// Zero-point corrections are folded into a per-column and a per-row int32
+// offset ahead of time (row/column sums of A and B), so the kernel only adds
+// two offsets, scales, rounds and clamps.
+
+// Parameters of matmul_requant
+struct RequantParams {
+  int32_t a_zero_point = 0; // zero point of A (activations)
+  int32_t b_zero_point = 0; // zero point of B (weights), per tensor
+
+  // Combined scale a_scale * b_scale / c_scale: one value (per tensor) or
+  // one per output column (per channel)
+  std::vector<float> scale = {1.0f};
+
+  // Optional int32 bias per output column, in accumulator units
+  std::vector<int32_t> bias;
+
+  int32_t c_zero_point = 0; // zero point of the output
+
+  // Activation, in output units: relu clamps at c_zero_point (real 0), and
+  // [clip_min, clip_max] narrows the output range further
+  bool relu = false;
+  int32_t clip_min = std::numeric_limits<int32_t>::min();
+  int32_t clip_max = std::numeric_limits<int32_t>::max();
+};
+
+// Epilogue parameters read by the assembly kernel. Field offsets are
+// hard-coded there; keep the two in sync.
+struct QuantEpilogue {
+  const int32_t *col_offset; // per column, may be null
+  const int32_t *row_offset; // per row, may be null
+  const float *scale;
+  int32_t scale_stride; // bytes between scales: 0 per tensor, 4 per channel
+  int32_t out_zero_point;
+  int32_t out_min;
+  int32_t out_max;
+};
+
+static_assert(offsetof(QuantEpilogue, col_offset) == 0 &&
+                  offsetof(QuantEpilogue, row_offset) == 8 &&
+                  offsetof(QuantEpilogue, scale) == 16 &&
+                  offsetof(QuantEpilogue, scale_stride) == 24 &&
+                  offsetof(QuantEpilogue, out_zero_point) == 28 &&
+                  offsetof(QuantEpilogue, out_min) == 32 &&
+                  offsetof(QuantEpilogue, out_max) == 36,
+              "QuantEpilogue layout must match matmul_vector_int8_requant.S");
+
+extern "C" {
+// C = A * B as int32 (ep == nullptr) or requantized to 8 bits (ep != nullptr)
+void matmul_asm_vector_int8_requant(const int8_t *a, const int8_t *b, void *c,
+                                    int a_rows, int a_cols, int b_cols,
+                                    const QuantEpilogue *ep, int vlen);
+}
+
+// Output range after the activation, in output units
+template <typename OutT>
+std::pair<int32_t, int32_t> requant_output_range(const RequantParams &params) {
+  static_assert(std::is_same_v<OutT, int8_t> || std::is_same_v<OutT, uint8_t>,
+                "Requantized output must be int8_t or uint8_t");
+  int32_t lo = std::numeric_limits<OutT>::min();
+  int32_t hi = std::numeric_limits<OutT>::max();
+  if (params.relu)
+    lo = std::max(lo, params.c_zero_point);
+  lo = std::max(lo, params.clip_min);
+  hi = std::min(hi, params.clip_max);
+  if (lo > hi)
+    throw std::invalid_argument("Empty requantization output range");
+  return {lo, hi};
+}
+
+inline void validate_requant_params(const RequantParams &params, size_t cols) {
+  if (params.scale.size() != 1 && params.scale.size() != cols)
+    throw std::invalid_argument(
+        "Requantization scale must have 1 or b_cols entries");
+  if (!params.bias.empty() && params.bias.size() != cols)
+    throw std::invalid_argument("Bias must have b_cols entries");
+}
+
+// C (a_rows x b_cols, int32) = A * B with no saturation
+inline Matrix<int32_t> matmul_int32(const Matrix<int8_t> &a,
+                                    const Matrix<int8_t> &b, int vlen = 0) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+
+  Matrix<int32_t> result(a.rows(), b.cols(),
+                         Matrix<int32_t>::Uninitialized{});
+  if (a.is_contiguous() && b.is_contiguous()) {
+    matmul_asm_vector_int8_requant(a.data(), b.data(), result.data(), a.rows(),
+                                   a.cols(), b.cols(), nullptr, vlen);
+    return result;
+  }
+
+  for (size_t i = 0; i < a.rows(); ++i)
+    for (size_t j = 0; j < b.cols(); ++j) {
+      int32_t sum = 0;
+      for (size_t k = 0; k < a.cols(); ++k)
+        sum += int32_t(a.at(i, k)) * int32_t(b.at(k, j));
+      result.at(i, j) = sum;
+    }
+  return result;
+}
+
+// C++ reference for matmul_requant, following the kernel's arithmetic
+// (int32 accumulation, float scaling, round to nearest even)
+template <typename OutT>
+Matrix<OutT> matmul_requant_cpp_naive(const Matrix<int8_t> &a,
+                                      const Matrix<int8_t> &b,
+                                      const RequantParams &params) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  validate_requant_params(params, b.cols());
+  auto [lo, hi] = requant_output_range<OutT>(params);
+
+  Matrix<OutT> result(a.rows(), b.cols(), typename Matrix<OutT>::Uninitialized{});
+  for (size_t i = 0; i < a.rows(); ++i) {
+    for (size_t j = 0; j < b.cols(); ++j) {
+      int32_t sum = params.bias.empty() ? 0 : params.bias[j];
+      for (size_t k = 0; k < a.cols(); ++k)
+        sum += (int32_t(a.at(i, k)) - params.a_zero_point) *
+               (int32_t(b.at(k, j)) - params.b_zero_point);
+
+      float s = params.scale.size() == 1 ? params.scale[0] : params.scale[j];
+      float q = std::nearbyint(float(sum) * s);
+      q = std::min(std::max(q, float(lo - params.c_zero_point)),
+                   float(hi - params.c_zero_point));
+      result.at(i, j) = static_cast<OutT>(int32_t(q) + params.c_zero_point);
+    }
+  }
+  return result;
+}
+
+// Quantized C (a_rows x b_cols) = requant(A * B) with the epilogue fused
+// into the int8 vector kernel. OutT is int8_t or uint8_t.
+template <typename OutT>
+Matrix<OutT> matmul_requant(const Matrix<int8_t> &a, const Matrix<int8_t> &b,
+                            const RequantParams &params, int vlen = 0) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  validate_requant_params(params, b.cols());
+  auto [lo, hi] = requant_output_range<OutT>(params);
+
+  // The kernel wants dense rows; padded inputs take the reference path
+  if (!a.is_contiguous() || !b.is_contiguous())
+    return matmul_requant_cpp_naive<OutT>(a, b, params);
+
+  const int m = a.rows(), k = a.cols(), n = b.cols();
+  const int32_t za = params.a_zero_point, zb = params.b_zero_point;
+
+  // sum_k (a - za)(b - zb) = sum_k a*b - zb*rowsum(A) - za*colsum(B) + k*za*zb
+  std::vector<int32_t> col_offset, row_offset;
+  {
+    MATMUL_PERF_SCOPE("requant/int8/offsets");
+    if (za != 0 || !params.bias.empty()) {
+      col_offset.assign(n, k * za * zb);
+      if (!params.bias.empty()) {
+        for (int j = 0; j < n; ++j)
+          col_offset[j] += params.bias[j];
+      }
+      if (za != 0) {
+        for (int p = 0; p < k; ++p)
+          for (int j = 0; j < n; ++j)
+            col_offset[j] -= za * int32_t(b.data()[size_t(p) * n + j]);
+      }
+    }
+
+    if (zb != 0) {
+      row_offset.assign(m, 0);
+      for (int i = 0; i < m; ++i) {
+        int32_t row_sum = 0;
+        for (int p = 0; p < k; ++p)
+          row_sum += a.data()[size_t(i) * k + p];
+        row_offset[i] = -zb * row_sum;
+      }
+    }
+  }
+
+  QuantEpilogue ep;
+  ep.col_offset = col_offset.empty() ? nullptr : col_offset.data();
+  ep.row_offset = row_offset.empty() ? nullptr : row_offset.data();
+  ep.scale = params.scale.data();
+  ep.scale_stride = params.scale.size() == 1 ? 0 : int32_t(sizeof(float));
+  ep.out_zero_point = params.c_zero_point;
+  ep.out_min = lo;
+  ep.out_max = hi;
+
+  Matrix<OutT> result(m, n, typename Matrix<OutT>::Uninitialized{});
+  MATMUL_PERF_SCOPE("requant/int8/compute", 2.0 * m * n * k,
+                    double(m) * k + double(k) * n + double(m) * n);
+  matmul_asm_vector_int8_requant(a.data(), b.data(), result.data(), m, k, n,
+                                 &ep, vlen);
+  return result;
+}
@@ -0,0 +1,372 @@
+#pragma once
+
+#include "bench.h"
+#include "blocked.h"
+#include "cpu_features.h"
+#include "ime.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Roofline ceilings of the core: how fast it can move data and how fast it
+// can multiply-accumulate, so benchmarks can report how far a kernel is
+// from its limit.
+//
+// measure_roofline() runs the microkernels of src/kernels/rvv_roofline.h
+// and records, for each register group size (LMUL):
+//
+//   load / store  fp32 bandwidth in GB/s of useful data at several working
+//                 set sizes (L1, L2, DRAM): unit stride (vle32), strided
+//                 (vlse32, one element per stride, as a column walk of B)
+//                 and indexed (vluxei32 through a random permutation, as a
+//                 sparse gather; the offsets themselves are not counted)
+//   compute       GFLOP/s (one multiply-accumulate = 2) of independent
+//                 vfmacc (e32), vmacc (e8 / e16 / e32) and vwmacc (e8, e16
+//                 and e32 sources), plus vmadot on cores with IME. The
+//                 integer kernels widen with vwmacc, so the vmacc rates are
+//                 informational and bound no kernel
+//
+// RooflineCeilings keeps the results and saves them to a text file like the
+// tuning cache: $MATMUL_ROOFLINE, default ~/.cache/matmul_roofline.txt.
+// attainable_gflops() is the roofline of one product: the lesser of the
+// compute peak of its element type and its arithmetic intensity times the
+// unit-stride load bandwidth at its working set. matmul_bench --roofline
+// reports each kernel as a percentage of that.
+//
+// Host builds (MATMUL_HOST_BUILD) run the scalar definitions in
+// src/portable, which have no register groups: their ceilings are those of
+// the host's scalar code, at LMUL 1 only, and kernels the compiler
+// vectorized can exceed them.
+
+extern "C" {
+// Read (or write) n fp32 elements passes times: buf[i] (access 0, unit
+// stride), buf[i * stride] (1, strided) or the element at byte offsets[i]
+// of buf (2, indexed), in register groups of lmul. The load returns the sum
+// of what it read.
+float matmul_roofline_load(const float *buf, size_t n, int access,
+                           size_t stride, const uint32_t *offsets, int lmul,
+                           int passes);
+void matmul_roofline_store(float *buf, size_t n, int access, size_t stride,
+                           const uint32_t *offsets, int lmul, int passes);
+
+// iterations rounds of independent multiply-accumulates, op 0 vfmacc, 1
+// vmacc, 2 vwmacc (sew of the sources). Returns how many were performed, or
+// 0 for a combination without a kernel.
+uint64_t matmul_roofline_macs(int op, int sew, int lmul, long iterations);
+
+#ifdef MATMUL_HAVE_IME
+// iterations rounds of 8 independent vmadot
+void matmul_asm_ime_roofline(long iterations);
+#endif
+}
+
+enum class RooflineAccess { Unit, Strided, Indexed };
+enum class RooflineOp { Vfmacc, Vmacc, Vwmacc, Vmadot };
+
+inline const char *roofline_access_name(RooflineAccess access) {
+  switch (access) {
+  case RooflineAccess::Unit:
+    return "unit";
+  case RooflineAccess::Strided:
+    return "strided";
+  default:
+    return "indexed";
+  }
+}
+
+inline const char *roofline_op_name(RooflineOp op) {
+  switch (op) {
+  case RooflineOp::Vfmacc:
+    return "vfmacc";
+  case RooflineOp::Vmacc:
+    return "vmacc";
+  case RooflineOp::Vwmacc:
+    return "vwmacc";
+  default:
+    return "vmadot";
+  }
+}
+
+// Multiply-accumulates of one vmadot: a 4 x 8 by 8 x 4 int8 tile (an NR
+// block of C is four tiles wide)
+constexpr uint64_t kVmadotMacs = uint64_t(ImeInt8Traits::MR) *
+                                 ImeInt8Traits::KT * (ImeInt8Traits::NR / 4);
+
+// Run one compute microkernel; returns the multiply-accumulates performed
+inline uint64_t roofline_macs(RooflineOp op, int sew, int lmul,
+                              long iterations) {
+  if (op != RooflineOp::Vmadot)
+    return matmul_roofline_macs(int(op), sew, lmul, iterations);
+#ifdef MATMUL_HAVE_IME
+  if (sew == 8 && lmul == 1 && ime_available()) {
+    matmul_asm_ime_roofline(iterations);
+    return uint64_t(iterations) * 8 * kVmadotMacs;
+  }
+#endif
+  return 0;
+}
+
+// One measurement: kind is "load", "store" or "compute", name the access
+// pattern or instruction, bytes the working set (0 for compute)
+struct RooflineKey {
+  std::string kind;
+  std::string name;
+  int sew = 32;
+  int lmul = 1;
+  size_t bytes = 0;
+
+  bool operator<(const RooflineKey &other) const {
+    return std::tie(kind, name, sew, lmul, bytes) <
+           std::tie(other.kind, other.name, other.sew, other.lmul,
+                    other.bytes);
+  }
+};
+
+class RooflineCeilings {
+public:
+  static std::string default_path() {
+    if (const char *env = std::getenv("MATMUL_ROOFLINE"))
+      return env;
+    if (const char *home = std::getenv("HOME"))
+      return std::string(home) + "/.cache/matmul_roofline.txt";
+    return "matmul_roofline.txt";
+  }
+
+  // GB/s for load and store, GFLOP/s for compute
+  void set(const RooflineKey &key, double value) { entries_[key] = value; }
+  const std::map<RooflineKey, double> &entries() const { return entries_; }
+  bool empty() const { return entries_.empty(); }
+
+  // Merge the entries of a ceilings file. Returns false if it cannot be
+  // opened; throws std::runtime_error on a malformed line.
+  bool load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in)
+      return false;
+
+    std::map<RooflineKey, double> loaded;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+      ++line_no;
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream fields(line);
+      RooflineKey key;
+      double value;
+      if (!(fields >> key.kind >> key.name >> key.sew >> key.lmul >>
+            key.bytes >> value))
+        throw std::runtime_error("Malformed roofline entry at " + path + ":" +
+                                 std::to_string(line_no));
+      loaded[key] = value;
+    }
+    for (const auto &entry : loaded)
+      entries_[entry.first] = entry.second;
+    return true;
+  }
+
+  // Write every entry to path, creating its directory if needed; throws
+  // std::runtime_error on failure
+  void save(const std::string &path) const {
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    std::error_code ignored;
+    if (!dir.empty())
+      std::filesystem::create_directories(dir, ignored);
+    std::ofstream out(path);
+    if (!out)
+      throw std::runtime_error("Cannot write roofline ceilings " + path);
+    out << "# matmul roofline ceilings\n"
+        << "# kind name sew lmul bytes value (GB/s for load and store, "
+           "GFLOP/s for compute)\n";
+    for (const auto &entry : entries_) {
+      const RooflineKey &k = entry.first;
+      out << k.kind << " " << k.name << " " << k.sew << " " << k.lmul << " "
+          << k.bytes << " " << entry.second << "\n";
+    }
+  }
+
+  // Compute peak in GFLOP/s for matmul on an element type ("int8", "float",
+  // ...): the fastest rate, at any LMUL, of the instruction its kernels
+  // accumulate with. int8 B is sign-extended to int16, so int8 and int16 use
+  // vwmacc of e16 sources and int32 vwmacc of e32; vmadot counts only for
+  // kernels on the matrix unit. 0 if nothing was measured.
+  double peak_gflops(const std::string &type, bool matrix_unit = false) const {
+    double peak = 0.0;
+    for (const auto &entry : entries_) {
+      const RooflineKey &k = entry.first;
+      if (k.kind != "compute")
+        continue;
+      bool used;
+      if (type == "float" || type == "fp16" || type == "bf16")
+        used = k.name == "vfmacc";
+      else if (type == "int8")
+        used = (k.name == "vwmacc" && k.sew == 16) ||
+               (matrix_unit && k.name == "vmadot");
+      else if (type == "int16")
+        used = k.name == "vwmacc" && k.sew == 16;
+      else
+        used = k.name == "vwmacc" && k.sew == 32;
+      if (used)
+        peak = std::max(peak, entry.second);
+    }
+    return peak;
+  }
+
+  // Unit-stride load bandwidth in GB/s for a working set of bytes: the
+  // smallest measured size that holds it, or the largest one. 0 if nothing
+  // was measured.
+  double bandwidth_gbps(double bytes) const {
+    std::map<size_t, double> by_size;
+    for (const auto &entry : entries_) {
+      const RooflineKey &k = entry.first;
+      if (k.kind == "load" && k.name == "unit")
+        by_size[k.bytes] = std::max(by_size[k.bytes], entry.second);
+    }
+    if (by_size.empty())
+      return 0.0;
+    for (const auto &size : by_size)
+      if (double(size.first) >= bytes)
+        return size.second;
+    return by_size.rbegin()->second;
+  }
+
+  // Roofline of one product of flops moving bytes on cores cores: min(cores
+  // x compute peak, flops / bytes * bandwidth). The ceilings are measured on
+  // one core, and the memory bandwidth is taken as shared. 0 if either
+  // ceiling is missing.
+  double attainable_gflops(const std::string &type, double flops,
+                           double bytes, bool matrix_unit = false,
+                           int cores = 1) const {
+    double peak = peak_gflops(type, matrix_unit) * std::max(1, cores);
+    double bandwidth = bandwidth_gbps(bytes);
+    if (peak <= 0.0 || bandwidth <= 0.0 || bytes <= 0.0)
+      return 0.0;
+    return std::min(peak, flops / bytes * bandwidth);
+  }
+
+  // Achieved GFLOP/s as a percentage of attainable_gflops, or -1 without
+  // ceilings
+  double percent_of_peak(const std::string &type, double flops, double bytes,
+                         double achieved_gflops, bool matrix_unit = false,
+                         int cores = 1) const {
+    double attainable =
+        attainable_gflops(type, flops, bytes, matrix_unit, cores);
+    return attainable > 0.0 ? 100.0 * achieved_gflops / attainable : -1.0;
+  }
+
+private:
+  std::map<RooflineKey, double> entries_;
+};
+
+struct RooflineOptions {
+  // Working sets in bytes: within L1, within L2, beyond the caches
+  std::vector<size_t> sizes = {16 << 10, 256 << 10, 4 << 20, 64 << 20};
+  std::vector<int> lmuls = {1, 2, 4, 8};
+  size_t stride = 16;          // strided accesses, elements apart
+  size_t min_bytes = 64 << 20; // data moved per timed memory run
+  long iterations = 1 << 16;   // multiply-accumulate rounds per timed run
+  BenchOptions bench = {1, 5};
+  uint32_t seed = 42;
+};
+
+// Useful GB/s of one access pattern over a working set of bytes
+inline double measure_roofline_memory(size_t bytes, RooflineAccess access,
+                                      bool store, int lmul,
+                                      const RooflineOptions &options) {
+  const size_t total = std::max<size_t>(1, bytes / sizeof(float));
+  const size_t stride =
+      access == RooflineAccess::Strided ? std::max<size_t>(1, options.stride)
+                                        : 1;
+  const size_t n = std::max<size_t>(1, total / stride);
+  auto buf = make_aligned_buffer<float>(total);
+  std::fill(buf.get(), buf.get() + total, 1.0f);
+
+  std::vector<uint32_t> offsets;
+  if (access == RooflineAccess::Indexed) {
+    offsets.resize(n);
+    std::iota(offsets.begin(), offsets.end(), 0u);
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(options.seed));
+    for (uint32_t &offset : offsets)
+      offset *= uint32_t(sizeof(float));
+  }
+
+  const size_t pass_bytes = n * sizeof(float);
+  const int passes =
+      int(std::max<size_t>(1, options.min_bytes / pass_bytes));
+  volatile float sink = 0.0f;
+  double ms =
+      benchmark(
+          [&] {
+            if (store)
+              matmul_roofline_store(buf.get(), n, int(access), stride,
+                                    offsets.data(), lmul, passes);
+            else
+              sink = matmul_roofline_load(buf.get(), n, int(access), stride,
+                                          offsets.data(), lmul, passes);
+          },
+          options.bench)
+          .median_ms;
+  (void)sink;
+  return gbytes_per_second(double(pass_bytes) * passes, ms);
+}
+
+// GFLOP/s of one compute microkernel, 0 if it has no kernel for sew / lmul
+inline double measure_roofline_compute(RooflineOp op, int sew, int lmul,
+                                       const RooflineOptions &options) {
+  const uint64_t macs = roofline_macs(op, sew, lmul, 1);
+  if (macs == 0)
+    return 0.0;
+  double ms = benchmark([&] { roofline_macs(op, sew, lmul, options.iterations); },
+                        options.bench)
+                  .median_ms;
+  return gflops(2.0 * double(macs) * double(options.iterations), ms);
+}
+
+// Measure every ceiling. Throws std::runtime_error on a core without the
+// vector unit, where the microkernels cannot run.
+inline RooflineCeilings measure_roofline(const RooflineOptions &options = {}) {
+  std::vector<int> lmuls = options.lmuls;
+#ifdef MATMUL_HOST_BUILD
+  lmuls = {1};
+#else
+  if (!cpu_features().rvv)
+    throw std::runtime_error("The roofline microkernels need a vector unit");
+#endif
+
+  RooflineCeilings ceilings;
+  for (bool store : {false, true})
+    for (RooflineAccess access : {RooflineAccess::Unit,
+                                  RooflineAccess::Strided,
+                                  RooflineAccess::Indexed})
+      for (size_t bytes : options.sizes)
+        for (int lmul : lmuls)
+          ceilings.set({store ? "store" : "load",
+                        roofline_access_name(access), 32, lmul, bytes},
+                       measure_roofline_memory(bytes, access, store, lmul,
+                                               options));
+
+  const std::pair<RooflineOp, int> ops[] = {
+      {RooflineOp::Vfmacc, 32}, {RooflineOp::Vmacc, 8},
+      {RooflineOp::Vmacc, 16},  {RooflineOp::Vmacc, 32},
+      {RooflineOp::Vwmacc, 8},  {RooflineOp::Vwmacc, 16},
+      {RooflineOp::Vwmacc, 32}, {RooflineOp::Vmadot, 8}};
+  for (const auto &op : ops)
+    for (int lmul : lmuls) {
+      double rate = measure_roofline_compute(op.first, op.second, lmul, options);
+      if (rate > 0.0)
+        ceilings.set({"compute", roofline_op_name(op.first), op.second, lmul, 0},
+                     rate);
+    }
+  return ceilings;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "buffer_pool.h"
+#include "matrix.h"
+#include "perf_counters.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+
+// GEMV and tall-skinny kernels (C has at most SkinnyShape::max_cols columns).
+//
+// The i-j-k kernels vectorize along the columns of C, so with b_cols == 1
+// each vector is a single element and B is walked one row stride at a time.
+// These shapes are bandwidth-bound: the skinny kernels instead vectorize
+// along K, streaming rows of A and columns of B (rows of B transposed) at unit
+// stride, and reduce each dot product once at the end. Each chunk of a row of
+// A is loaded once and multiplied into one accumulator per column of C, so A
+// is read exactly once. For b_cols == 1, B already is its own transpose; wider
+// B is transposed into a small buffer first (at most 8 x K elements).
+//
+// The transposed B is re-read for every row of A and relies on staying in
+// cache. K is not blocked, so for a very deep K (8 x K elements past the L2
+// size) B is streamed from memory once per row as well.
+//
+// A single row of A times a wide B stays on the vector kernel, which already
+// streams rows of B at unit stride and reads each element once.
+//
+// Float results are reduced in a different order from the other kernels, so
+// they match the C++ reference to rounding rather than bit for bit.
+
+extern "C" {
+void matmul_asm_skinny_float(const float *a, const float *bt, float *c,
+                             int a_rows, int a_cols, int b_cols);
+
+void matmul_asm_skinny_int8(const int8_t *a, const int8_t *bt, int8_t *c,
+                            int a_rows, int a_cols, int b_cols, int int_min,
+                            int int_max);
+
+void matmul_asm_skinny_int16(const int16_t *a, const int16_t *bt, int16_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max);
+
+void matmul_asm_skinny_int32(const int32_t *a, const int32_t *bt, int32_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max);
+}
+
+// Shapes routed to the skinny kernels
+struct SkinnyShape {
+  static constexpr int max_cols = 8;   // widest C (B is transposed up to this)
+  static constexpr int min_depth = 16; // shortest dot product worth reducing
+};
+
+inline bool skinny_shape(int a_rows, int a_cols, int b_cols) {
+  return a_rows > 0 && b_cols > 0 && b_cols <= SkinnyShape::max_cols &&
+         a_cols >= SkinnyShape::min_depth;
+}
+
+template <typename T> struct SkinnyTraits;
+
+template <> struct SkinnyTraits<float> {
+  static void kernel(const float *a, const float *bt, float *c, int a_rows,
+                     int a_cols, int b_cols) {
+    matmul_asm_skinny_float(a, bt, c, a_rows, a_cols, b_cols);
+  }
+};
+
+template <> struct SkinnyTraits<int8_t> {
+  static void kernel(const int8_t *a, const int8_t *bt, int8_t *c, int a_rows,
+                     int a_cols, int b_cols) {
+    matmul_asm_skinny_int8(a, bt, c, a_rows, a_cols, b_cols,
+                           std::numeric_limits<int8_t>::min(),
+                           std::numeric_limits<int8_t>::max());
+  }
+};
+
+template <> struct SkinnyTraits<int16_t> {
+  static void kernel(const int16_t *a, const int16_t *bt, int16_t *c,
+                     int a_rows, int a_cols, int b_cols) {
+    matmul_asm_skinny_int16(a, bt, c, a_rows, a_cols, b_cols,
+                            std::numeric_limits<int16_t>::min(),
+                            std::numeric_limits<int16_t>::max());
+  }
+};
+
+template <> struct SkinnyTraits<int32_t> {
+  static void kernel(const int32_t *a, const int32_t *bt, int32_t *c,
+                     int a_rows, int a_cols, int b_cols) {
+    matmul_asm_skinny_int32(a, bt, c, a_rows, a_cols, b_cols,
+                            std::numeric_limits<int32_t>::min(),
+                            std::numeric_limits<int32_t>::max());
+  }
+};
+
+// C (a_rows x b_cols) = A * B on dense row-major operands, for shapes
+// accepted by skinny_shape()
+template <typename T>
+void matmul_skinny(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                   int b_cols) {
+  if (b_cols == 1) {
+    SkinnyTraits<T>::kernel(a, b, c, a_rows, a_cols, 1);
+    return;
+  }
+
+  auto bt = make_aligned_buffer<T>(size_t(a_cols) * b_cols);
+  {
+    MATMUL_PERF_SCOPE(std::string("skinny/") + element_type_name<T>() +
+                      "/transpose");
+    for (int k = 0; k < a_cols; ++k)
+      for (int j = 0; j < b_cols; ++j)
+        bt[size_t(j) * a_cols + k] = b[size_t(k) * b_cols + j];
+  }
+  SkinnyTraits<T>::kernel(a, bt.get(), c, a_rows, a_cols, b_cols);
+}
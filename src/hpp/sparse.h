@@ -0,0 +1,339 @@
+#pragma once
+
+#include "matrix.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Sparse x dense products for pruned weights.
+//
+// A sparse A (a_rows x a_cols) is held in one of two formats:
+//
+//   CsrMatrix<T>      compressed sparse rows: the nonzeros of row i are
+//                     values[row_ptr[i] .. row_ptr[i + 1]), at columns
+//                     col_idx[...]; any sparsity pattern
+//   Sparse24Matrix<T> 2:4 structured: every group of four columns of a row
+//                     keeps (at most) two values plus their 2-bit positions,
+//                     stored one byte each; half the values, no row pointers
+//
+// spmm() multiplies either by a dense Matrix<T> B. Each row of C is built
+// from whole rows of B, C[i][:] += A[i][p] * B[p][:] over the nonzeros of
+// row i, so B is streamed at unit stride and zero entries cost nothing. With
+// a single column of B (y = A * x) the rows are too short to vectorize and
+// the kernels instead gather x[col] for a strip of nonzeros with indexed
+// loads (vluxei32) and reduce the row's dot product once. int8 accumulates
+// in int32 and saturates once, float accumulates in float, so results match
+// matmul_cpp_naive on the dense matrix (float up to summation order).
+//
+// The float and int8 kernels are generated from src/kernels/rvv_spmm.h;
+// other element types and strided B take spmm_cpp_naive.
+
+extern "C" {
+void matmul_asm_spmm_csr_float(const int32_t *row_ptr, const int32_t *col_idx,
+                               const float *values, const float *b, float *c,
+                               int a_rows, int b_cols, int vlen);
+
+void matmul_asm_spmm_csr_int8(const int32_t *row_ptr, const int32_t *col_idx,
+                              const int8_t *values, const int8_t *b, int8_t *c,
+                              int a_rows, int b_cols, int int_min, int int_max,
+                              int vlen);
+
+void matmul_asm_spmm_24_float(const float *values, const uint8_t *pos,
+                              const float *b, float *c, int a_rows,
+                              int a_cols, int b_cols, int vlen);
+
+void matmul_asm_spmm_24_int8(const int8_t *values, const uint8_t *pos,
+                             const int8_t *b, int8_t *c, int a_rows,
+                             int a_cols, int b_cols, int int_min, int int_max,
+                             int vlen);
+
+// y = A * x, gathering x through the column indices
+void matmul_asm_spmv_csr_float(const int32_t *row_ptr, const int32_t *col_idx,
+                               const float *values, const float *x, float *y,
+                               int a_rows);
+
+void matmul_asm_spmv_csr_int8(const int32_t *row_ptr, const int32_t *col_idx,
+                              const int8_t *values, const int8_t *x, int8_t *y,
+                              int a_rows, int int_min, int int_max);
+
+void matmul_asm_spmv_24_float(const float *values, const uint8_t *pos,
+                              const float *x, float *y, int a_rows,
+                              int a_cols);
+
+void matmul_asm_spmv_24_int8(const int8_t *values, const uint8_t *pos,
+                             const int8_t *x, int8_t *y, int a_rows,
+                             int a_cols, int int_min, int int_max);
+}
+
+template <typename T> class CsrMatrix {
+public:
+  CsrMatrix() = default;
+
+  // Nonzeros of dense, row by row
+  static CsrMatrix from_dense(const Matrix<T> &dense) {
+    if (dense.rows() * dense.cols() >
+        size_t(std::numeric_limits<int32_t>::max()))
+      throw std::invalid_argument("Matrix too large for 32-bit CSR indices");
+    CsrMatrix csr;
+    csr.rows_ = dense.rows();
+    csr.cols_ = dense.cols();
+    csr.row_ptr_.reserve(dense.rows() + 1);
+    for (size_t i = 0; i < dense.rows(); ++i) {
+      for (size_t j = 0; j < dense.cols(); ++j) {
+        if (dense.at(i, j) != T(0)) {
+          csr.col_idx_.push_back(int32_t(j));
+          csr.values_.push_back(dense.at(i, j));
+        }
+      }
+      csr.row_ptr_.push_back(int32_t(csr.values_.size()));
+    }
+    return csr;
+  }
+
+  Matrix<T> to_dense() const {
+    Matrix<T> dense(rows_, cols_);
+    for (size_t i = 0; i < rows_; ++i)
+      for_each_in_row(i, [&](size_t j, T v) { dense.at(i, j) = v; });
+    return dense;
+  }
+
+  // f(column, value) for every stored entry of row i, in column order
+  template <typename F> void for_each_in_row(size_t i, F &&f) const {
+    for (int32_t p = row_ptr_[i]; p < row_ptr_[i + 1]; ++p)
+      f(size_t(col_idx_[p]), values_[p]);
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  size_t nnz() const { return values_.size(); }
+  double density() const {
+    return rows_ * cols_ ? double(nnz()) / double(rows_ * cols_) : 0.0;
+  }
+
+  const int32_t *row_ptr() const { return row_ptr_.data(); }
+  const int32_t *col_idx() const { return col_idx_.data(); }
+  const T *values() const { return values_.data(); }
+
+private:
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  std::vector<int32_t> row_ptr_{0};
+  std::vector<int32_t> col_idx_;
+  std::vector<T> values_;
+};
+
+template <typename T> class Sparse24Matrix {
+public:
+  Sparse24Matrix() = default;
+
+  // Values kept per row: two per group of four columns (the last group may
+  // be partial)
+  static size_t row_length(size_t cols) { return (cols + 3) / 4 * 2; }
+
+  // Exact conversion; throws std::invalid_argument if a group of four
+  // columns holds more than two nonzeros
+  static Sparse24Matrix from_dense(const Matrix<T> &dense) {
+    return convert(dense, false);
+  }
+
+  // Magnitude pruning: keeps the two largest |values| of every group (ties
+  // to the lower column) and drops the rest
+  static Sparse24Matrix prune(const Matrix<T> &dense) {
+    return convert(dense, true);
+  }
+
+  Matrix<T> to_dense() const {
+    Matrix<T> dense(rows_, cols_);
+    for (size_t i = 0; i < rows_; ++i)
+      for_each_in_row(i, [&](size_t j, T v) {
+        if (v != T(0))
+          dense.at(i, j) = v;
+      });
+    return dense;
+  }
+
+  // f(column, value) for both slots of every group of row i; unused slots
+  // carry a zero value
+  template <typename F> void for_each_in_row(size_t i, F &&f) const {
+    const size_t len = row_length(cols_);
+    const T *v = values_.data() + i * len;
+    const uint8_t *pos = pos_.data() + i * len;
+    for (size_t p = 0; p < len; ++p)
+      f(p / 2 * 4 + pos[p], v[p]);
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  size_t nnz() const {
+    size_t count = 0;
+    for (const T &v : values_)
+      count += v != T(0);
+    return count;
+  }
+
+  const T *values() const { return values_.data(); }
+  const uint8_t *positions() const { return pos_.data(); }
+
+private:
+  static Sparse24Matrix convert(const Matrix<T> &dense, bool prune) {
+    Sparse24Matrix s;
+    s.rows_ = dense.rows();
+    s.cols_ = dense.cols();
+    const size_t len = row_length(s.cols_);
+    s.values_.assign(s.rows_ * len, T(0));
+    s.pos_.assign(s.rows_ * len, 0);
+
+    for (size_t i = 0; i < s.rows_; ++i) {
+      for (size_t g = 0; g * 4 < s.cols_; ++g) {
+        const size_t width = std::min<size_t>(4, s.cols_ - g * 4);
+        // Columns of the group with the two largest magnitudes, or all
+        // nonzeros when not pruning
+        size_t keep[4];
+        size_t kept = 0;
+        for (size_t c = 0; c < width; ++c) {
+          T v = dense.at(i, g * 4 + c);
+          if (v == T(0))
+            continue;
+          if (!prune && kept == 2)
+            throw std::invalid_argument(
+                "Matrix is not 2:4 sparse: more than two nonzeros in a "
+                "group of four columns");
+          keep[kept++] = c;
+        }
+        if (prune && kept > 2) {
+          auto magnitude = [&](size_t c) {
+            return std::fabs(double(dense.at(i, g * 4 + c)));
+          };
+          std::stable_sort(keep, keep + kept, [&](size_t x, size_t y) {
+            return magnitude(x) > magnitude(y);
+          });
+          kept = 2;
+          std::sort(keep, keep + 2);
+        }
+        // Unused slots keep value 0 at position 0
+        for (size_t slot = 0; slot < kept; ++slot) {
+          s.values_[i * len + g * 2 + slot] = dense.at(i, g * 4 + keep[slot]);
+          s.pos_[i * len + g * 2 + slot] = uint8_t(keep[slot]);
+        }
+      }
+    }
+    return s;
+  }
+
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  std::vector<T> values_; // rows x row_length(cols)
+  std::vector<uint8_t> pos_; // column within the group, 0..3
+};
+
+// C++ reference: C = A * B over the stored entries of A, accumulated and
+// saturated like matmul_cpp_naive
+template <typename T, typename SparseT>
+void spmm_cpp_naive(const SparseT &a, const Matrix<T> &b, Matrix<T> &c) {
+  using AccumulatorType = accumulator_t<T>;
+  std::vector<AccumulatorType> row(b.cols());
+  for (size_t i = 0; i < a.rows(); ++i) {
+    std::fill(row.begin(), row.end(), AccumulatorType(0));
+    a.for_each_in_row(i, [&](size_t p, T v) {
+      for (size_t j = 0; j < b.cols(); ++j)
+        row[j] += AccumulatorType(v) * AccumulatorType(b.at(p, j));
+    });
+    for (size_t j = 0; j < b.cols(); ++j)
+      c.at(i, j) = clamp_int<T, AccumulatorType>(row[j]);
+  }
+}
+
+template <typename T, typename SparseT>
+void check_spmm_shapes(const SparseT &a, const Matrix<T> &b,
+                       const Matrix<T> &c) {
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "Matrix dimensions mismatch for multiplication");
+  if (c.rows() != a.rows() || c.cols() != b.cols())
+    throw std::invalid_argument("Result matrix has the wrong dimensions");
+}
+
+// C = A * B into a preallocated c (a.rows() x b.cols())
+template <typename T>
+void spmm(const CsrMatrix<T> &a, const Matrix<T> &b, Matrix<T> &c,
+          int vlen = 0) {
+  check_spmm_shapes(a, b, c);
+  constexpr bool has_kernel =
+      std::is_same_v<T, float> || std::is_same_v<T, int8_t>;
+  if (!has_kernel || !b.is_contiguous() || !c.is_contiguous()) {
+    spmm_cpp_naive(a, b, c);
+    return;
+  }
+
+  const int m = int(a.rows()), n = int(b.cols());
+  MATMUL_PERF_SCOPE("spmm/csr", 2.0 * double(a.nnz()) * n,
+                    double(a.nnz()) * (sizeof(T) + 4) +
+                        double(b.rows()) * n * sizeof(T) +
+                        double(m) * n * sizeof(T));
+  if constexpr (std::is_same_v<T, float>) {
+    if (n == 1)
+      matmul_asm_spmv_csr_float(a.row_ptr(), a.col_idx(), a.values(),
+                                b.data(), c.data(), m);
+    else
+      matmul_asm_spmm_csr_float(a.row_ptr(), a.col_idx(), a.values(),
+                                b.data(), c.data(), m, n, vlen);
+  } else if constexpr (std::is_same_v<T, int8_t>) {
+    constexpr int lo = std::numeric_limits<int8_t>::min();
+    constexpr int hi = std::numeric_limits<int8_t>::max();
+    if (n == 1)
+      matmul_asm_spmv_csr_int8(a.row_ptr(), a.col_idx(), a.values(), b.data(),
+                               c.data(), m, lo, hi);
+    else
+      matmul_asm_spmm_csr_int8(a.row_ptr(), a.col_idx(), a.values(), b.data(),
+                               c.data(), m, n, lo, hi, vlen);
+  }
+}
+
+template <typename T>
+void spmm(const Sparse24Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c,
+          int vlen = 0) {
+  check_spmm_shapes(a, b, c);
+  constexpr bool has_kernel =
+      std::is_same_v<T, float> || std::is_same_v<T, int8_t>;
+  if (!has_kernel || !b.is_contiguous() || !c.is_contiguous()) {
+    spmm_cpp_naive(a, b, c);
+    return;
+  }
+
+  const int m = int(a.rows()), k = int(a.cols()), n = int(b.cols());
+  [[maybe_unused]] const double stored = double(m) * double(a.row_length(k));
+  MATMUL_PERF_SCOPE("spmm/2:4", 2.0 * stored * n,
+                    stored * (sizeof(T) + 1) + double(k) * n * sizeof(T) +
+                        double(m) * n * sizeof(T));
+  if constexpr (std::is_same_v<T, float>) {
+    if (n == 1)
+      matmul_asm_spmv_24_float(a.values(), a.positions(), b.data(), c.data(),
+                               m, k);
+    else
+      matmul_asm_spmm_24_float(a.values(), a.positions(), b.data(), c.data(),
+                               m, k, n, vlen);
+  } else if constexpr (std::is_same_v<T, int8_t>) {
+    constexpr int lo = std::numeric_limits<int8_t>::min();
+    constexpr int hi = std::numeric_limits<int8_t>::max();
+    if (n == 1)
+      matmul_asm_spmv_24_int8(a.values(), a.positions(), b.data(), c.data(), m,
+                              k, lo, hi);
+    else
+      matmul_asm_spmm_24_int8(a.values(), a.positions(), b.data(), c.data(), m,
+                              k, n, lo, hi, vlen);
+  }
+}
+
+// C = A * B (a.rows() x b.cols())
+template <typename T, typename SparseT>
+Matrix<T> spmm(const SparseT &a, const Matrix<T> &b, int vlen = 0) {
+  Matrix<T> c(a.rows(), b.cols(), typename Matrix<T>::Uninitialized{});
+  spmm(a, b, c, vlen);
+  return c;
+}
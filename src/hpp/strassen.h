@@ -0,0 +1,279 @@
+#pragma once
+
+#include "blocked.h"
+#include "buffer_pool.h"
+#include "matrix.h"
+#include "tuning.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+// Strassen-Winograd recursion for large products.
+//
+// Each level splits A, B and C into 2 x 2 blocks and forms C from seven
+// half-size products and fifteen block additions (Winograd's variant of
+// Strassen), recursing while every dimension is above the cutoff. The leaves
+// run the blocked driver, which reads the quadrants through their leading
+// dimensions, so no block is copied. Odd dimensions are peeled: the even
+// part recurses, and the last row, last column and last rank-1 term of K are
+// added by the blocked driver. The temporaries of every level (one sum of A
+// blocks, one sum of B blocks and the product A11 * B11) come from a single
+// workspace allocated up front.
+//
+// Error bounds. Integer products stay exact: int8 and int16 recurse in int32,
+// int32 in itself, and the depth is limited (from the largest magnitudes in
+// A and B) so that no intermediate can overflow; the result is then clamped
+// exactly like matmul_cpp_naive. When no recursion is safe the plain blocked
+// driver runs. Float results differ from matmul_cpp_naive by rounding only,
+// but the bound is weaker than for the O(n^3) kernels. With unit roundoff u
+// (2^-24 for fp32), n x n operands, leaves of size n0 and max-norms
+// |A| = max |a_ij|, |B| = max |b_ij| (Higham, Accuracy and Stability of
+// Numerical Algorithms, 2nd ed., Theorem 23.3):
+//
+//   conventional  max |C - C'| <= n u |A| |B|
+//   Winograd      max |C - C'| <= ((n / n0)^log2(18) (n0^2 + 6 n0) - 6n) u
+//                                  |A| |B|
+//
+// to first order in u. One level (n = 2 n0) thus raises the worst case from
+// 2 n0 u to about 18 n0^2 u. Observed errors grow far more slowly: with
+// random [-1, 1] operands the largest error roughly doubles per level, which
+// is the tolerance verify_epsilon() allows. fp16 / bf16 inputs recurse in
+// fp32 and round once at the end.
+
+// Element type of the recursion: the block sums and the seven products are
+// formed in WorkType, and the leaves run the blocked driver on it
+template <typename T> struct StrassenTraits {
+  using WorkType = T;
+};
+
+template <> struct StrassenTraits<int8_t> {
+  using WorkType = int32_t;
+};
+
+template <> struct StrassenTraits<int16_t> {
+  using WorkType = int32_t;
+};
+
+template <> struct StrassenTraits<float16> {
+  using WorkType = float;
+};
+
+template <> struct StrassenTraits<bfloat16> {
+  using WorkType = float;
+};
+
+struct StrassenShape {
+  static constexpr int default_cutoff = 256; // recurse while min(M, N, K) > this
+};
+
+inline int strassen_cutoff(const TuneParams &params) {
+  return params.cutoff > 0 ? params.cutoff : StrassenShape::default_cutoff;
+}
+
+// Recursion levels for an m x k by k x n product with the given cutoff
+inline int strassen_depth(int m, int k, int n, int cutoff) {
+  cutoff = std::max(1, cutoff);
+  int depth = 0;
+  while (std::min({m, k, n}) > cutoff) {
+    m /= 2;
+    k /= 2;
+    n /= 2;
+    ++depth;
+  }
+  return depth;
+}
+
+// True if the shape recurses at least once (otherwise Strassen is just the
+// best plain kernel)
+inline bool strassen_shape(int m, int k, int n, int cutoff) {
+  return strassen_depth(m, k, n, cutoff) > 0;
+}
+
+// Elements of workspace for depth levels: per level an (m/2 x k/2) sum of A
+// blocks, a (k/2 x n/2) sum of B blocks and an (m/2 x n/2) product
+inline size_t strassen_workspace(int m, int k, int n, int depth) {
+  size_t total = 0;
+  for (; depth > 0; --depth) {
+    m /= 2;
+    k /= 2;
+    n /= 2;
+    total += size_t(m) * k + size_t(k) * n + size_t(m) * n;
+  }
+  return total;
+}
+
+// Deepest recursion, at most depth, that keeps an int32 work type exact.
+// At level l the operand blocks are sums of up to 4^l elements and the dot
+// products k / 2^l long, so a product is at most k |A| |B| 8^l and a block
+// sum of products at most four times that; the leaves at level d bound the
+// rest. Requiring 4 k |A| |B| 8^d <= INT32_MAX covers every intermediate.
+inline int strassen_exact_depth(int k, int64_t max_a, int64_t max_b,
+                                int depth) {
+  const double limit = double(std::numeric_limits<int32_t>::max());
+  double bound = 4.0 * double(k) * double(max_a) * double(max_b);
+  int exact = 0;
+  while (exact < depth && bound * 8.0 <= limit) {
+    bound *= 8.0;
+    ++exact;
+  }
+  return exact;
+}
+
+template <typename T> int64_t strassen_max_abs(const T *x, size_t count) {
+  int64_t max_abs = 0;
+  for (size_t i = 0; i < count; ++i)
+    max_abs = std::max(max_abs, int64_t(std::llabs(int64_t(x[i]))));
+  return max_abs;
+}
+
+// Z = X + Y, or X - Y when subtract is set, on m x n blocks
+template <typename W>
+void strassen_add(int m, int n, const W *x, int ldx, const W *y, int ldy, W *z,
+                  int ldz, bool subtract = false) {
+  for (int i = 0; i < m; ++i) {
+    const W *xr = x + size_t(i) * ldx;
+    const W *yr = y + size_t(i) * ldy;
+    W *zr = z + size_t(i) * ldz;
+    if (subtract)
+      for (int j = 0; j < n; ++j)
+        zr[j] = xr[j] - yr[j];
+    else
+      for (int j = 0; j < n; ++j)
+        zr[j] = xr[j] + yr[j];
+  }
+}
+
+// C = A * B (or C += A * B) on one leaf, through the blocked driver
+template <typename W>
+void strassen_leaf(int m, int k, int n, const W *a, int lda, const W *b,
+                   int ldb, W *c, int ldc, bool accumulate,
+                   const BlockSizes &bs) {
+  gemm_blocked<W>(false, false, m, n, k, W(1), a, std::max(1, lda), b,
+                  std::max(1, ldb), accumulate ? W(1) : W(0), c,
+                  std::max(1, ldc), bs);
+}
+
+// C (m x n) = A (m x k) * B (k x n) with depth levels of recursion. work
+// holds strassen_workspace(m, k, n, depth) elements.
+template <typename W>
+void strassen_recurse(int m, int k, int n, const W *a, int lda, const W *b,
+                      int ldb, W *c, int ldc, int depth, W *work,
+                      const BlockSizes &bs) {
+  if (depth == 0) {
+    strassen_leaf(m, k, n, a, lda, b, ldb, c, ldc, false, bs);
+    return;
+  }
+
+  const int m2 = m / 2, k2 = k / 2, n2 = n / 2;
+  W *x = work;                    // m2 x k2 sum of A blocks
+  W *y = x + size_t(m2) * k2;     // k2 x n2 sum of B blocks
+  W *z = y + size_t(k2) * n2;     // m2 x n2, holds M1 = A11 * B11
+  W *next = z + size_t(m2) * n2;  // workspace of the next level
+
+  const W *a11 = a, *a12 = a + k2;
+  const W *a21 = a + size_t(m2) * lda, *a22 = a21 + k2;
+  const W *b11 = b, *b12 = b + n2;
+  const W *b21 = b + size_t(k2) * ldb, *b22 = b21 + n2;
+  W *c11 = c, *c12 = c + n2;
+  W *c21 = c + size_t(m2) * ldc, *c22 = c21 + n2;
+
+  auto mul = [&](const W *p, int ldp, const W *q, int ldq, W *r, int ldr) {
+    strassen_recurse(m2, k2, n2, p, ldp, q, ldq, r, ldr, depth - 1, next, bs);
+  };
+
+  // Winograd's seven products, scheduled (after Douglas et al., GEMMW) so
+  // that the C quadrants hold the partial sums and only x, y, z are extra
+  strassen_add(m2, k2, a11, lda, a21, lda, x, k2, true); // S3 = A11 - A21
+  strassen_add(k2, n2, b22, ldb, b12, ldb, y, n2, true); // T3 = B22 - B12
+  mul(x, k2, y, n2, c21, ldc);                           // C21 = M7 = S3 T3
+  strassen_add(m2, k2, a21, lda, a22, lda, x, k2);       // S1 = A21 + A22
+  strassen_add(k2, n2, b12, ldb, b11, ldb, y, n2, true); // T1 = B12 - B11
+  mul(x, k2, y, n2, c22, ldc);                           // C22 = M5 = S1 T1
+  strassen_add(m2, k2, x, k2, a11, lda, x, k2, true);    // S2 = S1 - A11
+  strassen_add(k2, n2, b22, ldb, y, n2, y, n2, true);    // T2 = B22 - T1
+  mul(x, k2, y, n2, c12, ldc);                           // C12 = M6 = S2 T2
+  strassen_add(m2, k2, a12, lda, x, k2, x, k2, true);    // S4 = A12 - S2
+  mul(x, k2, b22, ldb, c11, ldc);                        // C11 = M3 = S4 B22
+  mul(a11, lda, b11, ldb, z, n2);                        // z = M1 = A11 B11
+
+  strassen_add(m2, n2, c12, ldc, z, n2, c12, ldc);       // C12 = U2 = M1 + M6
+  strassen_add(m2, n2, c21, ldc, c12, ldc, c21, ldc);    // C21 = U3 = U2 + M7
+  strassen_add(m2, n2, c12, ldc, c22, ldc, c12, ldc);    // C12 = U4 = U2 + M5
+  strassen_add(m2, n2, c22, ldc, c21, ldc, c22, ldc);    // C22 = U3 + M5 (done)
+  strassen_add(m2, n2, c12, ldc, c11, ldc, c12, ldc);    // C12 = U4 + M3 (done)
+  strassen_add(k2, n2, y, n2, b21, ldb, y, n2, true);    // T4 = T2 - B21
+  mul(a22, lda, y, n2, c11, ldc);                        // C11 = M4 = A22 T4
+  strassen_add(m2, n2, c21, ldc, c11, ldc, c21, ldc, true); // C21 = U3 - M4 (done)
+  mul(a12, lda, b21, ldb, c11, ldc);                     // C11 = M2 = A12 B21
+  strassen_add(m2, n2, c11, ldc, z, n2, c11, ldc);       // C11 = M1 + M2 (done)
+
+  // Peel odd dimensions: the last term of K over the even block of C, then
+  // the last column and the last row of C in full
+  const int me = 2 * m2, ke = 2 * k2, ne = 2 * n2;
+  if (k > ke)
+    strassen_leaf(me, 1, ne, a + ke, lda, b + size_t(ke) * ldb, ldb, c, ldc,
+                  true, bs);
+  if (n > ne)
+    strassen_leaf(m, k, 1, a, lda, b + ne, ldb, c + ne, ldc, false, bs);
+  if (m > me)
+    strassen_leaf(1, k, ne, a + size_t(me) * lda, lda, b, ldb,
+                  c + size_t(me) * ldc, ldc, false, bs);
+}
+
+// C (a_rows x b_cols) = A * B on dense row-major operands by Strassen-
+// Winograd recursion down to the cutoff of params. C is stored as TC (the
+// input type, or float for 16-bit float inputs).
+template <typename T, typename TC = T>
+void matmul_strassen(const T *a, const T *b, TC *c, int a_rows, int a_cols,
+                     int b_cols, const TuneParams &params = TuneParams()) {
+  using W = typename StrassenTraits<T>::WorkType;
+  const int m = a_rows, k = a_cols, n = b_cols;
+  int depth = strassen_depth(m, k, n, strassen_cutoff(params));
+  if constexpr (std::is_integral_v<T>)
+    if (depth > 0)
+      depth = strassen_exact_depth(
+          k, strassen_max_abs(a, size_t(m) * k),
+          strassen_max_abs(b, size_t(k) * n), depth);
+
+  if (depth == 0) {
+    gemm_blocked<T, TC>(false, false, m, n, k, T(1), a, std::max(1, k), b,
+                        std::max(1, n), T(0), c, std::max(1, n),
+                        tuned_blocks<T>(params));
+    return;
+  }
+
+  // Widen the operands (and stage C) when the recursion runs in a wider type
+  const W *a_work = nullptr, *b_work = nullptr;
+  W *c_work = nullptr;
+  std::unique_ptr<W[], AlignedFree> a_wide, b_wide, c_wide;
+  if constexpr (std::is_same_v<T, W>) {
+    a_work = a;
+    b_work = b;
+  } else {
+    a_wide = make_aligned_buffer<W>(size_t(m) * k);
+    b_wide = make_aligned_buffer<W>(size_t(k) * n);
+    std::transform(a, a + size_t(m) * k, a_wide.get(),
+                   [](T value) { return W(value); });
+    std::transform(b, b + size_t(k) * n, b_wide.get(),
+                   [](T value) { return W(value); });
+    a_work = a_wide.get();
+    b_work = b_wide.get();
+  }
+  if constexpr (std::is_same_v<TC, W>) {
+    c_work = c;
+  } else {
+    c_wide = make_aligned_buffer<W>(size_t(m) * n);
+    c_work = c_wide.get();
+  }
+
+  auto work = make_aligned_buffer<W>(strassen_workspace(m, k, n, depth));
+  strassen_recurse(m, k, n, a_work, k, b_work, n, c_work, n, depth,
+                   work.get(), tuned_blocks<W>(params));
+
+  if constexpr (!std::is_same_v<TC, W>)
+    std::transform(c_work, c_work + size_t(m) * n, c,
+                   [](W value) { return clamp_int<TC, W>(value); });
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "blocked.h"
+#include "matmul.h"
+#include "matrix.h"
+#include "packed.h"
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+// Streaming C = A * B for tall A that does not fit in memory (activations
+// from files and pipes, millions of rows by a few hundred columns).
+//
+// B stays resident (a Matrix, or a PackedMatrix to skip repacking it per
+// chunk). A arrives in row chunks from a reader, and each chunk of C rows is
+// handed to a sink as soon as it is computed. The next chunk is read on a
+// helper thread while the current one is multiplied, so I/O overlaps compute:
+//
+//   reader -> A buffer 0 | A buffer 1 -> matmul -> C buffer -> sink
+//
+// Peak memory is two A chunks and one C chunk on top of B, whatever the
+// length of the input. Rows are dense in every buffer (A rows k = b.rows()
+// apart, C rows n = b.cols() apart), and A rows are independent, so the
+// result matches one matmul() over the whole input with the same
+// implementation. The sink runs on the calling thread; an exception from the
+// reader or the sink stops the stream and is rethrown to the caller.
+
+// Readers and sinks are any callables of these shapes.
+//
+// Fill up to max_rows dense rows at rows; return how many were written.
+// Fewer is fine (the stream calls again to fill the chunk), 0 means the end.
+template <typename T>
+using StreamReader = std::function<size_t(T *rows, size_t max_rows)>;
+
+// Consume num_rows dense rows of C, starting at row first_row of the result
+template <typename T>
+using StreamSink =
+    std::function<void(const T *rows, size_t first_row, size_t num_rows)>;
+
+struct StreamOptions {
+  size_t chunk_rows = 1024; // rows of A per chunk, rounded up to MR
+  MatMulImpl impl = MatMulImpl::AUTO; // for a Matrix B
+  int vlen = 0;
+};
+
+struct StreamStats {
+  size_t rows = 0;
+  size_t chunks = 0;
+  double read_wait_ms = 0.0; // time compute sat waiting for the reader
+};
+
+// Reader of rows of cols elements from a file descriptor (file, pipe or
+// socket), raw in host byte order. Short reads are retried; a partial row at
+// the end of the input throws std::runtime_error.
+template <typename T> StreamReader<T> fd_reader(int fd, size_t cols) {
+  if (cols == 0)
+    throw std::invalid_argument("Stream rows need at least one column");
+  return [fd, row_bytes = cols * sizeof(T)](T *rows,
+                                            size_t max_rows) -> size_t {
+    char *out = reinterpret_cast<char *>(rows);
+    size_t want = max_rows * row_bytes, got = 0;
+    while (got < want) {
+      ssize_t n = ::read(fd, out + got, want - got);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        throw std::runtime_error(std::string("Stream read failed: ") +
+                                 std::strerror(errno));
+      if (n == 0)
+        break;
+      got += size_t(n);
+      // Hand back whole rows as soon as a pipe runs dry mid-chunk
+      if (got % row_bytes == 0)
+        break;
+    }
+    if (got % row_bytes != 0)
+      throw std::runtime_error("Stream ended inside a row");
+    return got / row_bytes;
+  };
+}
+
+// Sink writing rows of cols elements to a file descriptor, raw in host byte
+// order; throws std::runtime_error if a write fails
+template <typename T> StreamSink<T> fd_writer(int fd, size_t cols) {
+  return [fd, cols](const T *rows, size_t, size_t num_rows) {
+    const char *in = reinterpret_cast<const char *>(rows);
+    size_t left = num_rows * cols * sizeof(T);
+    while (left > 0) {
+      ssize_t n = ::write(fd, in, left);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        throw std::runtime_error(std::string("Stream write failed: ") +
+                                 std::strerror(errno));
+      in += n;
+      left -= size_t(n);
+    }
+  };
+}
+
+// The double-buffered loop; multiply(a, rows, c) computes one chunk
+template <typename T, typename Reader, typename Sink, typename Multiply>
+StreamStats stream_chunks(size_t k, size_t n, Reader &read, Sink &sink,
+                          StreamOptions options, Multiply &&multiply) {
+  constexpr size_t MR = BlockedTraits<T>::MR;
+  const size_t chunk = std::max<size_t>(MR, (options.chunk_rows + MR - 1) /
+                                                MR * MR);
+  // Zero-width rows carry no data, so a reader could never signal the end
+  if (k == 0)
+    throw std::invalid_argument("Streaming needs B with at least one row");
+
+  std::unique_ptr<T[], AlignedFree> a_chunks[2] = {
+      make_aligned_buffer<T>(chunk * k), make_aligned_buffer<T>(chunk * k)};
+  auto c_chunk = make_aligned_buffer<T>(chunk * std::max<size_t>(n, 1));
+
+  // Read until the chunk is full or the input ends
+  auto fill = [&read, chunk, k](T *a) {
+    size_t rows = 0;
+    while (rows < chunk) {
+      size_t got = read(a + rows * k, chunk - rows);
+      if (got == 0)
+        break;
+      if (got > chunk - rows)
+        throw std::runtime_error("Stream reader returned too many rows");
+      rows += got;
+    }
+    return rows;
+  };
+
+  StreamStats stats;
+  int current = 0;
+  std::future<size_t> pending =
+      std::async(std::launch::async, fill, a_chunks[current].get());
+  for (;;) {
+    auto wait_start = std::chrono::steady_clock::now();
+    size_t rows = pending.get();
+    stats.read_wait_ms += std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - wait_start)
+                              .count();
+    if (rows == 0)
+      break;
+
+    // Read ahead into the other buffer while this chunk is multiplied. A
+    // short chunk means the input ended, so there is nothing to read.
+    const bool last = rows < chunk;
+    if (!last)
+      pending =
+          std::async(std::launch::async, fill, a_chunks[1 - current].get());
+
+    multiply(a_chunks[current].get(), rows, c_chunk.get());
+    sink(c_chunk.get(), stats.rows, rows);
+    stats.rows += rows;
+    ++stats.chunks;
+    if (last)
+      break;
+    current = 1 - current;
+  }
+  return stats;
+}
+
+// Stream A (rows of b.rows() elements) through C = A * B, chunk by chunk
+template <typename T, typename Reader, typename Sink>
+StreamStats matmul_stream(const Matrix<T> &b, Reader &&read, Sink &&sink,
+                          StreamOptions options = {}) {
+  const int k = int(b.rows()), n = int(b.cols());
+  return stream_chunks<T>(
+      b.rows(), b.cols(), read, sink, options,
+      [&](const T *a, size_t rows, T *c) {
+        matmul_strided(a, k, b.data(), int(b.stride()), c, std::max(1, n),
+                       int(rows), k, n, options.impl, options.vlen);
+      });
+}
+
+// Same with B prepacked once (packed.h); options.impl and vlen are unused
+template <typename T, typename Reader, typename Sink>
+StreamStats matmul_stream(const PackedMatrix<T> &b, Reader &&read,
+                          Sink &&sink, StreamOptions options = {}) {
+  const int k = int(b.rows()), n = int(b.cols());
+  return stream_chunks<T>(
+      b.rows(), b.cols(), read, sink, options,
+      [&](const T *a, size_t rows, T *c) {
+        matmul_packed(a, k, b, c, n, int(rows));
+      });
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for parallel matmul.
+//
+// parallel_for(count, task) runs task(i) for every i in [0, count). The index
+// space is split into one contiguous range per participant (the caller takes
+// part as participant 0). Each participant pops indices from the front of its
+// own range; once it runs dry it steals the back half of the largest range
+// left, so uneven tiles still load-balance. A range is packed into a single
+// 64-bit atomic (begin << 32 | end), which makes pop and steal one CAS each.
+//
+// Calls made from inside a task run serially on the calling thread.
+class ThreadPool {
+public:
+  explicit ThreadPool(int num_threads = default_threads()) {
+    set_num_threads(num_threads);
+  }
+
+  ~ThreadPool() { stop_workers(); }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Process-wide pool shared by matmul_parallel and friends
+  static ThreadPool &instance() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  // MATMUL_NUM_THREADS if set, otherwise one thread per hardware core
+  static int default_threads() {
+    if (const char *env = std::getenv("MATMUL_NUM_THREADS")) {
+      int n = std::atoi(env);
+      if (n > 0)
+        return n;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Total participants, including the calling thread
+  int num_threads() const { return static_cast<int>(workers_.size()) + 1; }
+
+  void set_num_threads(int num_threads) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    num_threads = std::max(1, num_threads);
+    if (slots_ && num_threads == this->num_threads())
+      return;
+    stop_workers();
+    stop_ = false;
+    slots_.reset(new Slot[num_threads]);
+    for (int id = 1; id < num_threads; ++id)
+      workers_.emplace_back([this, id, seen = generation_] {
+        worker_loop(id, seen);
+      });
+  }
+
+  // Run task(i) for i in [0, count) on up to max_threads participants
+  // (0 = all) and return when every index has been processed.
+  void parallel_for(int count, const std::function<void(int)> &task,
+                    int max_threads = 0) {
+    if (count <= 0)
+      return;
+    if (in_task() || count == 1 || num_threads() == 1 || max_threads == 1) {
+      for (int i = 0; i < count; ++i)
+        task(i);
+      return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    int participants = std::min(num_threads(), count);
+    if (max_threads > 0)
+      participants = std::min(participants, max_threads);
+
+    for (int p = 0; p < participants; ++p) {
+      uint64_t begin = uint64_t(count) * p / participants;
+      uint64_t end = uint64_t(count) * (p + 1) / participants;
+      slots_[p].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      participants_ = participants;
+      pending_ = participants - 1;
+      ++generation_;
+    }
+    wake_.notify_all();
+
+    run_participant(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+  }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> range{0};
+  };
+
+  static uint64_t pack(uint64_t begin, uint64_t end) {
+    return (begin << 32) | end;
+  }
+  static uint32_t range_begin(uint64_t r) { return uint32_t(r >> 32); }
+  static uint32_t range_end(uint64_t r) { return uint32_t(r); }
+
+  static bool &in_task() {
+    thread_local bool flag = false;
+    return flag;
+  }
+
+  // Take the next index from the front of our own range
+  bool pop(int self, int &index) {
+    std::atomic<uint64_t> &range = slots_[self].range;
+    uint64_t r = range.load(std::memory_order_acquire);
+    while (range_begin(r) < range_end(r)) {
+      if (range.compare_exchange_weak(r, pack(range_begin(r) + 1, range_end(r)),
+                                      std::memory_order_acq_rel)) {
+        index = range_begin(r);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Move the back half of the largest remaining range into our own slot
+  bool steal(int self) {
+    for (;;) {
+      int victim = -1;
+      uint32_t best = 0;
+      for (int p = 0; p < participants_; ++p) {
+        uint64_t r = slots_[p].range.load(std::memory_order_acquire);
+        uint32_t left = range_end(r) - std::min(range_begin(r), range_end(r));
+        if (p != self && left > best) {
+          best = left;
+          victim = p;
+        }
+      }
+      if (victim < 0)
+        return false;
+
+      std::atomic<uint64_t> &range = slots_[victim].range;
+      uint64_t r = range.load(std::memory_order_acquire);
+      uint32_t begin = range_begin(r), end = range_end(r);
+      if (begin >= end)
+        continue;
+      uint32_t mid = begin + (end - begin) / 2;
+      if (range.compare_exchange_strong(r, pack(begin, mid),
+                                        std::memory_order_acq_rel)) {
+        slots_[self].range.store(pack(mid, end), std::memory_order_release);
+        return true;
+      }
+    }
+  }
+
+  void run_participant(int self) {
+    in_task() = true;
+    int index;
+    do {
+      while (pop(self, index))
+        (*task_)(index);
+    } while (steal(self));
+    in_task() = false;
+  }
+
+  void worker_loop(int id, uint64_t seen) {
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_)
+          return;
+        seen = generation_;
+        if (id >= participants_)
+          continue;
+      }
+
+      run_participant(id);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0)
+        done_.notify_one();
+    }
+  }
+
+  void stop_workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_)
+      worker.join();
+    workers_.clear();
+  }
+
+  std::vector<std::thread> workers_;
+  std::unique_ptr<Slot[]> slots_;
+
+  std::mutex run_mutex_; // one parallel_for at a time
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int)> *task_ = nullptr;
+  uint64_t generation_ = 0;
+  int participants_ = 0;
+  int pending_ = 0;
+  bool stop_ = false;
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "blocked.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+// Tuned kernel parameters, persisted per (type, implementation, shape bucket).
+//
+// The cache is a plain text file, one entry per line:
+//
+//   # type impl m_bucket n_bucket k_bucket vlen lmul clamp_freq mc kc nc
+//   #   threads ms cutoff
+//   int8 blocked 8 8 8 0 0 0 128 256 512 4 1.734 0
+//
+// A bucket is ceil(log2(size)), so 129..256 share bucket 8. The file named by
+// $MATMUL_TUNING_CACHE (default ~/.cache/matmul_tuning.txt) is loaded the
+// first time a kernel looks up its parameters; autotune() fills in entries
+// and TuningCache::save() writes them back. Zero means "use the built-in
+// default" for every field. The trailing cutoff column may be missing (caches
+// written before Strassen was added) and then reads as zero. MatMulImpl::AUTO
+// runs the implementation with the lowest ms in the bucket of its shape.
+
+struct TuneParams {
+  int vlen = 0;       // strip width cap for the vector kernels (0 = VLMAX)
+  int lmul = 0;       // register group of the float vector kernel
+  int clamp_freq = 0; // clamp interval of the integer vector kernels
+  BlockSizes blocks = {0, 0, 0}; // cache blocks of the blocked driver
+  int threads = 0;    // worker threads for matmul_parallel
+  double ms = 0.0;    // median time measured while tuning
+  int cutoff = 0;     // Strassen recursion cutoff (see strassen.h)
+};
+
+struct TuneKey {
+  std::string type; // "int8", "int16", "int32", "float"
+  std::string impl; // short implementation name, see getImplKey()
+  int m_bucket = 0;
+  int n_bucket = 0;
+  int k_bucket = 0;
+
+  bool operator<(const TuneKey &other) const {
+    return std::tie(type, impl, m_bucket, n_bucket, k_bucket) <
+           std::tie(other.type, other.impl, other.m_bucket, other.n_bucket,
+                    other.k_bucket);
+  }
+};
+
+// ceil(log2(size)), 0 for sizes up to 1
+inline int tune_bucket(int size) {
+  int bucket = 0;
+  while (bucket < 31 && (1 << bucket) < size)
+    ++bucket;
+  return bucket;
+}
+
+// Cache blocks from params, with zero fields taken from the defaults
+template <typename T> BlockSizes tuned_blocks(const TuneParams &params) {
+  BlockSizes bs = BlockedTraits<T>::defaults();
+  if (params.blocks.mc > 0)
+    bs.mc = params.blocks.mc;
+  if (params.blocks.kc > 0)
+    bs.kc = params.blocks.kc;
+  if (params.blocks.nc > 0)
+    bs.nc = params.blocks.nc;
+  return bs;
+}
+
+template <typename T>
+TuneKey make_tune_key(const std::string &impl, int m, int n, int k) {
+  return {element_type_name<T>(), impl, tune_bucket(m), tune_bucket(n),
+          tune_bucket(k)};
+}
+
+class TuningCache {
+public:
+  // Process-wide cache, loaded from default_path() on first use. A missing
+  // or unreadable file leaves it empty.
+  static TuningCache &instance() {
+    static TuningCache *cache = [] {
+      auto *c = new TuningCache();
+      try {
+        c->load(default_path());
+      } catch (const std::exception &) {
+        c->clear();
+      }
+      return c;
+    }();
+    return *cache;
+  }
+
+  static std::string default_path() {
+    if (const char *env = std::getenv("MATMUL_TUNING_CACHE"))
+      return env;
+    if (const char *home = std::getenv("HOME"))
+      return std::string(home) + "/.cache/matmul_tuning.txt";
+    return "matmul_tuning.txt";
+  }
+
+  // Merge the entries of a cache file. Returns false if it cannot be opened;
+  // throws std::runtime_error on a malformed line.
+  bool load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in)
+      return false;
+
+    std::map<TuneKey, TuneParams> loaded;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+      ++line_no;
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream fields(line);
+      TuneKey key;
+      TuneParams p;
+      if (!(fields >> key.type >> key.impl >> key.m_bucket >> key.n_bucket >>
+            key.k_bucket >> p.vlen >> p.lmul >> p.clamp_freq >> p.blocks.mc >>
+            p.blocks.kc >> p.blocks.nc >> p.threads >> p.ms))
+        throw std::runtime_error("Malformed tuning cache entry at " + path +
+                                 ":" + std::to_string(line_no));
+      if (!(fields >> p.cutoff))
+        p.cutoff = 0;
+      loaded[key] = p;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &entry : loaded)
+      entries_[entry.first] = entry.second;
+    size_.store(entries_.size(), std::memory_order_release);
+    return true;
+  }
+
+  // Write every entry to path, creating its directory if needed; throws
+  // std::runtime_error on failure
+  void save(const std::string &path) const {
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    std::error_code ignored;
+    if (!dir.empty())
+      std::filesystem::create_directories(dir, ignored);
+    std::ofstream out(path);
+    if (!out)
+      throw std::runtime_error("Cannot write tuning cache " + path);
+    out << "# matmul tuning cache\n"
+        << "# type impl m_bucket n_bucket k_bucket vlen lmul clamp_freq mc kc "
+           "nc threads ms cutoff\n";
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &entry : entries_) {
+      const TuneKey &k = entry.first;
+      const TuneParams &p = entry.second;
+      out << k.type << " " << k.impl << " " << k.m_bucket << " " << k.n_bucket
+          << " " << k.k_bucket << " " << p.vlen << " " << p.lmul << " "
+          << p.clamp_freq << " " << p.blocks.mc << " " << p.blocks.kc << " "
+          << p.blocks.nc << " " << p.threads << " " << p.ms << " " << p.cutoff
+          << "\n";
+    }
+    if (!out)
+      throw std::runtime_error("Cannot write tuning cache " + path);
+  }
+
+  std::optional<TuneParams> find(const TuneKey &key) const {
+    // Untuned processes skip the lock entirely
+    if (size_.load(std::memory_order_acquire) == 0)
+      return std::nullopt;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+  // Implementation key of the fastest tuned entry (lowest ms) for the type
+  // and shape buckets of key, whose own impl is ignored
+  std::optional<std::string> fastest(const TuneKey &key) const {
+    if (size_.load(std::memory_order_acquire) == 0)
+      return std::nullopt;
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::optional<std::string> best;
+    double best_ms = 0.0;
+    for (const auto &entry : entries_) {
+      const TuneKey &k = entry.first;
+      if (k.type != key.type || k.m_bucket != key.m_bucket ||
+          k.n_bucket != key.n_bucket || k.k_bucket != key.k_bucket ||
+          entry.second.ms <= 0.0)
+        continue;
+      if (!best || entry.second.ms < best_ms) {
+        best = k.impl;
+        best_ms = entry.second.ms;
+      }
+    }
+    return best;
+  }
+
+  void insert(const TuneKey &key, const TuneParams &params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[key] = params;
+    size_.store(entries_.size(), std::memory_order_release);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    size_.store(0, std::memory_order_release);
+  }
+
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+
+private:
+  TuningCache() = default;
+
+  mutable std::mutex mutex_;
+  std::map<TuneKey, TuneParams> entries_;
+  std::atomic<size_t> size_{0};
+};
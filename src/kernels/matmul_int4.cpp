@@ -0,0 +1,24 @@
+// int4 weight-only kernels of int4.h, instantiated from rvv_int4.h: LMUL 2
+// accumulators (fp32, plus int32 per group for int8 activations), four-row
+// tiles.
+
+#include "rvv_int4.h"
+
+extern "C" {
+
+void matmul_asm_int4_int8(const int8_t *a, int lda, const float *a_scale,
+                          const uint8_t *b, const float *scales, float *c,
+                          int ldc, int a_rows, int a_cols, int b_cols,
+                          int group_size, int vlen) {
+  rvv_int4_matmul<int8_t, 2, 4>(a, lda, a_scale, b, scales, c, ldc, a_rows,
+                                a_cols, b_cols, group_size, vlen);
+}
+
+void matmul_asm_int4_float(const float *a, int lda, const uint8_t *b,
+                           const float *scales, float *c, int ldc, int a_rows,
+                           int a_cols, int b_cols, int group_size, int vlen) {
+  rvv_int4_matmul<float, 2, 4>(a, lda, nullptr, b, scales, c, ldc, a_rows,
+                               a_cols, b_cols, group_size, vlen);
+}
+
+} // extern "C"
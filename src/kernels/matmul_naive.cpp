@@ -0,0 +1,58 @@
+// Scalar reference kernels behind MatMulImpl::ASM_NAIVE, one template for
+// every element type. C[i][j] is a single i-j-k dot product accumulated in
+// 64 bits (or float) and, for integers, saturated into [int_min, int_max].
+// Built without auto-vectorization in both the RISC-V and the host builds,
+// so they stay the scalar baseline the other kernels are measured against.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace {
+
+template <typename T>
+void naive_matmul(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                  int b_cols, int int_min, int int_max) {
+  using AccumulatorType = std::conditional_t<std::is_integral_v<T>, int64_t, T>;
+  for (int i = 0; i < a_rows; ++i) {
+    for (int j = 0; j < b_cols; ++j) {
+      AccumulatorType sum = 0;
+      for (int p = 0; p < a_cols; ++p)
+        sum += AccumulatorType(a[size_t(i) * a_cols + p]) *
+               AccumulatorType(b[size_t(p) * b_cols + j]);
+      if constexpr (std::is_integral_v<T>)
+        sum = std::clamp<AccumulatorType>(sum, int_min, int_max);
+      c[size_t(i) * b_cols + j] = T(sum);
+    }
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+void matmul_asm_naive_float(const float *a, const float *b, float *c,
+                            int a_rows, int a_cols, int b_cols) {
+  naive_matmul(a, b, c, a_rows, a_cols, b_cols, 0, 0);
+}
+
+void matmul_asm_naive_int8(const int8_t *a, const int8_t *b, int8_t *c,
+                           int a_rows, int a_cols, int b_cols, int int_min,
+                           int int_max) {
+  naive_matmul(a, b, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_naive_int16(const int16_t *a, const int16_t *b, int16_t *c,
+                            int a_rows, int a_cols, int b_cols, int int_min,
+                            int int_max) {
+  naive_matmul(a, b, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_naive_int32(const int32_t *a, const int32_t *b, int32_t *c,
+                            int a_rows, int a_cols, int b_cols, int int_min,
+                            int int_max) {
+  naive_matmul(a, b, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+} // extern "C"
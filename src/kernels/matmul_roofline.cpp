@@ -0,0 +1,85 @@
+// Roofline microkernels of roofline.h, instantiated from rvv_roofline.h for
+// every register group of the sweep. Shapes the sweep does not cover return
+// 0 multiply-accumulates.
+
+#include "rvv_roofline.h"
+
+namespace {
+
+volatile double roofline_sink;
+
+template <typename T, bool Widen>
+uint64_t roofline_macs(int lmul, long iterations) {
+  switch (lmul) {
+  case 1:
+    return rvv_roofline_macs<T, 1, Widen>(iterations, roofline_sink);
+  case 2:
+    return rvv_roofline_macs<T, 2, Widen>(iterations, roofline_sink);
+  case 4:
+    return rvv_roofline_macs<T, 4, Widen>(iterations, roofline_sink);
+  case 8:
+    // vwmacc has no register group of 16
+    if constexpr (!Widen)
+      return rvv_roofline_macs<T, 8, Widen>(iterations, roofline_sink);
+  }
+  return 0;
+}
+
+} // namespace
+
+extern "C" {
+
+float matmul_roofline_load(const float *buf, size_t n, int access,
+                           size_t stride, const uint32_t *offsets, int lmul,
+                           int passes) {
+  switch (lmul) {
+  case 1:
+    return rvv_roofline_load<1>(buf, n, access, stride, offsets, passes);
+  case 2:
+    return rvv_roofline_load<2>(buf, n, access, stride, offsets, passes);
+  case 4:
+    return rvv_roofline_load<4>(buf, n, access, stride, offsets, passes);
+  default:
+    return rvv_roofline_load<8>(buf, n, access, stride, offsets, passes);
+  }
+}
+
+void matmul_roofline_store(float *buf, size_t n, int access, size_t stride,
+                           const uint32_t *offsets, int lmul, int passes) {
+  switch (lmul) {
+  case 1:
+    return rvv_roofline_store<1>(buf, n, access, stride, offsets, passes);
+  case 2:
+    return rvv_roofline_store<2>(buf, n, access, stride, offsets, passes);
+  case 4:
+    return rvv_roofline_store<4>(buf, n, access, stride, offsets, passes);
+  default:
+    return rvv_roofline_store<8>(buf, n, access, stride, offsets, passes);
+  }
+}
+
+uint64_t matmul_roofline_macs(int op, int sew, int lmul, long iterations) {
+  switch (op) {
+  case 0: // vfmacc
+    return sew == 32 ? roofline_macs<float, false>(lmul, iterations) : 0;
+  case 1: // vmacc
+    if (sew == 8)
+      return roofline_macs<int8_t, false>(lmul, iterations);
+    if (sew == 16)
+      return roofline_macs<int16_t, false>(lmul, iterations);
+    if (sew == 32)
+      return roofline_macs<int32_t, false>(lmul, iterations);
+    return 0;
+  case 2: // vwmacc, sew of the sources
+    if (sew == 8)
+      return roofline_macs<int8_t, true>(lmul, iterations);
+    if (sew == 16)
+      return roofline_macs<int16_t, true>(lmul, iterations);
+    if (sew == 32)
+      return roofline_macs<int32_t, true>(lmul, iterations);
+    return 0;
+  }
+  return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,28 @@
+// Vector kernels instantiated from rvv_matmul.h. Each keeps the C contract of
+// the assembly kernel it replaced: accumulate wide, saturate once into
+// [int_min, int_max], vlen caps the strip width. clamp_freq is accepted for
+// the common signature and ignored: nothing is clamped before the end.
+//
+// int16 accumulates in int32 like the blocked micro-kernels (and the C++
+// reference); int32 accumulates in int64. Both use 4 x (4 * VLEN / bits(Acc))
+// tiles: sixteen accumulator registers, four for the widened row of B.
+
+#include "rvv_matmul.h"
+
+extern "C" {
+
+void matmul_asm_vector_int16(const int16_t *a, const int16_t *b, int16_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max, int, int vlen) {
+  rvv_matmul<int16_t, int32_t, 4, 4>(a, b, c, a_rows, a_cols, b_cols, int_min,
+                                     int_max, vlen);
+}
+
+void matmul_asm_vector_int32(const int32_t *a, const int32_t *b, int32_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max, int, int vlen) {
+  rvv_matmul<int32_t, int64_t, 4, 4>(a, b, c, a_rows, a_cols, b_cols, int_min,
+                                     int_max, vlen);
+}
+
+} // extern "C"
@@ -0,0 +1,67 @@
+// Sparse x dense kernels of sparse.h, instantiated from rvv_spmm.h: LMUL 4
+// accumulators (float, or int32 for int8 with one saturation at the end).
+
+#include "rvv_spmm.h"
+
+extern "C" {
+
+void matmul_asm_spmm_csr_float(const int32_t *row_ptr, const int32_t *col_idx,
+                               const float *values, const float *b, float *c,
+                               int a_rows, int b_cols, int vlen) {
+  rvv_spmm<float, float, 4>(RvvCsrRows{row_ptr, col_idx}, values, b, c, a_rows,
+                            b_cols, 0.0f, 0.0f, vlen);
+}
+
+void matmul_asm_spmm_csr_int8(const int32_t *row_ptr, const int32_t *col_idx,
+                              const int8_t *values, const int8_t *b, int8_t *c,
+                              int a_rows, int b_cols, int int_min, int int_max,
+                              int vlen) {
+  rvv_spmm<int8_t, int32_t, 4>(RvvCsrRows{row_ptr, col_idx}, values, b, c,
+                               a_rows, b_cols, int_min, int_max, vlen);
+}
+
+void matmul_asm_spmm_24_float(const float *values, const uint8_t *pos,
+                              const float *b, float *c, int a_rows,
+                              int a_cols, int b_cols, int vlen) {
+  rvv_spmm<float, float, 4>(Rvv24Rows{pos, size_t(a_cols + 3) / 4 * 2}, values,
+                            b, c, a_rows, b_cols, 0.0f, 0.0f, vlen);
+}
+
+void matmul_asm_spmm_24_int8(const int8_t *values, const uint8_t *pos,
+                             const int8_t *b, int8_t *c, int a_rows,
+                             int a_cols, int b_cols, int int_min, int int_max,
+                             int vlen) {
+  rvv_spmm<int8_t, int32_t, 4>(Rvv24Rows{pos, size_t(a_cols + 3) / 4 * 2},
+                               values, b, c, a_rows, b_cols, int_min, int_max,
+                               vlen);
+}
+
+void matmul_asm_spmv_csr_float(const int32_t *row_ptr, const int32_t *col_idx,
+                               const float *values, const float *x, float *y,
+                               int a_rows) {
+  rvv_spmv<float, float, 4>(RvvCsrRows{row_ptr, col_idx}, values, x, y, a_rows,
+                            0.0f, 0.0f);
+}
+
+void matmul_asm_spmv_csr_int8(const int32_t *row_ptr, const int32_t *col_idx,
+                              const int8_t *values, const int8_t *x, int8_t *y,
+                              int a_rows, int int_min, int int_max) {
+  rvv_spmv<int8_t, int32_t, 4>(RvvCsrRows{row_ptr, col_idx}, values, x, y,
+                               a_rows, int_min, int_max);
+}
+
+void matmul_asm_spmv_24_float(const float *values, const uint8_t *pos,
+                              const float *x, float *y, int a_rows,
+                              int a_cols) {
+  rvv_spmv<float, float, 4>(Rvv24Rows{pos, size_t(a_cols + 3) / 4 * 2}, values,
+                            x, y, a_rows, 0.0f, 0.0f);
+}
+
+void matmul_asm_spmv_24_int8(const int8_t *values, const uint8_t *pos,
+                             const int8_t *x, int8_t *y, int a_rows,
+                             int a_cols, int int_min, int int_max) {
+  rvv_spmv<int8_t, int32_t, 4>(Rvv24Rows{pos, size_t(a_cols + 3) / 4 * 2},
+                               values, x, y, a_rows, int_min, int_max);
+}
+
+} // extern "C"
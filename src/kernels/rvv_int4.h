@@ -0,0 +1,163 @@
+#pragma once
+
+#include "rvv_matmul.h"
+
+// int4 weight-only kernels (see src/hpp/int4.h) on the rvv_matmul.h
+// building blocks: C (float) = A * dequant(Q), Q packed two k rows per byte.
+//
+//   rvv_int4_matmul<int8_t, LMUL, MR>  int8 activations: int32 accumulators
+//                                      per quantization group (vwmacc on
+//                                      int16), folded into fp32 with the
+//                                      group's column scales, times the row
+//                                      scale of A at the end
+//   rvv_int4_matmul<float, LMUL, MR>   fp32 activations: each unpacked row
+//                                      converted and scaled once, shared by
+//                                      the MR rows of the tile (vfmacc)
+//
+// A byte holds row p of a column in its low nibble and row p + 1 in its high
+// nibble, so one unit-stride load of vl bytes yields two rows of vl columns
+// and unpacking is two shifts, with no lane shuffles: vsll + vsra sign-extend
+// the low nibble, vsra alone the high one. Weight traffic is half that of
+// int8. LMUL is the register group of the 32-bit accumulators.
+
+// The packed bytes of the same element count as 32-bit groups of LMUL
+template <int LMUL> struct RvvInt4;
+
+#define MATMUL_RVV_INT4(LMUL, BYTE_GROUP)                                      \
+  template <> struct RvvInt4<LMUL> {                                           \
+    static auto load_bytes(const uint8_t *p, size_t vl) {                      \
+      return __riscv_vle8_v_i8##BYTE_GROUP(reinterpret_cast<const int8_t *>(p), \
+                                           vl);                                \
+    }                                                                          \
+  };
+
+MATMUL_RVV_INT4(2, mf2)
+MATMUL_RVV_INT4(4, m1)
+
+#undef MATMUL_RVV_INT4
+
+// Sign-extended int8 values of the low and high nibbles
+template <typename V> inline V rvv_low_nibbles(V bytes, size_t vl) {
+  return __riscv_vsra(__riscv_vsll(bytes, 4, vl), 4, vl);
+}
+
+template <typename V> inline V rvv_high_nibbles(V bytes, size_t vl) {
+  return __riscv_vsra(bytes, 4, vl);
+}
+
+// C[0:R][0:vl] for activations A (int8 with row scales a_scale, or float).
+// b and scales point at column j of packed row pair 0 and of group 0, both
+// with rows ldb apart.
+template <typename A, int LMUL, int R>
+inline void rvv_int4_tile(const A *a, int lda, const float *a_scale,
+                          const uint8_t *b, const float *scales, int ldb,
+                          float *c, int ldc, int k, int group, size_t vl) {
+  static_assert(R >= 1 && R <= 4, "tile height must be 1..4 rows");
+  using FloatOps = RvvTypes<float, LMUL>;
+  using IntOps = RvvTypes<int32_t, LMUL>;
+  constexpr bool int8_activations = std::is_same_v<A, int8_t>;
+
+  typename FloatOps::vec c0 = FloatOps::splat(0.0f, vl);
+  typename FloatOps::vec c1 = c0, c2 = c0, c3 = c0;
+
+  for (int g0 = 0; g0 < k; g0 += group) {
+    const int g1 = std::min(k, g0 + group);
+    auto s = FloatOps::load(scales + size_t(g0 / group) * ldb, vl);
+
+    if constexpr (int8_activations) {
+      typename IntOps::vec i0 = IntOps::splat(0, vl);
+      typename IntOps::vec i1 = i0, i2 = i0, i3 = i0;
+      auto madd = [&](int p, auto w) {
+        i0 = __riscv_vwmacc(i0, int16_t(a[p]), w, vl);
+        if constexpr (R > 1)
+          i1 = __riscv_vwmacc(i1, int16_t(a[size_t(1) * lda + p]), w, vl);
+        if constexpr (R > 2)
+          i2 = __riscv_vwmacc(i2, int16_t(a[size_t(2) * lda + p]), w, vl);
+        if constexpr (R > 3)
+          i3 = __riscv_vwmacc(i3, int16_t(a[size_t(3) * lda + p]), w, vl);
+      };
+      for (int p = g0; p < g1; p += 2) {
+        auto bytes = RvvInt4<LMUL>::load_bytes(b + size_t(p / 2) * ldb, vl);
+        madd(p, __riscv_vsext_vf2(rvv_low_nibbles(bytes, vl), vl));
+        if (p + 1 < g1)
+          madd(p + 1, __riscv_vsext_vf2(rvv_high_nibbles(bytes, vl), vl));
+      }
+
+      // Fold the group into fp32 with its column scales
+      c0 = __riscv_vfmacc(c0, s, __riscv_vfcvt_f(i0, vl), vl);
+      if constexpr (R > 1)
+        c1 = __riscv_vfmacc(c1, s, __riscv_vfcvt_f(i1, vl), vl);
+      if constexpr (R > 2)
+        c2 = __riscv_vfmacc(c2, s, __riscv_vfcvt_f(i2, vl), vl);
+      if constexpr (R > 3)
+        c3 = __riscv_vfmacc(c3, s, __riscv_vfcvt_f(i3, vl), vl);
+    } else {
+      auto madd = [&](int p, auto w) {
+        c0 = rvv_madd(c0, float(a[p]), w, vl);
+        if constexpr (R > 1)
+          c1 = rvv_madd(c1, float(a[size_t(1) * lda + p]), w, vl);
+        if constexpr (R > 2)
+          c2 = rvv_madd(c2, float(a[size_t(2) * lda + p]), w, vl);
+        if constexpr (R > 3)
+          c3 = rvv_madd(c3, float(a[size_t(3) * lda + p]), w, vl);
+      };
+      // Dequantize a nibble row: sign-extend to int32, convert, scale
+      auto dequant = [&](auto nibbles) {
+        return __riscv_vfmul(
+            __riscv_vfcvt_f(__riscv_vsext_vf4(nibbles, vl), vl), s, vl);
+      };
+      for (int p = g0; p < g1; p += 2) {
+        auto bytes = RvvInt4<LMUL>::load_bytes(b + size_t(p / 2) * ldb, vl);
+        madd(p, dequant(rvv_low_nibbles(bytes, vl)));
+        if (p + 1 < g1)
+          madd(p + 1, dequant(rvv_high_nibbles(bytes, vl)));
+      }
+    }
+  }
+
+  if constexpr (int8_activations) {
+    c0 = __riscv_vfmul(c0, a_scale[0], vl);
+    if constexpr (R > 1)
+      c1 = __riscv_vfmul(c1, a_scale[1], vl);
+    if constexpr (R > 2)
+      c2 = __riscv_vfmul(c2, a_scale[2], vl);
+    if constexpr (R > 3)
+      c3 = __riscv_vfmul(c3, a_scale[3], vl);
+  }
+  FloatOps::store(c, c0, vl);
+  if constexpr (R > 1)
+    FloatOps::store(c + size_t(1) * ldc, c1, vl);
+  if constexpr (R > 2)
+    FloatOps::store(c + size_t(2) * ldc, c2, vl);
+  if constexpr (R > 3)
+    FloatOps::store(c + size_t(3) * ldc, c3, vl);
+}
+
+// C (a_rows x b_cols, rows ldc apart) = A (rows lda apart) * dequant(Q) for
+// Q of a_cols rows packed in pairs, b_cols bytes per pair, and one scale per
+// group of group rows and column. a_scale holds one scale per row of A
+// (int8 activations only). vlen caps the strip width (0 = VLMAX).
+template <typename A, int LMUL, int MR>
+void rvv_int4_matmul(const A *a, int lda, const float *a_scale,
+                     const uint8_t *b, const float *scales, float *c, int ldc,
+                     int a_rows, int a_cols, int b_cols, int group, int vlen) {
+  size_t vl = 0;
+  for (int j = 0; j < b_cols; j += int(vl)) {
+    size_t strip = size_t(b_cols - j);
+    if (vlen > 0)
+      strip = std::min(strip, size_t(vlen));
+    vl = RvvTypes<float, LMUL>::setvl(strip);
+
+    int i = 0;
+    for (; i + MR <= a_rows; i += MR)
+      rvv_int4_tile<A, LMUL, MR>(a + size_t(i) * lda, lda,
+                                 a_scale ? a_scale + i : nullptr, b + j,
+                                 scales + j, b_cols, c + size_t(i) * ldc + j,
+                                 ldc, a_cols, group, vl);
+    for (; i < a_rows; ++i)
+      rvv_int4_tile<A, LMUL, 1>(a + size_t(i) * lda, lda,
+                                a_scale ? a_scale + i : nullptr, b + j,
+                                scales + j, b_cols, c + size_t(i) * ldc + j,
+                                ldc, a_cols, group, vl);
+  }
+}
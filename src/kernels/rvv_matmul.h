@@ -0,0 +1,195 @@
+#pragma once
+
+#include <riscv_vector.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// C = A * B kernels written once with RVV intrinsics and instantiated per
+// element type, accumulator type, register group and tile height.
+//
+//   rvv_matmul<T, Acc, LMUL, MR>
+//
+// computes C in MR x NR tiles, NR = LMUL * VLEN / bits(Acc): MR accumulator
+// groups of LMUL registers each, one row of B loaded per k, sign-extended to
+// Acc and multiplied by A[i..i+MR-1][k] broadcast from scalars. Integer
+// results are saturated once into [lo, hi] and narrowed back to T. The last
+// strip of each row block is shortened by vsetvl, and rows left over after
+// the MR-row blocks run through the one-row instance of the same tile.
+//
+// RvvTypes maps (element type, LMUL) to its register type and to the
+// intrinsics that cannot be resolved from their arguments (vsetvl, loads,
+// stores and splats); everything else uses the overloaded intrinsics. A new
+// element width or register group is one MATMUL_RVV_TYPES line, a new kernel
+// one instantiation in matmul_rvv.cpp.
+
+template <typename T, int LMUL> struct RvvTypes;
+
+#define MATMUL_RVV_TYPES(T, LMUL, BASE, SEW, TYPE, GROUP, SPLAT)               \
+  template <> struct RvvTypes<T, LMUL> {                                       \
+    using vec = v##BASE##GROUP##_t;                                            \
+    static size_t setvl(size_t n) { return __riscv_vsetvl_e##SEW##GROUP(n); }  \
+    static vec load(const T *p, size_t vl) {                                   \
+      return __riscv_vle##SEW##_v_##TYPE##GROUP(p, vl);                        \
+    }                                                                          \
+    static void store(T *p, vec v, size_t vl) {                                \
+      __riscv_vse##SEW##_v_##TYPE##GROUP(p, v, vl);                            \
+    }                                                                          \
+    static vec splat(T x, size_t vl) {                                         \
+      return __riscv_##SPLAT##_##TYPE##GROUP(x, vl);                           \
+    }                                                                          \
+  };
+
+MATMUL_RVV_TYPES(int8_t, 1, int8, 8, i8, m1, vmv_v_x)
+MATMUL_RVV_TYPES(int8_t, 2, int8, 8, i8, m2, vmv_v_x)
+MATMUL_RVV_TYPES(int8_t, 4, int8, 8, i8, m4, vmv_v_x)
+MATMUL_RVV_TYPES(int8_t, 8, int8, 8, i8, m8, vmv_v_x)
+MATMUL_RVV_TYPES(int16_t, 1, int16, 16, i16, m1, vmv_v_x)
+MATMUL_RVV_TYPES(int16_t, 2, int16, 16, i16, m2, vmv_v_x)
+MATMUL_RVV_TYPES(int16_t, 4, int16, 16, i16, m4, vmv_v_x)
+MATMUL_RVV_TYPES(int16_t, 8, int16, 16, i16, m8, vmv_v_x)
+MATMUL_RVV_TYPES(int32_t, 1, int32, 32, i32, m1, vmv_v_x)
+MATMUL_RVV_TYPES(int32_t, 2, int32, 32, i32, m2, vmv_v_x)
+MATMUL_RVV_TYPES(int32_t, 4, int32, 32, i32, m4, vmv_v_x)
+MATMUL_RVV_TYPES(int32_t, 8, int32, 32, i32, m8, vmv_v_x)
+MATMUL_RVV_TYPES(int64_t, 2, int64, 64, i64, m2, vmv_v_x)
+MATMUL_RVV_TYPES(int64_t, 4, int64, 64, i64, m4, vmv_v_x)
+MATMUL_RVV_TYPES(int64_t, 8, int64, 64, i64, m8, vmv_v_x)
+MATMUL_RVV_TYPES(float, 1, float32, 32, f32, m1, vfmv_v_f)
+MATMUL_RVV_TYPES(float, 2, float32, 32, f32, m2, vfmv_v_f)
+MATMUL_RVV_TYPES(float, 4, float32, 32, f32, m4, vfmv_v_f)
+MATMUL_RVV_TYPES(float, 8, float32, 32, f32, m8, vfmv_v_f)
+
+#undef MATMUL_RVV_TYPES
+
+// Signed integer type of half the width of T
+template <typename T>
+using rvv_half_t = std::conditional_t<
+    sizeof(T) == 8, int32_t,
+    std::conditional_t<sizeof(T) == 4, int16_t, int8_t>>;
+
+// Sign-extend a register group of T to Acc (group widened by the same ratio)
+template <typename T, typename Acc, typename V>
+inline auto rvv_widen(V v, size_t vl) {
+  constexpr size_t ratio = sizeof(Acc) / sizeof(T);
+  if constexpr (ratio == 1)
+    return v;
+  else if constexpr (ratio == 2)
+    return __riscv_vsext_vf2(v, vl);
+  else if constexpr (ratio == 4)
+    return __riscv_vsext_vf4(v, vl);
+  else
+    return __riscv_vsext_vf8(v, vl);
+}
+
+// Narrow a register group of Acc to T, one halving vncvt per step; the
+// values are already saturated, so truncation is exact
+template <typename T, typename Acc, typename V>
+inline auto rvv_narrow(V v, size_t vl) {
+  if constexpr (sizeof(Acc) == sizeof(T))
+    return v;
+  else
+    return rvv_narrow<T, rvv_half_t<Acc>>(__riscv_vncvt_x(v, vl), vl);
+}
+
+// acc += x * v
+template <typename Acc, typename V>
+inline V rvv_madd(V acc, Acc x, V v, size_t vl) {
+  if constexpr (std::is_floating_point_v<Acc>)
+    return __riscv_vfmacc(acc, x, v, vl);
+  else
+    return __riscv_vmacc(acc, x, v, vl);
+}
+
+// Saturate one accumulator group into [lo, hi] and store it as a row of C
+template <typename T, typename Acc, int LMUL, typename V>
+inline void rvv_store_row(T *c, V acc, Acc lo, Acc hi, size_t vl) {
+  constexpr int in_lmul = int(LMUL * sizeof(T) / sizeof(Acc));
+  if constexpr (std::is_integral_v<Acc>) {
+    acc = __riscv_vmax(acc, lo, vl);
+    acc = __riscv_vmin(acc, hi, vl);
+  }
+  RvvTypes<T, in_lmul>::store(c, rvv_narrow<T, Acc>(acc, vl), vl);
+}
+
+// C[0:R][0:vl] = A[0:R][0:k] * B[0:k][0:vl]. RVV register types cannot be
+// array elements, so the (at most eight) accumulators are named and the
+// unused ones compile away.
+template <typename T, typename Acc, int LMUL, int R>
+inline void rvv_tile(const T *a, int lda, const T *b, int ldb, T *c, int ldc,
+                     int k, size_t vl, Acc lo, Acc hi) {
+  static_assert(R >= 1 && R <= 8, "tile height must be 1..8 rows");
+  constexpr int in_lmul = int(LMUL * sizeof(T) / sizeof(Acc));
+  using AccOps = RvvTypes<Acc, LMUL>;
+  using InOps = RvvTypes<T, in_lmul>;
+
+  typename AccOps::vec c0 = AccOps::splat(Acc(0), vl);
+  typename AccOps::vec c1 = c0, c2 = c0, c3 = c0, c4 = c0, c5 = c0, c6 = c0,
+                       c7 = c0;
+
+  for (int p = 0; p < k; ++p) {
+    auto row = rvv_widen<T, Acc>(InOps::load(b + size_t(p) * ldb, vl), vl);
+    const T *a_col = a + p;
+    c0 = rvv_madd(c0, Acc(a_col[0]), row, vl);
+    if constexpr (R > 1)
+      c1 = rvv_madd(c1, Acc(a_col[size_t(1) * lda]), row, vl);
+    if constexpr (R > 2)
+      c2 = rvv_madd(c2, Acc(a_col[size_t(2) * lda]), row, vl);
+    if constexpr (R > 3)
+      c3 = rvv_madd(c3, Acc(a_col[size_t(3) * lda]), row, vl);
+    if constexpr (R > 4)
+      c4 = rvv_madd(c4, Acc(a_col[size_t(4) * lda]), row, vl);
+    if constexpr (R > 5)
+      c5 = rvv_madd(c5, Acc(a_col[size_t(5) * lda]), row, vl);
+    if constexpr (R > 6)
+      c6 = rvv_madd(c6, Acc(a_col[size_t(6) * lda]), row, vl);
+    if constexpr (R > 7)
+      c7 = rvv_madd(c7, Acc(a_col[size_t(7) * lda]), row, vl);
+  }
+
+  rvv_store_row<T, Acc, LMUL>(c, c0, lo, hi, vl);
+  if constexpr (R > 1)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(1) * ldc, c1, lo, hi, vl);
+  if constexpr (R > 2)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(2) * ldc, c2, lo, hi, vl);
+  if constexpr (R > 3)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(3) * ldc, c3, lo, hi, vl);
+  if constexpr (R > 4)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(4) * ldc, c4, lo, hi, vl);
+  if constexpr (R > 5)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(5) * ldc, c5, lo, hi, vl);
+  if constexpr (R > 6)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(6) * ldc, c6, lo, hi, vl);
+  if constexpr (R > 7)
+    rvv_store_row<T, Acc, LMUL>(c + size_t(7) * ldc, c7, lo, hi, vl);
+}
+
+// C (a_rows x b_cols) = A * B, all row-major and contiguous. vlen caps the
+// strip width in elements (0 = VLMAX), as the tuned parameter of the
+// assembly vector kernels.
+template <typename T, typename Acc, int LMUL, int MR>
+void rvv_matmul(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                int b_cols, Acc lo, Acc hi, int vlen) {
+  static_assert(LMUL * sizeof(T) % sizeof(Acc) == 0,
+                "the element group must be at least one register");
+  static_assert(MR * LMUL <= 24, "accumulators must leave room for B");
+
+  size_t vl = 0;
+  for (int j = 0; j < b_cols; j += int(vl)) {
+    size_t strip = size_t(b_cols - j);
+    if (vlen > 0)
+      strip = std::min(strip, size_t(vlen));
+    vl = RvvTypes<Acc, LMUL>::setvl(strip);
+
+    int i = 0;
+    for (; i + MR <= a_rows; i += MR)
+      rvv_tile<T, Acc, LMUL, MR>(a + size_t(i) * a_cols, a_cols, b + j, b_cols,
+                                 c + size_t(i) * b_cols + j, b_cols, a_cols,
+                                 vl, lo, hi);
+    for (; i < a_rows; ++i)
+      rvv_tile<T, Acc, LMUL, 1>(a + size_t(i) * a_cols, a_cols, b + j, b_cols,
+                                c + size_t(i) * b_cols + j, b_cols, a_cols, vl,
+                                lo, hi);
+  }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "rvv_spmm.h"
+
+// Roofline microkernels (see src/hpp/roofline.h) on the rvv_matmul.h
+// building blocks: the memory and multiply-accumulate rates the matmul
+// kernels are bounded by, one register group size at a time.
+//
+//   rvv_roofline_load<LMUL>    read n fp32 elements per pass: unit stride
+//                              (vle32), strided (vlse32) or gathered through
+//                              byte offsets (vluxei32), summed with vfadd so
+//                              the loads stay live
+//   rvv_roofline_store<LMUL>   write them with vse32, vsse32 or vsuxei32
+//   rvv_roofline_macs<T, LMUL, Widen>
+//                              independent vfmacc / vmacc (or vwmacc into
+//                              twice the group) on as many accumulator
+//                              groups as fit next to the source, up to 8, so
+//                              the rate is throughput and not latency
+//
+// Every instruction runs at VLMAX except the last strip of a memory pass.
+
+// Strided and indexed fp32 accesses of a register group (indexed loads are
+// RvvGather in rvv_spmm.h)
+template <int LMUL> struct RvvRoofline;
+
+#define MATMUL_RVV_ROOFLINE(LMUL, GROUP)                                       \
+  template <> struct RvvRoofline<LMUL> {                                       \
+    using vec = vfloat32##GROUP##_t;                                           \
+    static vec load_strided(const float *p, ptrdiff_t stride, size_t vl) {     \
+      return __riscv_vlse32_v_f32##GROUP(p, stride, vl);                       \
+    }                                                                          \
+    static void store_strided(float *p, ptrdiff_t stride, vec v, size_t vl) {  \
+      __riscv_vsse32_v_f32##GROUP(p, stride, v, vl);                           \
+    }                                                                          \
+    static void store_indexed(float *p, typename RvvIndex<LMUL>::vec offsets, \
+                              vec v, size_t vl) {                              \
+      __riscv_vsuxei32_v_f32##GROUP(p, offsets, v, vl);                        \
+    }                                                                          \
+  };
+
+MATMUL_RVV_ROOFLINE(1, m1)
+MATMUL_RVV_ROOFLINE(2, m2)
+MATMUL_RVV_ROOFLINE(4, m4)
+MATMUL_RVV_ROOFLINE(8, m8)
+
+#undef MATMUL_RVV_ROOFLINE
+
+// Access patterns, as RooflineAccess in roofline.h
+enum RvvRooflineAccess { RVV_ROOFLINE_UNIT, RVV_ROOFLINE_STRIDED,
+                         RVV_ROOFLINE_INDEXED };
+
+// Element i is buf[i] (unit), buf[i * stride] (strided) or the float at byte
+// offsets[i] of buf (indexed). Returns the sum of everything read.
+template <int LMUL>
+float rvv_roofline_load(const float *buf, size_t n, int access, size_t stride,
+                        const uint32_t *offsets, int passes) {
+  using Ops = RvvTypes<float, LMUL>;
+  const ptrdiff_t byte_stride = ptrdiff_t(stride * sizeof(float));
+  const size_t vlmax = Ops::setvl(n);
+  typename Ops::vec sum = Ops::splat(0.0f, vlmax);
+
+  for (int pass = 0; pass < passes; ++pass) {
+    for (size_t i = 0; i < n;) {
+      size_t vl = Ops::setvl(n - i);
+      typename Ops::vec v;
+      if (access == RVV_ROOFLINE_UNIT)
+        v = Ops::load(buf + i, vl);
+      else if (access == RVV_ROOFLINE_STRIDED)
+        v = RvvRoofline<LMUL>::load_strided(buf + i * stride, byte_stride, vl);
+      else
+        v = RvvGather<float, LMUL>::load(
+            buf,
+            RvvIndex<LMUL>::load(reinterpret_cast<const int32_t *>(offsets + i),
+                                 vl),
+            vl);
+      sum = __riscv_vfadd_tu(sum, sum, v, vl);
+      i += vl;
+    }
+  }
+
+  auto total = __riscv_vfredusum(sum, __riscv_vfmv_v_f_f32m1(0.0f, 1), vlmax);
+  return __riscv_vfmv_f(total);
+}
+
+// Write the elements of rvv_roofline_load, the pass number in each
+template <int LMUL>
+void rvv_roofline_store(float *buf, size_t n, int access, size_t stride,
+                        const uint32_t *offsets, int passes) {
+  using Ops = RvvTypes<float, LMUL>;
+  const ptrdiff_t byte_stride = ptrdiff_t(stride * sizeof(float));
+
+  for (int pass = 0; pass < passes; ++pass) {
+    typename Ops::vec v = Ops::splat(float(pass), Ops::setvl(n));
+    for (size_t i = 0; i < n;) {
+      size_t vl = Ops::setvl(n - i);
+      if (access == RVV_ROOFLINE_UNIT)
+        Ops::store(buf + i, v, vl);
+      else if (access == RVV_ROOFLINE_STRIDED)
+        RvvRoofline<LMUL>::store_strided(buf + i * stride, byte_stride, v, vl);
+      else
+        RvvRoofline<LMUL>::store_indexed(
+            buf,
+            RvvIndex<LMUL>::load(reinterpret_cast<const int32_t *>(offsets + i),
+                                 vl),
+            v, vl);
+      i += vl;
+    }
+  }
+}
+
+// Signed integer type of twice the width of T (vwmacc accumulators)
+template <typename T>
+using rvv_wide_t = std::conditional_t<
+    sizeof(T) == 1, int16_t,
+    std::conditional_t<sizeof(T) == 2, int32_t, int64_t>>;
+
+// iterations rounds of acc += x * v on each accumulator group. Returns the
+// multiply-accumulates performed; lane 0 of the sum of the accumulators goes
+// to sink.
+template <typename T, int LMUL, bool Widen>
+uint64_t rvv_roofline_macs(long iterations, volatile double &sink) {
+  using Acc = std::conditional_t<Widen, rvv_wide_t<T>, T>;
+  constexpr int ACC_LMUL = Widen ? 2 * LMUL : LMUL;
+  using SrcOps = RvvTypes<T, LMUL>;
+  using AccOps = RvvTypes<Acc, ACC_LMUL>;
+  // Accumulator groups that fit in 32 registers next to the source
+  constexpr int N = std::min(8, (32 - LMUL) / ACC_LMUL);
+
+  const size_t vl = SrcOps::setvl(SIZE_MAX);
+  const typename SrcOps::vec v = SrcOps::splat(T(1), vl);
+  const T x = T(1);
+  typename AccOps::vec c0 = AccOps::splat(Acc(0), vl);
+  typename AccOps::vec c1 = c0, c2 = c0, c3 = c0, c4 = c0, c5 = c0, c6 = c0,
+                       c7 = c0;
+
+  auto mac = [&](typename AccOps::vec acc) {
+    if constexpr (Widen)
+      return __riscv_vwmacc(acc, x, v, vl);
+    else
+      return rvv_madd(acc, x, v, vl);
+  };
+  for (long it = 0; it < iterations; ++it) {
+    c0 = mac(c0);
+    if constexpr (N > 1)
+      c1 = mac(c1);
+    if constexpr (N > 2)
+      c2 = mac(c2);
+    if constexpr (N > 3)
+      c3 = mac(c3);
+    if constexpr (N > 4)
+      c4 = mac(c4);
+    if constexpr (N > 5)
+      c5 = mac(c5);
+    if constexpr (N > 6)
+      c6 = mac(c6);
+    if constexpr (N > 7)
+      c7 = mac(c7);
+  }
+
+  auto add = [&](typename AccOps::vec a, typename AccOps::vec b) {
+    if constexpr (std::is_floating_point_v<Acc>)
+      return __riscv_vfadd(a, b, vl);
+    else
+      return __riscv_vadd(a, b, vl);
+  };
+  if constexpr (N > 1)
+    c0 = add(c0, c1);
+  if constexpr (N > 2)
+    c0 = add(c0, c2);
+  if constexpr (N > 3)
+    c0 = add(c0, c3);
+  if constexpr (N > 4)
+    c0 = add(c0, c4);
+  if constexpr (N > 5)
+    c0 = add(c0, c5);
+  if constexpr (N > 6)
+    c0 = add(c0, c6);
+  if constexpr (N > 7)
+    c0 = add(c0, c7);
+  Acc lane;
+  AccOps::store(&lane, c0, 1);
+  sink = double(lane);
+  return uint64_t(iterations) * N * vl;
+}
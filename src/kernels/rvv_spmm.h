@@ -0,0 +1,162 @@
+#pragma once
+
+#include "rvv_matmul.h"
+
+// Sparse x dense kernels (see src/hpp/sparse.h) on the rvv_matmul.h
+// building blocks, templated on element type, accumulator type, LMUL of the
+// accumulators and the sparse row format.
+//
+//   rvv_spmm<T, Acc, LMUL>  C[i][:] += A[i][p] * B[p][:], a strip of B row
+//                           per nonzero, saturated once per strip of C
+//   rvv_spmv<T, Acc, LMUL>  y[i] = sum A[i][p] * x[col(p)], a strip of
+//                           nonzeros per step, x gathered with vluxei32 into
+//                           a tail-undisturbed accumulator reduced per row
+//
+// The row formats give the nonzero range of a row and its columns, either
+// one scalar at a time or as a u32 vector for the gather. Column indices
+// are 32-bit, one per accumulator lane, so Acc is a 32-bit type.
+
+// u32 index groups and the u8 groups of the same element count
+template <int LMUL> struct RvvIndex;
+
+#define MATMUL_RVV_INDEX(LMUL, GROUP, BYTE_GROUP)                              \
+  template <> struct RvvIndex<LMUL> {                                          \
+    using vec = vuint32##GROUP##_t;                                            \
+    static vec load(const int32_t *p, size_t vl) {                             \
+      return __riscv_vle32_v_u32##GROUP(reinterpret_cast<const uint32_t *>(p), \
+                                        vl);                                   \
+    }                                                                          \
+    static vec iota(size_t vl) { return __riscv_vid_v_u32##GROUP(vl); }        \
+    static vec load_bytes(const uint8_t *p, size_t vl) {                       \
+      return __riscv_vzext_vf4(__riscv_vle8_v_u8##BYTE_GROUP(p, vl), vl);      \
+    }                                                                          \
+  };
+
+MATMUL_RVV_INDEX(1, m1, mf4)
+MATMUL_RVV_INDEX(2, m2, mf2)
+MATMUL_RVV_INDEX(4, m4, m1)
+MATMUL_RVV_INDEX(8, m8, m2)
+
+#undef MATMUL_RVV_INDEX
+
+// Indexed (gather) loads of T through a u32 index group of LMUL registers
+template <typename T, int LMUL> struct RvvGather;
+
+#define MATMUL_RVV_GATHER(T, LMUL, TYPE_GROUP)                                 \
+  template <> struct RvvGather<T, LMUL> {                                      \
+    static auto load(const T *base, typename RvvIndex<LMUL>::vec offsets,     \
+                     size_t vl) {                                              \
+      return __riscv_vluxei32_v_##TYPE_GROUP(base, offsets, vl);               \
+    }                                                                          \
+  };
+
+MATMUL_RVV_GATHER(float, 1, f32m1)
+MATMUL_RVV_GATHER(float, 2, f32m2)
+MATMUL_RVV_GATHER(float, 4, f32m4)
+MATMUL_RVV_GATHER(float, 8, f32m8)
+MATMUL_RVV_GATHER(int8_t, 4, i8m1)
+MATMUL_RVV_GATHER(int8_t, 8, i8m2)
+
+#undef MATMUL_RVV_GATHER
+
+// CSR rows: nonzeros [row_ptr[i], row_ptr[i + 1]) at columns col_idx[p]
+struct RvvCsrRows {
+  const int32_t *row_ptr;
+  const int32_t *col_idx;
+
+  size_t begin(int i) const { return size_t(row_ptr[i]); }
+  size_t end(int i) const { return size_t(row_ptr[i + 1]); }
+  size_t column(int, size_t p) const { return size_t(col_idx[p]); }
+
+  template <int LMUL>
+  typename RvvIndex<LMUL>::vec columns(int, size_t p, size_t vl) const {
+    return RvvIndex<LMUL>::load(col_idx + p, vl);
+  }
+};
+
+// 2:4 rows: row_length slots per row, slot s of a row at column
+// (s / 2) * 4 + pos[slot]
+struct Rvv24Rows {
+  const uint8_t *pos;
+  size_t row_length;
+
+  size_t begin(int i) const { return size_t(i) * row_length; }
+  size_t end(int i) const { return begin(i) + row_length; }
+  size_t column(int i, size_t p) const {
+    return (p - begin(i)) / 2 * 4 + pos[p];
+  }
+
+  template <int LMUL>
+  typename RvvIndex<LMUL>::vec columns(int i, size_t p, size_t vl) const {
+    auto slot = __riscv_vadd(RvvIndex<LMUL>::iota(vl),
+                             uint32_t(p - begin(i)), vl);
+    auto group = __riscv_vsll(__riscv_vsrl(slot, 1, vl), 2, vl);
+    return __riscv_vadd(group, RvvIndex<LMUL>::load_bytes(pos + p, vl), vl);
+  }
+};
+
+template <typename T, typename Acc, int LMUL, typename Rows>
+void rvv_spmm(const Rows &rows, const T *values, const T *b, T *c, int a_rows,
+              int b_cols, Acc lo, Acc hi, int vlen) {
+  constexpr int in_lmul = int(LMUL * sizeof(T) / sizeof(Acc));
+  using AccOps = RvvTypes<Acc, LMUL>;
+  using InOps = RvvTypes<T, in_lmul>;
+
+  for (int i = 0; i < a_rows; ++i) {
+    const size_t begin = rows.begin(i), end = rows.end(i);
+    T *c_row = c + size_t(i) * b_cols;
+    size_t vl = 0;
+    for (int j = 0; j < b_cols; j += int(vl)) {
+      size_t strip = size_t(b_cols - j);
+      if (vlen > 0)
+        strip = std::min(strip, size_t(vlen));
+      vl = AccOps::setvl(strip);
+
+      typename AccOps::vec acc = AccOps::splat(Acc(0), vl);
+      for (size_t p = begin; p < end; ++p) {
+        const T *b_row = b + rows.column(i, p) * size_t(b_cols) + j;
+        acc = rvv_madd(acc, Acc(values[p]),
+                       rvv_widen<T, Acc>(InOps::load(b_row, vl), vl), vl);
+      }
+      rvv_store_row<T, Acc, LMUL>(c_row + j, acc, lo, hi, vl);
+    }
+  }
+}
+
+template <typename T, typename Acc, int LMUL, typename Rows>
+void rvv_spmv(const Rows &rows, const T *values, const T *x, T *y, int a_rows,
+              Acc lo, Acc hi) {
+  static_assert(sizeof(Acc) == 4, "column indices are one u32 per lane");
+  constexpr int in_lmul = int(LMUL * sizeof(T) / sizeof(Acc));
+  using AccOps = RvvTypes<Acc, LMUL>;
+  using InOps = RvvTypes<T, in_lmul>;
+  const size_t vlmax = AccOps::setvl(size_t(-1));
+  const auto zero = RvvTypes<Acc, 1>::splat(Acc(0), 1);
+
+  for (int i = 0; i < a_rows; ++i) {
+    const size_t begin = rows.begin(i), end = rows.end(i);
+    typename AccOps::vec acc = AccOps::splat(Acc(0), vlmax);
+    size_t vl = 0;
+    for (size_t p = begin; p < end; p += vl) {
+      vl = AccOps::setvl(end - p);
+      auto offsets = rows.template columns<LMUL>(i, p, vl);
+      if constexpr (sizeof(T) > 1)
+        offsets = __riscv_vsll(offsets, sizeof(T) == 2 ? 1 : 2, vl);
+      auto xs = rvv_widen<T, Acc>(RvvGather<T, LMUL>::load(x, offsets, vl), vl);
+      auto vs = rvv_widen<T, Acc>(InOps::load(values + p, vl), vl);
+      if constexpr (std::is_floating_point_v<Acc>)
+        acc = __riscv_vfmacc_tu(acc, vs, xs, vl);
+      else
+        acc = __riscv_vmacc_tu(acc, vs, xs, vl);
+    }
+
+    Acc sum;
+    if constexpr (std::is_floating_point_v<Acc>) {
+      sum = __riscv_vfmv_f(__riscv_vfredusum(acc, zero, vlmax));
+    } else {
+      sum = __riscv_vmv_x(__riscv_vredsum(acc, zero, vlmax));
+      sum = std::clamp(sum, lo, hi);
+    }
+    y[i] = T(sum);
+  }
+}
@@ -0,0 +1,425 @@
+// Portable C++ definitions of the assembly entry points, linked instead of
+// src/asm when the library is built for the host (MATMUL_HOST_BUILD). Each
+// function keeps the contract documented in its .S counterpart, so every C++
+// driver above it (blocked, skinny, Strassen, batched, quantized) runs
+// unchanged on non-RISC-V machines. Vector-length and clamp-frequency hints
+// have no meaning here and are ignored. The naive kernels are shared with the
+// RISC-V build (src/kernels/matmul_naive.cpp).
+//
+// The vendor-extension kernels (IME, Zvfh, Zvfbfwma) have no stand-in: their
+// MATMUL_HAVE_* macros are never defined for host builds.
+
+#include "cpp_blocked.h"
+#include "int4.h"
+#include "quant.h"
+#include "roofline.h"
+#include "sparse.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// C[0:mr][0:nr] += Apanel(kc x 4) * Bpanel(kc x nr_pack), as the
+// matmul_blocked_*.S micro-kernels
+template <typename T, typename AccumulatorType>
+void portable_ukernel(const T *a_pack, const T *b_pack, AccumulatorType *c,
+                      int kc, int mr, int nr, int ldc, int nr_pack) {
+  for (int p = 0; p < kc; ++p) {
+    const T *a_col = a_pack + size_t(p) * 4;
+    const T *b_row = b_pack + size_t(p) * nr_pack;
+    for (int r = 0; r < mr; ++r) {
+      AccumulatorType *c_row = c + size_t(r) * ldc;
+      const AccumulatorType a_rp = AccumulatorType(a_col[r]);
+      for (int j = 0; j < nr; ++j)
+        c_row[j] += a_rp * AccumulatorType(b_row[j]);
+    }
+  }
+}
+
+// C = A * B through the portable engine, accumulating wide and saturating
+// once into [int_min, int_max] (the contract of the naive and vector kernels)
+template <typename T>
+void portable_matmul(const T *a, const T *b, T *c, int a_rows, int a_cols,
+                     int b_cols, int int_min, int int_max) {
+  using AccumulatorType = accumulator_t<T>;
+  if constexpr (std::is_same_v<AccumulatorType, T>) {
+    matmul_cpp_blocked(a, b, c, a_rows, a_cols, b_cols);
+  } else {
+    const size_t size = size_t(a_rows) * b_cols;
+    auto acc = make_aligned_buffer<AccumulatorType>(size);
+    gemm_cpp_blocked<T, AccumulatorType>(
+        false, false, a_rows, b_cols, a_cols, T(1), a, std::max(1, a_cols), b,
+        std::max(1, b_cols), T(0), acc.get(), std::max(1, b_cols));
+    for (size_t i = 0; i < size; ++i)
+      c[i] = T(std::clamp<AccumulatorType>(acc[i], int_min, int_max));
+  }
+}
+
+// C (a_rows x b_cols) = A * Bt^T, one dot product per element, as the
+// matmul_skinny_*.S kernels
+template <typename T>
+void portable_skinny(const T *a, const T *bt, T *c, int a_rows, int a_cols,
+                     int b_cols, int int_min, int int_max) {
+  using AccumulatorType = accumulator_t<T>;
+  for (int i = 0; i < a_rows; ++i) {
+    const T *a_row = a + size_t(i) * a_cols;
+    for (int j = 0; j < b_cols; ++j) {
+      const T *bt_row = bt + size_t(j) * a_cols;
+      AccumulatorType sum = 0;
+      for (int p = 0; p < a_cols; ++p)
+        sum += AccumulatorType(a_row[p]) * AccumulatorType(bt_row[p]);
+      if constexpr (std::is_integral_v<T>)
+        sum = std::clamp<AccumulatorType>(sum, int_min, int_max);
+      c[size_t(i) * b_cols + j] = T(sum);
+    }
+  }
+}
+
+// C = A * B over the nonzeros of a sparse A, as the kernels of matmul_sparse.cpp;
+// column(i, p) maps slot p of row i to its column
+template <typename T, typename Column>
+void portable_spmm(const T *values, size_t row_length, const int32_t *row_ptr,
+                   Column column, const T *b, T *c, int a_rows, int b_cols,
+                   int int_min, int int_max) {
+  using AccumulatorType = accumulator_t<T>;
+  std::vector<AccumulatorType> row(b_cols);
+  for (int i = 0; i < a_rows; ++i) {
+    std::fill(row.begin(), row.end(), AccumulatorType(0));
+    const size_t begin = row_ptr ? size_t(row_ptr[i]) : size_t(i) * row_length;
+    const size_t end = row_ptr ? size_t(row_ptr[i + 1]) : begin + row_length;
+    for (size_t p = begin; p < end; ++p) {
+      const AccumulatorType v = AccumulatorType(values[p]);
+      const T *b_row = b + column(i, p) * size_t(b_cols);
+      for (int j = 0; j < b_cols; ++j)
+        row[j] += v * AccumulatorType(b_row[j]);
+    }
+    for (int j = 0; j < b_cols; ++j) {
+      AccumulatorType sum = row[j];
+      if constexpr (std::is_integral_v<T>)
+        sum = std::clamp<AccumulatorType>(sum, int_min, int_max);
+      c[size_t(i) * b_cols + j] = T(sum);
+    }
+  }
+}
+
+// C = A * dequant(Q) for int4 weights packed in row pairs, as the kernels of
+// matmul_int4.cpp: int8 activations sum each group in int32 and fold it in
+// with a fused multiply-add of the column scale, then apply the row scale;
+// float activations multiply-add each dequantized weight
+template <typename A>
+void portable_int4(const A *a, int lda, const float *a_scale, const uint8_t *b,
+                   const float *scales, float *c, int ldc, int a_rows,
+                   int a_cols, int b_cols, int group_size) {
+  auto weight = [&](int p, int j) {
+    uint8_t byte = b[size_t(p / 2) * b_cols + j];
+    int nibble = p % 2 ? byte >> 4 : byte & 0xF;
+    return nibble >= 8 ? nibble - 16 : nibble;
+  };
+  for (int i = 0; i < a_rows; ++i) {
+    const A *a_row = a + size_t(i) * lda;
+    for (int j = 0; j < b_cols; ++j) {
+      float acc = 0.0f;
+      for (int g0 = 0; g0 < a_cols; g0 += group_size) {
+        const int g1 = std::min(a_cols, g0 + group_size);
+        const float scale = scales[size_t(g0 / group_size) * b_cols + j];
+        if constexpr (std::is_same_v<A, int8_t>) {
+          int32_t sum = 0;
+          for (int p = g0; p < g1; ++p)
+            sum += int32_t(a_row[p]) * weight(p, j);
+          acc = std::fma(scale, float(sum), acc);
+        } else {
+          for (int p = g0; p < g1; ++p)
+            acc = std::fma(a_row[p], float(weight(p, j)) * scale, acc);
+        }
+      }
+      if constexpr (std::is_same_v<A, int8_t>)
+        acc *= a_scale[i];
+      c[size_t(i) * ldc + j] = acc;
+    }
+  }
+}
+
+// Sum of the n elements of a roofline access pattern, four at a time
+template <typename Element>
+float portable_roofline_sum(size_t n, int passes, Element element) {
+  float sum[4] = {};
+  for (int pass = 0; pass < passes; ++pass) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      for (int l = 0; l < 4; ++l)
+        sum[l] += element(i + l);
+    for (; i < n; ++i)
+      sum[0] += element(i);
+  }
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+volatile double portable_roofline_sink;
+
+// Scalar multiply-accumulates on 8 independent accumulators, as the vector
+// ones of rvv_roofline.h. Scalar registers have no narrow lanes, so every
+// integer SEW accumulates in 32 bits (64 for vwmacc of e32), wrapping as in
+// the vector unit (unsigned); the empty asm keeps the compiler from folding the integer loop
+// into a closed form.
+template <typename Acc> uint64_t portable_roofline_macs(long iterations) {
+  Acc acc[8] = {};
+  const Acc x = Acc(1), v = Acc(1);
+  for (long it = 0; it < iterations; ++it)
+    for (Acc &a : acc) {
+      a = Acc(a + x * v);
+      if constexpr (std::is_integral_v<Acc>)
+        asm volatile("" : "+r"(a));
+    }
+  Acc total = Acc(0);
+  for (Acc a : acc)
+    total = Acc(total + a);
+  portable_roofline_sink = double(total);
+  return uint64_t(iterations) * 8;
+}
+
+} // namespace
+
+extern "C" {
+
+void matmul_asm_ukernel_float(const float *a_pack, const float *b_pack,
+                              float *c, int kc, int mr, int nr, int ldc,
+                              int nr_pack) {
+  portable_ukernel(a_pack, b_pack, c, kc, mr, nr, ldc, nr_pack);
+}
+
+void matmul_asm_ukernel_int8(const int8_t *a_pack, const int8_t *b_pack,
+                             int32_t *c, int kc, int mr, int nr, int ldc,
+                             int nr_pack) {
+  portable_ukernel(a_pack, b_pack, c, kc, mr, nr, ldc, nr_pack);
+}
+
+void matmul_asm_ukernel_int16(const int16_t *a_pack, const int16_t *b_pack,
+                              int32_t *c, int kc, int mr, int nr, int ldc,
+                              int nr_pack) {
+  portable_ukernel(a_pack, b_pack, c, kc, mr, nr, ldc, nr_pack);
+}
+
+void matmul_asm_ukernel_int32(const int32_t *a_pack, const int32_t *b_pack,
+                              int64_t *c, int kc, int mr, int nr, int ldc,
+                              int nr_pack) {
+  portable_ukernel(a_pack, b_pack, c, kc, mr, nr, ldc, nr_pack);
+}
+
+void matmul_asm_vector_float(const float *a, const float *b, float *c,
+                             int a_rows, int a_cols, int b_cols, int, int) {
+  portable_matmul(a, b, c, a_rows, a_cols, b_cols, 0, 0);
+}
+
+void matmul_asm_vector_int8(const int8_t *a, const int8_t *b, int8_t *c,
+                            int a_rows, int a_cols, int b_cols, int int_min,
+                            int int_max, int, int) {
+  portable_matmul(a, b, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_vector_int16(const int16_t *a, const int16_t *b, int16_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max, int, int) {
+  portable_matmul(a, b, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_vector_int32(const int32_t *a, const int32_t *b, int32_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max, int, int) {
+  portable_matmul(a, b, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_skinny_float(const float *a, const float *bt, float *c,
+                             int a_rows, int a_cols, int b_cols) {
+  portable_skinny(a, bt, c, a_rows, a_cols, b_cols, 0, 0);
+}
+
+void matmul_asm_skinny_int8(const int8_t *a, const int8_t *bt, int8_t *c,
+                            int a_rows, int a_cols, int b_cols, int int_min,
+                            int int_max) {
+  portable_skinny(a, bt, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_skinny_int16(const int16_t *a, const int16_t *bt, int16_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max) {
+  portable_skinny(a, bt, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+void matmul_asm_skinny_int32(const int32_t *a, const int32_t *bt, int32_t *c,
+                             int a_rows, int a_cols, int b_cols, int int_min,
+                             int int_max) {
+  portable_skinny(a, bt, c, a_rows, a_cols, b_cols, int_min, int_max);
+}
+
+// Same epilogue as matmul_vector_int8_requant.S:
+//   q = clamp(round(float(acc + col_offset[j] + row_offset[i]) * scale[j]),
+//             out_min - zp, out_max - zp) + zp
+void matmul_asm_vector_int8_requant(const int8_t *a, const int8_t *b, void *c,
+                                    int a_rows, int a_cols, int b_cols,
+                                    const QuantEpilogue *ep, int) {
+  const size_t size = size_t(a_rows) * b_cols;
+  std::unique_ptr<int32_t[], AlignedFree> buffer;
+  int32_t *acc = static_cast<int32_t *>(c);
+  if (ep) {
+    buffer = make_aligned_buffer<int32_t>(size);
+    acc = buffer.get();
+  }
+  gemm_cpp_blocked<int8_t, int32_t>(false, false, a_rows, b_cols, a_cols, 1, a,
+                                    std::max(1, a_cols), b,
+                                    std::max(1, b_cols), 0, acc,
+                                    std::max(1, b_cols));
+  if (!ep)
+    return;
+
+  uint8_t *out = static_cast<uint8_t *>(c);
+  const char *scales = reinterpret_cast<const char *>(ep->scale);
+  const float lo = float(ep->out_min - ep->out_zero_point);
+  const float hi = float(ep->out_max - ep->out_zero_point);
+  for (int i = 0; i < a_rows; ++i) {
+    for (int j = 0; j < b_cols; ++j) {
+      int32_t sum = acc[size_t(i) * b_cols + j];
+      if (ep->col_offset)
+        sum += ep->col_offset[j];
+      if (ep->row_offset)
+        sum += ep->row_offset[i];
+      float scale;
+      std::memcpy(&scale, scales + size_t(j) * ep->scale_stride,
+                  sizeof(scale));
+      float q = std::clamp(std::nearbyint(float(sum) * scale), lo, hi);
+      out[size_t(i) * b_cols + j] = uint8_t(int32_t(q) + ep->out_zero_point);
+    }
+  }
+}
+
+void matmul_asm_spmm_csr_float(const int32_t *row_ptr, const int32_t *col_idx,
+                               const float *values, const float *b, float *c,
+                               int a_rows, int b_cols, int) {
+  portable_spmm(values, 0, row_ptr,
+                [&](int, size_t p) { return size_t(col_idx[p]); }, b, c,
+                a_rows, b_cols, 0, 0);
+}
+
+void matmul_asm_spmm_csr_int8(const int32_t *row_ptr, const int32_t *col_idx,
+                              const int8_t *values, const int8_t *b, int8_t *c,
+                              int a_rows, int b_cols, int int_min, int int_max,
+                              int) {
+  portable_spmm(values, 0, row_ptr,
+                [&](int, size_t p) { return size_t(col_idx[p]); }, b, c,
+                a_rows, b_cols, int_min, int_max);
+}
+
+void matmul_asm_spmm_24_float(const float *values, const uint8_t *pos,
+                              const float *b, float *c, int a_rows,
+                              int a_cols, int b_cols, int) {
+  const size_t len = Sparse24Matrix<float>::row_length(a_cols);
+  portable_spmm(values, len, nullptr,
+                [&](int i, size_t p) { return (p - i * len) / 2 * 4 + pos[p]; },
+                b, c, a_rows, b_cols, 0, 0);
+}
+
+void matmul_asm_spmm_24_int8(const int8_t *values, const uint8_t *pos,
+                             const int8_t *b, int8_t *c, int a_rows,
+                             int a_cols, int b_cols, int int_min, int int_max,
+                             int) {
+  const size_t len = Sparse24Matrix<int8_t>::row_length(a_cols);
+  portable_spmm(values, len, nullptr,
+                [&](int i, size_t p) { return (p - i * len) / 2 * 4 + pos[p]; },
+                b, c, a_rows, b_cols, int_min, int_max);
+}
+
+void matmul_asm_spmv_csr_float(const int32_t *row_ptr, const int32_t *col_idx,
+                               const float *values, const float *x, float *y,
+                               int a_rows) {
+  matmul_asm_spmm_csr_float(row_ptr, col_idx, values, x, y, a_rows, 1, 0);
+}
+
+void matmul_asm_spmv_csr_int8(const int32_t *row_ptr, const int32_t *col_idx,
+                              const int8_t *values, const int8_t *x, int8_t *y,
+                              int a_rows, int int_min, int int_max) {
+  matmul_asm_spmm_csr_int8(row_ptr, col_idx, values, x, y, a_rows, 1, int_min,
+                           int_max, 0);
+}
+
+void matmul_asm_spmv_24_float(const float *values, const uint8_t *pos,
+                              const float *x, float *y, int a_rows,
+                              int a_cols) {
+  matmul_asm_spmm_24_float(values, pos, x, y, a_rows, a_cols, 1, 0);
+}
+
+void matmul_asm_spmv_24_int8(const int8_t *values, const uint8_t *pos,
+                             const int8_t *x, int8_t *y, int a_rows,
+                             int a_cols, int int_min, int int_max) {
+  matmul_asm_spmm_24_int8(values, pos, x, y, a_rows, a_cols, 1, int_min,
+                          int_max, 0);
+}
+
+void matmul_asm_int4_int8(const int8_t *a, int lda, const float *a_scale,
+                          const uint8_t *b, const float *scales, float *c,
+                          int ldc, int a_rows, int a_cols, int b_cols,
+                          int group_size, int) {
+  portable_int4(a, lda, a_scale, b, scales, c, ldc, a_rows, a_cols, b_cols,
+                group_size);
+}
+
+void matmul_asm_int4_float(const float *a, int lda, const uint8_t *b,
+                           const float *scales, float *c, int ldc, int a_rows,
+                           int a_cols, int b_cols, int group_size, int) {
+  portable_int4(a, lda, nullptr, b, scales, c, ldc, a_rows, a_cols, b_cols,
+                group_size);
+}
+
+// Scalar loops with no register groups: lmul is ignored
+float matmul_roofline_load(const float *buf, size_t n, int access,
+                           size_t stride, const uint32_t *offsets, int,
+                           int passes) {
+  if (access == 0)
+    return portable_roofline_sum(n, passes, [&](size_t i) { return buf[i]; });
+  if (access == 1)
+    return portable_roofline_sum(n, passes,
+                                 [&](size_t i) { return buf[i * stride]; });
+  return portable_roofline_sum(n, passes, [&](size_t i) {
+    return buf[offsets[i] / sizeof(float)];
+  });
+}
+
+void matmul_roofline_store(float *buf, size_t n, int access, size_t stride,
+                           const uint32_t *offsets, int, int passes) {
+  for (int pass = 0; pass < passes; ++pass) {
+    const float value = float(pass);
+    if (access == 0)
+      std::fill(buf, buf + n, value);
+    else if (access == 1)
+      for (size_t i = 0; i < n; ++i)
+        buf[i * stride] = value;
+    else
+      for (size_t i = 0; i < n; ++i)
+        buf[offsets[i] / sizeof(float)] = value;
+    // Each pass must reach memory, not only the last
+    asm volatile("" : : "r"(buf) : "memory");
+  }
+}
+
+uint64_t matmul_roofline_macs(int op, int sew, int lmul, long iterations) {
+  if (lmul != 1)
+    return 0;
+  switch (op) {
+  case 0: // vfmacc
+    return sew == 32 ? portable_roofline_macs<float>(iterations) : 0;
+  case 1: // vmacc
+    return sew == 8 || sew == 16 || sew == 32
+               ? portable_roofline_macs<uint32_t>(iterations)
+               : 0;
+  case 2: // vwmacc
+    if (sew == 8 || sew == 16)
+      return portable_roofline_macs<uint32_t>(iterations);
+    return sew == 32 ? portable_roofline_macs<uint64_t>(iterations) : 0;
+  }
+  return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,75 @@
+#include "batched.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Small shapes take the single-block path, the larger ones the per-item
+// kernels
+const std::tuple<int, int, int> kShapes[] = {
+    {1, 1, 1}, {4, 7, 5}, {13, 17, 19}, {70, 9, 300}};
+
+template <typename T> void check_strided(bool shared_b) {
+  const int batch = 11;
+  for (const auto &[m, n, k] : kShapes) {
+    SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                 std::to_string(k) + (shared_b ? " shared B" : ""));
+    const size_t stride_a = size_t(m) * k;
+    const size_t stride_b = shared_b ? 0 : size_t(k) * n;
+    const size_t stride_c = size_t(m) * n;
+    Matrix<T> a = random_matrix<T>(batch, stride_a, unsigned(m));
+    Matrix<T> b = random_matrix<T>(shared_b ? 1 : batch, size_t(k) * n,
+                                   unsigned(n));
+    Matrix<T> c(batch, stride_c);
+    matmul_batched(batch, m, n, k, a.data(), stride_a, b.data(), stride_b,
+                   c.data(), stride_c);
+
+    for (int i = 0; i < batch; ++i) {
+      Matrix<T> expected(m, n);
+      gemm_cpp_naive(Transpose::No, Transpose::No, m, n, k, T(1),
+                     a.data() + i * stride_a, k, b.data() + i * stride_b, n,
+                     T(0), expected.data(), n);
+      Matrix<T> actual(m, n);
+      std::copy_n(c.data() + i * stride_c, stride_c, actual.data());
+      expect_matrix_near(expected, actual, sum_epsilon(k));
+    }
+  }
+}
+
+} // namespace
+
+TEST(BatchedTest, StridedFloat) { check_strided<float>(false); }
+TEST(BatchedTest, StridedInt8) { check_strided<int8_t>(false); }
+TEST(BatchedTest, SharedBFloat) { check_strided<float>(true); }
+TEST(BatchedTest, SharedBInt16) { check_strided<int16_t>(true); }
+
+TEST(BatchedTest, PointerArray) {
+  const int batch = 5, m = 6, n = 9, k = 7;
+  std::vector<Matrix<int32_t>> as, bs, cs;
+  for (int i = 0; i < batch; ++i) {
+    as.push_back(random_matrix<int32_t>(m, k, unsigned(2 * i)));
+    bs.push_back(random_matrix<int32_t>(k, n, unsigned(2 * i + 1)));
+    cs.emplace_back(m, n);
+  }
+  std::vector<const int32_t *> a_ptrs, b_ptrs;
+  std::vector<int32_t *> c_ptrs;
+  for (int i = 0; i < batch; ++i) {
+    a_ptrs.push_back(as[i].data());
+    b_ptrs.push_back(bs[i].data());
+    c_ptrs.push_back(cs[i].data());
+  }
+  matmul_batched(batch, m, n, k, a_ptrs.data(), b_ptrs.data(), c_ptrs.data());
+
+  for (int i = 0; i < batch; ++i)
+    expect_matrix_near(matmul(as[i], bs[i], MatMulImpl::CPP_NAIVE), cs[i]);
+}
+
+TEST(BatchedTest, RejectsOverlappingStrides) {
+  std::vector<float> a(12), b(12), c(16);
+  EXPECT_THROW(matmul_batched(2, 2, 2, 3, a.data(), 5, b.data(), 6, c.data(),
+                              4),
+               std::invalid_argument);
+}
@@ -0,0 +1,48 @@
+#include "blocked.h"
+#include "matmul.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <tuple>
+
+namespace {
+
+// M x N x K shapes: single elements, sizes that are not multiples of the
+// micro-kernel, and a deep K for the integer accumulators
+const std::tuple<size_t, size_t, size_t> kShapes[] = {
+    {1, 1, 1}, {1, 33, 17}, {33, 1, 17}, {7, 9, 13}, {37, 29, 41},
+    {64, 65, 63}, {9, 40, 300}};
+
+// matmul_blocked against the naive product, with the default blocking and
+// with blocks small enough that M, N and K each span several of them
+template <typename T> void check_blocked() {
+  for (const auto &[m, n, k] : kShapes) {
+    SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                 std::to_string(k));
+    Matrix<T> a = random_matrix<T>(m, k, unsigned(m + k));
+    Matrix<T> b = random_matrix<T>(k, n, unsigned(k + n));
+    Matrix<T> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+
+    expect_matrix_near(expected, matmul(a, b, MatMulImpl::ASM_BLOCKED),
+                       sum_epsilon(k));
+    for (BlockSizes bs : {BlockSizes{8, 16, 16}, BlockSizes{4, 5, 16}}) {
+      Matrix<T> c(m, n);
+      matmul_blocked(a.data(), b.data(), c.data(), int(m), int(k), int(n), bs);
+      expect_matrix_near(expected, c, sum_epsilon(k));
+    }
+  }
+}
+
+} // namespace
+
+TEST(BlockedTest, Float) { check_blocked<float>(); }
+TEST(BlockedTest, Int8) { check_blocked<int8_t>(); }
+TEST(BlockedTest, Int16) { check_blocked<int16_t>(); }
+TEST(BlockedTest, Int32) { check_blocked<int32_t>(); }
+
+TEST(BlockedTest, EmptyDepthGivesZeros) {
+  Matrix<int8_t> a(5, 0), b(0, 7), c(5, 7);
+  c.fill(1);
+  matmul_blocked(a.data(), b.data(), c.data(), 5, 0, 7);
+  expect_matrix_near(Matrix<int8_t>(5, 7), c);
+}
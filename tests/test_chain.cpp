@@ -0,0 +1,44 @@
+#include "chain.h"
+#include "matmul.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+// Chains against repeated naive products, left to right
+TEST(MatMulChainTest, MatchesLeftToRight) {
+  const std::vector<size_t> dims = {5, 1, 9, 3, 17, 7};
+  std::vector<Matrix<float>> mats;
+  for (size_t i = 0; i + 1 < dims.size(); ++i)
+    mats.push_back(random_matrix<float>(dims[i], dims[i + 1], unsigned(i)));
+
+  Matrix<float> expected = mats[0];
+  for (size_t i = 1; i < mats.size(); ++i)
+    expected = matmul(expected, mats[i], MatMulImpl::CPP_NAIVE);
+
+  ChainPlan<float>::Operands operands(mats.begin(), mats.end());
+  for (MatMulImpl impl : {MatMulImpl::CPP_NAIVE, MatMulImpl::ASM_BLOCKED,
+                          MatMulImpl::AUTO}) {
+    SCOPED_TRACE(getImplName(impl));
+    expect_matrix_near(expected, matmul_chain<float>(operands, impl), 1e-4);
+
+    ChainPlan<float> plan(ChainPlan<float>::dims_of(operands), impl);
+    Matrix<float> result(dims.front(), dims.back());
+    plan.run(operands, result);
+    plan.run(operands, result); // plans are reusable
+    expect_matrix_near(expected, result, 1e-4);
+  }
+}
+
+TEST(MatMulChainTest, SingleOperandIsCopied) {
+  Matrix<int32_t> only = random_matrix<int32_t>(3, 4, 7);
+  ChainPlan<int32_t>::Operands operands = {only};
+  expect_matrix_near(only, matmul_chain<int32_t>(operands));
+}
+
+TEST(MatMulChainTest, MismatchedOperandsThrow) {
+  Matrix<float> a(2, 3), b(4, 5);
+  ChainPlan<float>::Operands operands = {a, b};
+  EXPECT_THROW(matmul_chain<float>(operands), std::invalid_argument);
+  EXPECT_THROW(matmul_chain<float>({}), std::invalid_argument);
+}
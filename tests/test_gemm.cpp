@@ -0,0 +1,77 @@
+#include "matmul.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace {
+
+const std::tuple<size_t, size_t, size_t> kShapes[] = {
+    {1, 1, 1}, {1, 33, 17}, {33, 1, 17}, {7, 9, 13}, {37, 29, 41}};
+
+// gemm against gemm_cpp_naive: every transpose, alpha / beta and leading
+// dimensions wider than the operands
+template <typename T> void check_gemm(T alpha, T beta) {
+  unsigned seed = 1;
+  for (const auto &[m, n, k] : kShapes)
+    for (bool trans_a : {false, true})
+      for (bool trans_b : {false, true}) {
+        SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                     std::to_string(k) + (trans_a ? " A^T" : "") +
+                     (trans_b ? " B^T" : ""));
+        const Transpose ta = trans_a ? Transpose::Yes : Transpose::No;
+        const Transpose tb = trans_b ? Transpose::Yes : Transpose::No;
+        const size_t a_rows = trans_a ? k : m, a_cols = trans_a ? m : k;
+        const size_t b_rows = trans_b ? n : k, b_cols = trans_b ? k : n;
+        Matrix<T> a = random_matrix<T>(a_rows, a_cols + 3, seed++);
+        Matrix<T> b = random_matrix<T>(b_rows, b_cols + 1, seed++);
+        Matrix<T> expected = random_matrix<T>(m, n + 2, seed++);
+        Matrix<T> actual = expected;
+
+        gemm_cpp_naive(ta, tb, int(m), int(n), int(k), alpha, a.data(),
+                       int(a.cols()), b.data(), int(b.cols()), beta,
+                       expected.data(), int(expected.cols()));
+        gemm(ta, tb, int(m), int(n), int(k), alpha, a.data(), int(a.cols()),
+             b.data(), int(b.cols()), beta, actual.data(),
+             int(actual.cols()));
+        expect_matrix_near(expected, actual, sum_epsilon(k));
+      }
+}
+
+} // namespace
+
+TEST(GemmTest, Float) { check_gemm<float>(1.5f, 0.5f); }
+TEST(GemmTest, Int8) { check_gemm<int8_t>(2, 1); }
+TEST(GemmTest, Int32) { check_gemm<int32_t>(3, -1); }
+
+TEST(GemmTest, BetaZeroDoesNotReadC) {
+  Matrix<float> a = random_matrix<float>(6, 5, 1);
+  Matrix<float> b = random_matrix<float>(5, 7, 2);
+  Matrix<float> c(6, 7);
+  c.fill(std::numeric_limits<float>::quiet_NaN());
+  gemm(Transpose::No, Transpose::No, 1.0f, a.view(), b.view(), 0.0f,
+       c.view());
+  expect_matrix_near(matmul(a, b, MatMulImpl::CPP_NAIVE), c, sum_epsilon(5));
+}
+
+TEST(GemmTest, SubBlockViews) {
+  Matrix<int16_t> a = random_matrix<int16_t>(9, 12, 3);
+  Matrix<int16_t> b = random_matrix<int16_t>(10, 8, 4);
+  Matrix<int16_t> c(7, 9), expected(7, 9);
+  auto a_block = a.view().block(1, 2, 5, 6);
+  auto b_block = b.view().block(3, 1, 6, 4);
+  gemm(Transpose::No, Transpose::No, int16_t(1), a_block, b_block,
+       int16_t(0), c.view().block(2, 3, 5, 4));
+  gemm(Transpose::No, Transpose::No, int16_t(1), a_block, b_block,
+       int16_t(0), expected.view().block(2, 3, 5, 4), MatMulImpl::CPP_NAIVE);
+  expect_matrix_near(expected, c);
+}
+
+TEST(GemmTest, RejectsShortLeadingDimension) {
+  Matrix<float> a(4, 3), b(3, 5), c(4, 5);
+  EXPECT_THROW(gemm(Transpose::No, Transpose::No, 4, 5, 3, 1.0f, a.data(), 2,
+                    b.data(), 5, 0.0f, c.data(), 5),
+               std::invalid_argument);
+}
@@ -0,0 +1,24 @@
+#include "matmul.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <tuple>
+
+// ASM_IME (or its RVV fallback) against the naive product: shapes inside one
+// 4 x 16 block, and M, N and K that are not multiples of the 4 x 8 A tiles and
+// 8 x 4 B tiles, with results saturating to int8
+TEST(ImeTest, MatchesNaive) {
+  for (const auto &[m, n, k] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                {4, 16, 8},
+                                {5, 17, 9},
+                                {3, 4, 40},
+                                {37, 29, 41},
+                                {64, 65, 63}}) {
+    SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                 std::to_string(k));
+    Matrix<int8_t> a = random_matrix<int8_t>(m, k, unsigned(m + k));
+    Matrix<int8_t> b = random_matrix<int8_t>(k, n, unsigned(k + n));
+    expect_matrix_near(matmul(a, b, MatMulImpl::CPP_NAIVE),
+                       matmul(a, b, MatMulImpl::ASM_IME));
+  }
+}
@@ -0,0 +1,93 @@
+#include "int4.h"
+#include "matmul.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Tolerance of an int4 product against its dequantized reference: both
+// multiply the same fp32 values, in a different order
+double int4_epsilon(size_t k) { return 1e-5 * double(k + 1); }
+
+} // namespace
+
+TEST(Int4Test, QuantizeWithinHalfAStep) {
+  Matrix<float> w = random_matrix<float>(37, 11, 1);
+  for (int group : {2, 8, 32, 64}) {
+    Int4Matrix q = Int4Matrix::quantize(w, group);
+    EXPECT_EQ(q.rows(), 37u);
+    EXPECT_EQ(q.cols(), 11u);
+    EXPECT_EQ(q.num_groups(), (37u + group - 1) / group);
+    Matrix<float> back = q.dequantize();
+    for (size_t p = 0; p < w.rows(); ++p)
+      for (size_t j = 0; j < w.cols(); ++j) {
+        ASSERT_GE(q.value(p, j), -8);
+        ASSERT_LE(q.value(p, j), 7);
+        ASSERT_LE(std::fabs(w.at(p, j) - back.at(p, j)),
+                  0.5f * q.scale(p / group, j) + 1e-6f);
+      }
+  }
+}
+
+TEST(Int4Test, InvalidGroupSizeThrows) {
+  Matrix<float> w(4, 4);
+  EXPECT_THROW(Int4Matrix::quantize(w, 3), std::invalid_argument);
+  EXPECT_THROW(Int4Matrix::quantize(w, 0), std::invalid_argument);
+}
+
+TEST(Int4Test, FloatActivationsMatchReference) {
+  for (auto [m, n, k, group] :
+       {std::tuple<size_t, size_t, size_t, int>{1, 1, 2, 2},
+        {1, 64, 128, 32},
+        {7, 33, 37, 8},
+        {16, 17, 64, 64},
+        {3, 5, 0, 32}}) {
+    SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                 std::to_string(k) + " group " + std::to_string(group));
+    Matrix<float> a = random_matrix<float>(m, k, unsigned(m));
+    Int4Matrix b =
+        Int4Matrix::quantize(random_matrix<float>(k, n, unsigned(n)), group);
+    expect_matrix_near(matmul_int4_cpp_naive(a, b), matmul_int4(a, b),
+                       int4_epsilon(k));
+  }
+}
+
+TEST(Int4Test, Int8ActivationsMatchReference) {
+  for (auto [m, n, k, group] :
+       {std::tuple<size_t, size_t, size_t, int>{1, 40, 64, 32},
+        {9, 19, 45, 16},
+        {4, 8, 2, 2}}) {
+    SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                 std::to_string(k) + " group " + std::to_string(group));
+    Matrix<float> a = random_matrix<float>(m, k, unsigned(m + 1));
+    Matrix<int8_t> qa(m, k);
+    std::vector<float> scales = quantize_activations(a, qa);
+    Int4Matrix b =
+        Int4Matrix::quantize(random_matrix<float>(k, n, unsigned(n)), group);
+
+    expect_matrix_near(matmul_int4_cpp_naive(qa, scales, b),
+                       matmul_int4(qa, scales, b), int4_epsilon(k));
+    const std::vector<float> one_scale = {0.25f};
+    expect_matrix_near(matmul_int4_cpp_naive(qa, one_scale, b),
+                       matmul_int4(qa, one_scale, b), int4_epsilon(k));
+  }
+}
+
+TEST(Int4Test, EmptyActivations) {
+  Int4Matrix b = Int4Matrix::quantize(random_matrix<float>(8, 4, 1), 8);
+  Matrix<int8_t> a(0, 8);
+  EXPECT_EQ(matmul_int4(a, {}, b).rows(), 0u);
+  EXPECT_EQ(matmul_int4(a, {1.0f}, b).rows(), 0u);
+  EXPECT_EQ(matmul_int4(Matrix<float>(0, 8), b).rows(), 0u);
+}
+
+TEST(Int4Test, ShapeMismatchThrows) {
+  Int4Matrix b = Int4Matrix::quantize(random_matrix<float>(8, 4, 1), 8);
+  EXPECT_THROW(matmul_int4(Matrix<float>(2, 6), b), std::invalid_argument);
+  Matrix<int8_t> a(3, 8);
+  EXPECT_THROW(matmul_int4(a, {1.0f, 2.0f}, b), std::invalid_argument);
+}
@@ -1,119 +1,127 @@
-// #include <gtest/gtest.h>
-// #include "matrix.h"
-// #include "matmul.h"
-
-// // Testing for float type
-// class MatMulFloatTest : public ::testing::Test {
-// protected:
-//     void SetUp() override {
-//         // Create test matrices
-//         a = Matrix<float>(3, 2);
-//         b = Matrix<float>(2, 4);
-        
-//         // Initialize with known values
-//         a.at(0, 0) = 1.0f; a.at(0, 1) = 2.0f;
-//         a.at(1, 0) = 3.0f; a.at(1, 1) = 4.0f;
-//         a.at(2, 0) = 5.0f; a.at(2, 1) = 6.0f;
-        
-//         b.at(0, 0) = 7.0f; b.at(0, 1) = 8.0f; b.at(0, 2) = 9.0f; b.at(0, 3) = 10.0f;
-//         b.at(1, 0) = 11.0f; b.at(1, 1) = 12.0f; b.at(1, 2) = 13.0f; b.at(1, 3) = 14.0f;
-//     }
-    
-//     Matrix<float> a;
-//     Matrix<float> b;
-// };
-
-// TEST_F(MatMulFloatTest, CPPNaiveImplementation) {
-//     Matrix<float> c = matmul(a, b, MatMulImpl::CPP_NAIVE);
-    
-//     EXPECT_EQ(c.rows(), 3);
-//     EXPECT_EQ(c.cols(), 4);
-    
-//     // Expected results calculated by hand
-//     EXPECT_FLOAT_EQ(c.at(0, 0), 29.0f);  // 1*7 + 2*11
-//     EXPECT_FLOAT_EQ(c.at(0, 1), 32.0f);  // 1*8 + 2*12
-//     EXPECT_FLOAT_EQ(c.at(0, 2), 35.0f);  // 1*9 + 2*13
-//     EXPECT_FLOAT_EQ(c.at(0, 3), 38.0f);  // 1*10 + 2*14
-    
-//     EXPECT_FLOAT_EQ(c.at(1, 0), 65.0f);  // 3*7 + 4*11
-//     EXPECT_FLOAT_EQ(c.at(1, 1), 72.0f);  // 3*8 + 4*12
-//     EXPECT_FLOAT_EQ(c.at(1, 2), 79.0f);  // 3*9 + 4*13
-//     EXPECT_FLOAT_EQ(c.at(1, 3), 86.0f);  // 3*10 + 4*14
-    
-//     EXPECT_FLOAT_EQ(c.at(2, 0), 101.0f); // 5*7 + 6*11
-//     EXPECT_FLOAT_EQ(c.at(2, 1), 112.0f); // 5*8 + 6*12
-//     EXPECT_FLOAT_EQ(c.at(2, 2), 123.0f); // 5*9 + 6*13
-//     EXPECT_FLOAT_EQ(c.at(2, 3), 134.0f); // 5*10 + 6*14
-// }
-
-// TEST_F(MatMulFloatTest, AsmNaiveImplementation) {
-//     Matrix<float> c_cpp = matmul(a, b, MatMulImpl::CPP_NAIVE);
-//     Matrix<float> c_asm = matmul(a, b, MatMulImpl::ASM_NAIVE);
-    
-//     EXPECT_TRUE(c_cpp.equals(c_asm));
-// }
-
-// TEST_F(MatMulFloatTest, AsmVectorImplementation) {
-//     Matrix<float> c_cpp = matmul(a, b, MatMulImpl::CPP_NAIVE);
-//     Matrix<float> c_asm = matmul(a, b, MatMulImpl::ASM_VECTOR);
-    
-//     EXPECT_TRUE(c_cpp.equals(c_asm));
-// }
-
-// // Testing for int32_t type
-// class MatMulInt32Test : public ::testing::Test {
-// protected:
-//     void SetUp() override {
-//         // Create test matrices
-//         a = Matrix<int32_t>(3, 2);
-//         b = Matrix<int32_t>(2, 4);
-        
-//         // Initialize with known values
-//         a.at(0, 0) = 1; a.at(0, 1) = 2;
-//         a.at(1, 0) = 3; a.at(1, 1) = 4;
-//         a.at(2, 0) = 5; a.at(2, 1) = 6;
-        
-//         b.at(0, 0) = 7; b.at(0, 1) = 8; b.at(0, 2) = 9; b.at(0, 3) = 10;
-//         b.at(1, 0) = 11; b.at(1, 1) = 12; b.at(1, 2) = 13; b.at(1, 3) = 14;
-//     }
-    
-//     Matrix<int32_t> a;
-//     Matrix<int32_t> b;
-// };
-
-// TEST_F(MatMulInt32Test, CPPNaiveImplementation) {
-//     Matrix<int32_t> c = matmul(a, b, MatMulImpl::CPP_NAIVE);
-    
-//     EXPECT_EQ(c.rows(), 3);
-//     EXPECT_EQ(c.cols(), 4);
-    
-//     // Expected results calculated by hand
-//     EXPECT_EQ(c.at(0, 0), 29);  // 1*7 + 2*11
-//     EXPECT_EQ(c.at(0, 1), 32);  // 1*8 + 2*12
-//     EXPECT_EQ(c.at(0, 2), 35);  // 1*9 + 2*13
-//     EXPECT_EQ(c.at(0, 3), 38);  // 1*10 + 2*14
-    
-//     EXPECT_EQ(c.at(1, 0), 65);  // 3*7 + 4*11
-//     EXPECT_EQ(c.at(1, 1), 72);  // 3*8 + 4*12
-//     EXPECT_EQ(c.at(1, 2), 79);  // 3*9 + 4*13
-//     EXPECT_EQ(c.at(1, 3), 86);  // 3*10 + 4*14
-    
-//     EXPECT_EQ(c.at(2, 0), 101); // 5*7 + 6*11
-//     EXPECT_EQ(c.at(2, 1), 112); // 5*8 + 6*12
-//     EXPECT_EQ(c.at(2, 2), 123); // 5*9 + 6*13
-//     EXPECT_EQ(c.at(2, 3), 134); // 5*10 + 6*14
-// }
-
-// TEST_F(MatMulInt32Test, AsmNaiveImplementation) {
-//     Matrix<int32_t> c_cpp = matmul(a, b, MatMulImpl::CPP_NAIVE);
-//     Matrix<int32_t> c_asm = matmul(a, b, MatMulImpl::ASM_NAIVE);
-    
-//     EXPECT_TRUE(c_cpp.equals(c_asm));
-// }
-
-// TEST_F(MatMulInt32Test, AsmVectorImplementation) {
-//     Matrix<int32_t> c_cpp = matmul(a, b, MatMulImpl::CPP_NAIVE);
-//     Matrix<int32_t> c_asm = matmul(a, b, MatMulImpl::ASM_VECTOR);
-    
-//     EXPECT_TRUE(c_cpp.equals(c_asm));
-// }
\ No newline at end of file
+#include "bench.h"
+#include "matmul.h"
+#include "matrix.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace {
+
+const MatMulImpl kImpls[] = {
+    MatMulImpl::CPP_BLOCKED, MatMulImpl::ASM_NAIVE,   MatMulImpl::ASM_VECTOR,
+    MatMulImpl::ASM_BLOCKED, MatMulImpl::ASM_IME,     MatMulImpl::ASM_STRASSEN,
+    MatMulImpl::AUTO};
+
+// M x N x K shapes, including the edges: no inner dimension, single rows
+// and columns, and sizes that are not multiples of any micro-kernel
+const std::tuple<size_t, size_t, size_t> kShapes[] = {
+    {5, 7, 0}, {1, 1, 1}, {1, 33, 17}, {33, 1, 17}, {1, 64, 1},
+    {7, 9, 13}, {16, 16, 16}, {37, 29, 41}, {64, 65, 63}};
+
+template <typename T> void check_impls_against_naive() {
+  unsigned seed = 1;
+  for (const auto &[m, n, k] : kShapes) {
+    Matrix<T> a = random_matrix<T>(m, k, seed++);
+    Matrix<T> b = random_matrix<T>(k, n, seed++);
+    Matrix<T> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+    for (MatMulImpl impl : kImpls) {
+      SCOPED_TRACE(getImplName(impl) + " " + std::to_string(m) + "x" +
+                   std::to_string(n) + "x" + std::to_string(k));
+      expect_matrix_near(expected, matmul(a, b, impl),
+                         double(verify_epsilon<T>(m, n, k, impl)));
+    }
+  }
+}
+
+} // namespace
+
+// Testing for float type
+class MatMulFloatTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    a = Matrix<float>(3, 2, {1, 2, 3, 4, 5, 6});
+    b = Matrix<float>(2, 4, {7, 8, 9, 10, 11, 12, 13, 14});
+  }
+
+  Matrix<float> a{0, 0};
+  Matrix<float> b{0, 0};
+};
+
+TEST_F(MatMulFloatTest, CPPNaiveImplementation) {
+  Matrix<float> c = matmul(a, b, MatMulImpl::CPP_NAIVE);
+
+  EXPECT_EQ(c.rows(), 3u);
+  EXPECT_EQ(c.cols(), 4u);
+
+  // Expected results calculated by hand
+  const float expected[3][4] = {{29, 32, 35, 38},    // 1*7 + 2*11, ...
+                                {65, 72, 79, 86},    // 3*7 + 4*11, ...
+                                {101, 112, 123, 134}}; // 5*7 + 6*11, ...
+  for (size_t i = 0; i < 3; ++i)
+    for (size_t j = 0; j < 4; ++j)
+      EXPECT_FLOAT_EQ(c.at(i, j), expected[i][j]);
+}
+
+TEST_F(MatMulFloatTest, EveryImplementationMatchesNaive) {
+  Matrix<float> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+  for (MatMulImpl impl : kImpls)
+    EXPECT_TRUE(expected.equals(matmul(a, b, impl))) << getImplName(impl);
+}
+
+TEST(MatMulTest, DimensionMismatchThrows) {
+  Matrix<float> a(3, 2), b(3, 4);
+  EXPECT_THROW(matmul(a, b), std::invalid_argument);
+}
+
+TEST(MatMulTest, FloatShapes) { check_impls_against_naive<float>(); }
+TEST(MatMulTest, Int8Shapes) { check_impls_against_naive<int8_t>(); }
+TEST(MatMulTest, Int16Shapes) { check_impls_against_naive<int16_t>(); }
+TEST(MatMulTest, Int32Shapes) { check_impls_against_naive<int32_t>(); }
+
+TEST(MatMulTest, EmptyInnerDimensionGivesZeros) {
+  Matrix<float> a(4, 0), b(0, 6);
+  for (MatMulImpl impl : kImpls) {
+    Matrix<float> c(4, 6);
+    c.fill(1.0f);
+    matmul(a, b, c, impl);
+    expect_matrix_near(Matrix<float>(4, 6), c);
+  }
+}
+
+// gemm_cpp_blocked against gemm_cpp_naive: every transpose, alpha / beta and
+// leading dimensions wider than the operands
+template <typename T> void check_gemm_cpp_blocked(T alpha, T beta) {
+  unsigned seed = 100;
+  for (const auto &[m, n, k] : kShapes)
+    for (bool trans_a : {false, true})
+      for (bool trans_b : {false, true}) {
+        SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                     std::to_string(k) + (trans_a ? " A^T" : "") +
+                     (trans_b ? " B^T" : ""));
+        const size_t a_rows = trans_a ? k : m, a_cols = trans_a ? m : k;
+        const size_t b_rows = trans_b ? n : k, b_cols = trans_b ? k : n;
+        Matrix<T> a = random_matrix<T>(a_rows, a_cols + 3, seed++);
+        Matrix<T> b = random_matrix<T>(b_rows, b_cols + 1, seed++);
+        Matrix<T> expected = random_matrix<T>(m, n + 2, seed++);
+        Matrix<T> actual = expected;
+
+        gemm_cpp_naive(trans_a ? Transpose::Yes : Transpose::No,
+                       trans_b ? Transpose::Yes : Transpose::No, int(m),
+                       int(n), int(k), alpha, a.data(), int(a.cols()),
+                       b.data(), int(b.cols()), beta, expected.data(),
+                       int(expected.cols()));
+        gemm_cpp_blocked(trans_a, trans_b, int(m), int(n), int(k), alpha,
+                         a.data(), int(a.cols()), b.data(), int(b.cols()),
+                         beta, actual.data(), int(actual.cols()));
+        expect_matrix_near(expected, actual, double(verify_epsilon<T>(k)));
+      }
+}
+
+TEST(GemmCppBlockedTest, Float) { check_gemm_cpp_blocked<float>(1.5f, 0.5f); }
+TEST(GemmCppBlockedTest, FloatBetaZero) {
+  check_gemm_cpp_blocked<float>(1.0f, 0.0f);
+}
+TEST(GemmCppBlockedTest, Int8) { check_gemm_cpp_blocked<int8_t>(2, 1); }
+TEST(GemmCppBlockedTest, Int32) { check_gemm_cpp_blocked<int32_t>(3, -1); }
@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "matmul.h"
+#include "matrix_file.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+TEST(MappedMatrixTest, RoundTripsPaddedMatrix) {
+  TempFile file("padded.mat");
+  Matrix<float> saved = Matrix<float>::padded(7, 5);
+  std::mt19937 gen(1);
+  saved.randomize(gen);
+  save_matrix(file.path(), saved);
+
+  MappedMatrix<float> mapped(file.path());
+  EXPECT_EQ(mapped.rows(), 7u);
+  EXPECT_EQ(mapped.cols(), 5u);
+  EXPECT_EQ(mapped.stride(), saved.stride());
+  EXPECT_EQ(mapped.layout(), MatrixFileLayout::RowMajor);
+  expect_matrix_near(saved, mapped.to_matrix());
+
+  // Mapped operands multiply in place
+  Matrix<float> a = random_matrix<float>(3, 7, 2);
+  Matrix<float> expected = matmul(a, saved, MatMulImpl::CPP_NAIVE);
+  for (MatMulImpl impl : {MatMulImpl::CPP_NAIVE, MatMulImpl::ASM_BLOCKED}) {
+    Matrix<float> c(3, 5);
+    matmul(a.view(), mapped.view(), c.view(), impl);
+    expect_matrix_near(expected, c, double(verify_epsilon<float>(7)));
+  }
+}
+
+TEST(MappedMatrixTest, EmptyMatrix) {
+  TempFile file("empty.mat");
+  save_matrix(file.path(), Matrix<int8_t>(0, 4));
+  MappedMatrix<int8_t> mapped(file.path());
+  EXPECT_EQ(mapped.rows(), 0u);
+  EXPECT_EQ(mapped.cols(), 4u);
+}
+
+TEST(MappedMatrixTest, RejectsWrongTypeAndCorruptData) {
+  TempFile file("corrupt.mat");
+  save_matrix(file.path(), random_matrix<int32_t>(4, 4, 3));
+  EXPECT_THROW(MappedMatrix<float>{file.path()}, std::runtime_error);
+
+  {
+    std::fstream f(file.path(), std::ios::in | std::ios::out |
+                                    std::ios::binary | std::ios::ate);
+    f.seekp(-1, std::ios::end);
+    f.put('\x7f');
+  }
+  EXPECT_THROW(MappedMatrix<int32_t>{file.path()}, std::runtime_error);
+  MappedMatrix<int32_t> unchecked(file.path(), false);
+  EXPECT_EQ(unchecked.rows(), 4u);
+
+  EXPECT_THROW(MappedMatrix<int32_t>{file.path() + ".missing"},
+               std::runtime_error);
+}
+
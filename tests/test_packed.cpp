@@ -0,0 +1,65 @@
+#include "bench.h"
+#include "matmul.h"
+#include "matrix_file.h"
+#include "packed.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+// PackedMatrix against the naive product, and bit for bit against the
+// blocked driver it shares micro-kernels with
+template <typename T> void check_packed(size_t m, size_t n, size_t k) {
+  SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+               std::to_string(k));
+  Matrix<T> a = random_matrix<T>(m, k, unsigned(m));
+  Matrix<T> b = random_matrix<T>(k, n, unsigned(n));
+  PackedMatrix<T> packed(b);
+  EXPECT_EQ(packed.rows(), k);
+  EXPECT_EQ(packed.cols(), n);
+  expect_matrix_near(matmul(a, b, MatMulImpl::CPP_NAIVE), matmul(a, packed),
+                     double(verify_epsilon<T>(k)));
+  expect_matrix_near(matmul(a, b, MatMulImpl::ASM_BLOCKED), matmul(a, packed));
+}
+
+TEST(PackedMatrixTest, MatchesNaive) {
+  for (auto [m, n, k] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                         {1, 40, 33},
+                         {37, 29, 41},
+                         {64, 65, 300},
+                         {5, 7, 0}}) {
+    check_packed<float>(m, n, k);
+    check_packed<int8_t>(m, n, k);
+    check_packed<int32_t>(m, n, k);
+  }
+}
+
+TEST(PackedMatrixTest, SmallBlocksSpanSeveralPanels) {
+  Matrix<float> a = random_matrix<float>(9, 50, 1);
+  Matrix<float> b = random_matrix<float>(50, 70, 2);
+  PackedMatrix<float> packed(b, MatMulImpl::ASM_BLOCKED, BlockSizes{8, 16, 16});
+  expect_matrix_near(matmul(a, b, MatMulImpl::CPP_NAIVE), matmul(a, packed),
+                     double(verify_epsilon<float>(50)));
+}
+
+TEST(PackedMatrixTest, FileRoundTrip) {
+  TempFile file("packed.mat");
+  Matrix<int8_t> a = random_matrix<int8_t>(13, 45, 3);
+  Matrix<int8_t> b = random_matrix<int8_t>(45, 19, 4);
+  PackedMatrix<int8_t> packed(b);
+  save_packed_matrix(file.path(), packed);
+
+  PackedMatrix<int8_t> loaded{MappedMatrix<int8_t>(file.path())};
+  EXPECT_EQ(loaded.layout(), packed.layout());
+  EXPECT_EQ(loaded.kc(), packed.kc());
+  EXPECT_EQ(loaded.nc(), packed.nc());
+  expect_matrix_near(matmul(a, packed), matmul(a, loaded));
+
+  // A row-major file is not packed
+  TempFile plain("plain.mat");
+  save_matrix(plain.path(), b);
+  EXPECT_THROW(PackedMatrix<int8_t>{MappedMatrix<int8_t>(plain.path())},
+               std::runtime_error);
+}
+
@@ -0,0 +1,38 @@
+#include "matmul.h"
+#include "test_util.h"
+#include "thread_pool.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <tuple>
+
+namespace {
+
+// Shapes cut into row tiles, and short ones that are split into column
+// tiles as well (at four threads, fewer than 16 row tiles and N >= 32)
+const std::tuple<size_t, size_t, size_t> kShapes[] = {
+    {1, 1, 1}, {8, 100, 33}, {5, 70, 9}, {3, 47, 1}, {64, 65, 63}};
+
+template <typename T> void check_parallel() {
+  ThreadPool &pool = ThreadPool::instance();
+  const int threads = pool.num_threads();
+  pool.set_num_threads(4);
+  for (const auto &[m, n, k] : kShapes) {
+    Matrix<T> a = random_matrix<T>(m, k, unsigned(m + k));
+    Matrix<T> b = random_matrix<T>(k, n, unsigned(k + n));
+    Matrix<T> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+    for (MatMulImpl impl : {MatMulImpl::ASM_NAIVE, MatMulImpl::ASM_VECTOR,
+                            MatMulImpl::ASM_BLOCKED}) {
+      SCOPED_TRACE(getImplName(impl) + " " + std::to_string(m) + "x" +
+                   std::to_string(n) + "x" + std::to_string(k));
+      expect_matrix_near(expected, matmul_parallel(a, b, impl),
+                         sum_epsilon(k));
+    }
+  }
+  pool.set_num_threads(threads);
+}
+
+} // namespace
+
+TEST(ParallelTest, Float) { check_parallel<float>(); }
+TEST(ParallelTest, Int8) { check_parallel<int8_t>(); }
+TEST(ParallelTest, Int32) { check_parallel<int32_t>(); }
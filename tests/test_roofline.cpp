@@ -0,0 +1,106 @@
+#include "roofline.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+std::string temp_path(const std::string &name) {
+  return (std::filesystem::temp_directory_path() /
+          ("matmul_test_" + std::to_string(::getpid()) + "_" + name))
+      .string();
+}
+
+RooflineCeilings sample_ceilings() {
+  RooflineCeilings ceilings;
+  ceilings.set({"load", "unit", 32, 1, 16 << 10}, 40.0);
+  ceilings.set({"load", "unit", 32, 4, 16 << 10}, 64.0);
+  ceilings.set({"load", "unit", 32, 1, 64 << 20}, 8.0);
+  ceilings.set({"load", "strided", 32, 1, 64 << 20}, 1.5);
+  ceilings.set({"store", "indexed", 32, 2, 4 << 20}, 0.75);
+  ceilings.set({"compute", "vfmacc", 32, 4, 0}, 16.0);
+  ceilings.set({"compute", "vmacc", 8, 8, 0}, 128.0);
+  ceilings.set({"compute", "vwmacc", 8, 2, 0}, 96.0);
+  ceilings.set({"compute", "vwmacc", 16, 2, 0}, 48.0);
+  ceilings.set({"compute", "vwmacc", 32, 4, 0}, 24.0);
+  ceilings.set({"compute", "vmadot", 8, 1, 0}, 512.0);
+  return ceilings;
+}
+
+void expect_same_entries(const RooflineCeilings &expected,
+                         const RooflineCeilings &actual) {
+  ASSERT_EQ(expected.entries().size(), actual.entries().size());
+  auto e = expected.entries().begin();
+  for (const auto &entry : actual.entries()) {
+    EXPECT_FALSE(entry.first < e->first || e->first < entry.first)
+        << entry.first.kind << " " << entry.first.name;
+    EXPECT_DOUBLE_EQ(entry.second, e->second);
+    ++e;
+  }
+}
+
+} // namespace
+
+TEST(RooflineTest, SaveLoadRoundTrip) {
+  const std::string path = temp_path("roofline/ceilings.txt");
+  RooflineCeilings saved = sample_ceilings();
+  saved.save(path); // creates the directory
+
+  RooflineCeilings loaded;
+  ASSERT_TRUE(loaded.load(path));
+  expect_same_entries(saved, loaded);
+  std::filesystem::remove_all(std::filesystem::path(path).parent_path());
+}
+
+TEST(RooflineTest, LoadMergesAndReportsMissingFiles) {
+  const std::string path = temp_path("merge.txt");
+  RooflineCeilings part;
+  part.set({"compute", "vfmacc", 32, 4, 0}, 20.0);
+  part.save(path);
+
+  RooflineCeilings ceilings = sample_ceilings();
+  ASSERT_TRUE(ceilings.load(path));
+  EXPECT_EQ(ceilings.entries().size(), sample_ceilings().entries().size());
+  EXPECT_DOUBLE_EQ(ceilings.peak_gflops("float"), 20.0);
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(ceilings.load(path));
+}
+
+TEST(RooflineTest, MalformedLineThrows) {
+  const std::string path = temp_path("malformed.txt");
+  std::ofstream(path) << "# comment\n\nload unit 32 1\n";
+  RooflineCeilings ceilings;
+  EXPECT_THROW(ceilings.load(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(RooflineTest, PeaksUseTheAccumulatingInstruction) {
+  RooflineCeilings ceilings = sample_ceilings();
+  // vmacc and vwmacc of e8 sources are faster, but no kernel uses them
+  EXPECT_DOUBLE_EQ(ceilings.peak_gflops("float"), 16.0);
+  EXPECT_DOUBLE_EQ(ceilings.peak_gflops("int8"), 48.0);
+  EXPECT_DOUBLE_EQ(ceilings.peak_gflops("int16"), 48.0);
+  EXPECT_DOUBLE_EQ(ceilings.peak_gflops("int32"), 24.0);
+  EXPECT_DOUBLE_EQ(ceilings.peak_gflops("int8", true), 512.0);
+  EXPECT_DOUBLE_EQ(RooflineCeilings().peak_gflops("float"), 0.0);
+}
+
+TEST(RooflineTest, AttainableIsTheLowerCeiling) {
+  RooflineCeilings ceilings = sample_ceilings();
+  EXPECT_DOUBLE_EQ(ceilings.bandwidth_gbps(1000), 64.0);
+  EXPECT_DOUBLE_EQ(ceilings.bandwidth_gbps(1 << 20), 8.0);
+  EXPECT_DOUBLE_EQ(ceilings.bandwidth_gbps(1e12), 8.0);
+
+  // Memory bound: 1 FLOP/B at 8 GB/s; compute bound at 16 GFLOP/s a core
+  EXPECT_DOUBLE_EQ(ceilings.attainable_gflops("float", 1e8, 1e8), 8.0);
+  EXPECT_DOUBLE_EQ(ceilings.attainable_gflops("float", 1e10, 1e8), 16.0);
+  EXPECT_DOUBLE_EQ(ceilings.attainable_gflops("float", 1e10, 1e8, false, 2),
+                   32.0);
+  EXPECT_DOUBLE_EQ(ceilings.percent_of_peak("float", 1e10, 1e8, 8.0), 50.0);
+  EXPECT_DOUBLE_EQ(RooflineCeilings().percent_of_peak("float", 1, 1, 1), -1.0);
+}
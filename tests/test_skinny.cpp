@@ -0,0 +1,44 @@
+#include "matmul.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <tuple>
+
+namespace {
+
+// Every C width up to SkinnyShape::max_cols and one past it, the shortest
+// routed depth, K not a multiple of the vector length and a deep K
+const std::tuple<size_t, size_t, size_t> kShapes[] = {
+    {1, 1, 16},   {9, 1, 17},  {5, 2, 33},   {3, 3, 100}, {8, 4, 64},
+    {2, 5, 129},  {7, 6, 31},  {4, 7, 250},  {6, 8, 77},  {5, 9, 40},
+    {1, 8, 16},   {3, 1, 15},  {2, 3, 4000}, {40, 8, 1000}};
+
+template <typename T> void check_skinny() {
+  unsigned seed = 1;
+  for (const auto &[m, n, k] : kShapes) {
+    SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+                 std::to_string(k));
+    Matrix<T> a = random_matrix<T>(m, k, seed++);
+    Matrix<T> b = random_matrix<T>(k, n, seed++);
+    Matrix<T> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+    for (MatMulImpl impl : {MatMulImpl::ASM_VECTOR, MatMulImpl::ASM_BLOCKED}) {
+      SCOPED_TRACE(getImplKey(impl));
+      expect_matrix_near(expected, matmul(a, b, impl), sum_epsilon(k));
+    }
+  }
+}
+
+} // namespace
+
+TEST(SkinnyTest, Float) { check_skinny<float>(); }
+TEST(SkinnyTest, Int8) { check_skinny<int8_t>(); }
+TEST(SkinnyTest, Int16) { check_skinny<int16_t>(); }
+TEST(SkinnyTest, Int32) { check_skinny<int32_t>(); }
+
+TEST(SkinnyTest, Routing) {
+  EXPECT_TRUE(skinny_shape(1, 16, 1));
+  EXPECT_TRUE(skinny_shape(100, 4000, 8));
+  EXPECT_FALSE(skinny_shape(100, 4000, 9));
+  EXPECT_FALSE(skinny_shape(100, 15, 4));
+  EXPECT_FALSE(skinny_shape(0, 100, 4));
+}
@@ -0,0 +1,105 @@
+#include "bench.h"
+#include "matmul.h"
+#include "sparse.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// Random matrix with about a third of the entries kept, and rows 0, 3 and
+// the last one entirely zero
+template <typename T>
+Matrix<T> random_sparse(size_t rows, size_t cols, unsigned seed) {
+  Matrix<T> m = random_matrix<T>(rows, cols, seed);
+  std::mt19937 gen(seed + 1);
+  std::bernoulli_distribution keep(1.0 / 3.0);
+  for (size_t i = 0; i < rows; ++i)
+    for (size_t j = 0; j < cols; ++j)
+      if (i == 0 || i == 3 || i + 1 == rows || !keep(gen))
+        m.at(i, j) = T(0);
+  return m;
+}
+
+// spmm (n > 1) and spmv (n == 1) against the naive product of the dense
+// equivalent, for A with k columns (not always a multiple of four)
+template <typename T, typename SparseT>
+void check_spmm(const SparseT &a, unsigned seed) {
+  const Matrix<T> dense = a.to_dense();
+  for (size_t n : {1, 2, 7, 33}) {
+    SCOPED_TRACE("n = " + std::to_string(n));
+    Matrix<T> b = random_matrix<T>(a.cols(), n, seed++);
+    Matrix<T> expected = matmul(dense, b, MatMulImpl::CPP_NAIVE);
+    double epsilon = double(verify_epsilon<T>(a.cols()));
+    expect_matrix_near(expected, spmm(a, b), epsilon);
+
+    Matrix<T> reference(a.rows(), n);
+    spmm_cpp_naive(a, b, reference);
+    expect_matrix_near(expected, reference, epsilon);
+  }
+}
+
+} // namespace
+
+TEST(CsrTest, RoundTripsDense) {
+  Matrix<float> dense = random_sparse<float>(9, 13, 1);
+  CsrMatrix<float> csr = CsrMatrix<float>::from_dense(dense);
+  EXPECT_EQ(csr.rows(), 9u);
+  EXPECT_EQ(csr.cols(), 13u);
+  EXPECT_EQ(csr.row_ptr()[1], 0); // empty first row
+  expect_matrix_near(dense, csr.to_dense());
+}
+
+TEST(CsrTest, FloatSpmmAndSpmv) {
+  for (size_t k : {1, 10, 64})
+    check_spmm<float>(CsrMatrix<float>::from_dense(random_sparse<float>(17, k, 2)),
+                      10);
+}
+
+TEST(CsrTest, Int8SpmmAndSpmv) {
+  for (size_t k : {1, 10, 64})
+    check_spmm<int8_t>(
+        CsrMatrix<int8_t>::from_dense(random_sparse<int8_t>(17, k, 3)), 20);
+}
+
+TEST(CsrTest, AllZeroAndEmpty) {
+  check_spmm<float>(CsrMatrix<float>::from_dense(Matrix<float>(6, 8)), 30);
+  check_spmm<float>(CsrMatrix<float>::from_dense(Matrix<float>(0, 8)), 40);
+}
+
+TEST(Sparse24Test, PruneKeepsTwoLargestPerGroup) {
+  Matrix<float> dense(1, 6, {1, -4, 3, 2, 0, 5});
+  Sparse24Matrix<float> s = Sparse24Matrix<float>::prune(dense);
+  expect_matrix_near(Matrix<float>(1, 6, {0, -4, 3, 0, 0, 5}), s.to_dense());
+  EXPECT_EQ(s.nnz(), 3u);
+}
+
+TEST(Sparse24Test, FromDenseRejectsDenseGroups) {
+  Matrix<float> dense(1, 4, {1, 2, 3, 0});
+  EXPECT_THROW(Sparse24Matrix<float>::from_dense(dense),
+               std::invalid_argument);
+}
+
+TEST(Sparse24Test, FloatSpmmAndSpmv) {
+  for (size_t k : {1, 10, 64})
+    check_spmm<float>(
+        Sparse24Matrix<float>::prune(random_matrix<float>(17, k, 4)), 50);
+}
+
+TEST(Sparse24Test, Int8SpmmAndSpmv) {
+  for (size_t k : {1, 10, 64})
+    check_spmm<int8_t>(
+        Sparse24Matrix<int8_t>::prune(random_matrix<int8_t>(17, k, 5)), 60);
+}
+
+TEST(Sparse24Test, EmptyRows) {
+  Matrix<float> dense = random_sparse<float>(8, 12, 6);
+  check_spmm<float>(Sparse24Matrix<float>::prune(dense), 70);
+}
+
+TEST(SparseTest, ShapeMismatchThrows) {
+  CsrMatrix<float> a = CsrMatrix<float>::from_dense(Matrix<float>(3, 4));
+  Matrix<float> b(5, 2);
+  EXPECT_THROW(spmm(a, b), std::invalid_argument);
+}
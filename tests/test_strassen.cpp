@@ -0,0 +1,40 @@
+#include "bench.h"
+#include "matmul.h"
+#include "strassen.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <string>
+
+// Strassen with a small cutoff, so odd sizes recurse several levels
+template <typename T> void check_strassen(int m, int k, int n, int cutoff) {
+  SCOPED_TRACE(std::to_string(m) + "x" + std::to_string(n) + "x" +
+               std::to_string(k));
+  TuneParams params;
+  params.cutoff = cutoff;
+  Matrix<T> a = random_matrix<T>(m, k, unsigned(m + k));
+  Matrix<T> b = random_matrix<T>(k, n, unsigned(k + n));
+  Matrix<T> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+  Matrix<T> actual(m, n);
+  matmul_strassen(a.data(), b.data(), actual.data(), m, k, n, params);
+  double epsilon = double(verify_epsilon<T>(k)) *
+                   double(1 << strassen_depth(m, k, n, cutoff));
+  expect_matrix_near(expected, actual, epsilon);
+}
+
+TEST(StrassenTest, OddSizesFloat) {
+  check_strassen<float>(65, 67, 63, 8);
+  check_strassen<float>(33, 17, 45, 4);
+  check_strassen<float>(31, 31, 31, 2);
+}
+
+TEST(StrassenTest, OddSizesInt) {
+  check_strassen<int16_t>(65, 67, 63, 8);
+  check_strassen<int32_t>(31, 29, 33, 4);
+  check_strassen<int8_t>(47, 49, 45, 8);
+}
+
+TEST(StrassenTest, BelowCutoffAndEmpty) {
+  check_strassen<float>(16, 16, 16, 64);
+  check_strassen<float>(1, 40, 40, 8);
+  check_strassen<float>(5, 0, 7, 8);
+}
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "matmul.h"
+#include "packed.h"
+#include "streaming.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Reader handing out the rows of a, at most max_rows at a time
+template <typename T> auto matrix_reader(const Matrix<T> &a) {
+  return [&a, next = size_t(0)](T *rows, size_t max_rows) mutable {
+    size_t count = std::min(max_rows, a.rows() - next);
+    for (size_t i = 0; i < count; ++i, ++next)
+      std::copy(&a.at(next, 0), &a.at(next, 0) + a.cols(),
+                rows + i * a.cols());
+    return count;
+  };
+}
+
+// Sink copying rows of C into c
+template <typename T> auto matrix_sink(Matrix<T> &c) {
+  return [&c](const T *rows, size_t first_row, size_t num_rows) {
+    for (size_t i = 0; i < num_rows; ++i)
+      std::copy(rows + i * c.cols(), rows + (i + 1) * c.cols(),
+                &c.at(first_row + i, 0));
+  };
+}
+
+} // namespace
+
+// matmul_stream with chunks smaller than A, B plain and prepacked
+template <typename T> void check_stream(size_t m, size_t chunk_rows) {
+  SCOPED_TRACE("m = " + std::to_string(m) +
+               ", chunk = " + std::to_string(chunk_rows));
+  const size_t k = 23, n = 17;
+  Matrix<T> a = random_matrix<T>(m, k, unsigned(m + 1));
+  Matrix<T> b = random_matrix<T>(k, n, unsigned(m + 2));
+  Matrix<T> expected = matmul(a, b, MatMulImpl::CPP_NAIVE);
+  const double epsilon = double(verify_epsilon<T>(k));
+
+  StreamOptions options;
+  options.chunk_rows = chunk_rows;
+  Matrix<T> c(m, n);
+  StreamStats stats =
+      matmul_stream(b, matrix_reader(a), matrix_sink(c), options);
+  EXPECT_EQ(stats.rows, m);
+  expect_matrix_near(expected, c, epsilon);
+
+  Matrix<T> c_packed(m, n);
+  matmul_stream(PackedMatrix<T>(b), matrix_reader(a), matrix_sink(c_packed),
+                options);
+  expect_matrix_near(expected, c_packed, epsilon);
+}
+
+TEST(StreamTest, MatchesNaive) {
+  for (size_t m : {0, 1, 7, 8, 100})
+    for (size_t chunk : {1, 8, 30, 1024}) {
+      check_stream<float>(m, chunk);
+      check_stream<int8_t>(m, chunk);
+    }
+}
+
+TEST(StreamTest, ZeroDepthThrows) {
+  Matrix<float> b(0, 4);
+  auto read = [](float *, size_t) { return size_t(0); };
+  auto sink = [](const float *, size_t, size_t) {};
+  EXPECT_THROW(matmul_stream(b, read, sink), std::invalid_argument);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "matrix.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+
+// Matrix of NumericTraits<T> random values from a fixed seed
+template <typename T>
+Matrix<T> random_matrix(size_t rows, size_t cols, unsigned seed) {
+  Matrix<T> m(rows, cols);
+  std::mt19937 gen(seed);
+  const T min = NumericTraits<T>::random_min();
+  const T max = NumericTraits<T>::random_max();
+  if constexpr (std::is_integral_v<T>) {
+    std::uniform_int_distribution<int> dist(min, max);
+    for (size_t i = 0; i < rows; ++i)
+      for (size_t j = 0; j < cols; ++j)
+        m.at(i, j) = static_cast<T>(dist(gen));
+  } else {
+    std::uniform_real_distribution<float> dist(static_cast<float>(min),
+                                               static_cast<float>(max));
+    for (size_t i = 0; i < rows; ++i)
+      for (size_t j = 0; j < cols; ++j)
+        m.at(i, j) = static_cast<T>(dist(gen));
+  }
+  return m;
+}
+
+// Float tolerance against the naive product for sums of k products of values
+// in [-1, 1] taken in another order (integer results are compared exactly)
+inline double sum_epsilon(size_t k) {
+  return 1e-5 * std::max(1.0, std::sqrt(double(k)));
+}
+
+// Element-wise check of a result against the reference, within epsilon for
+// floating types and exactly for integers
+template <typename T>
+void expect_matrix_near(const Matrix<T> &expected, const Matrix<T> &actual,
+                        double epsilon = 0.0) {
+  ASSERT_EQ(expected.rows(), actual.rows());
+  ASSERT_EQ(expected.cols(), actual.cols());
+  for (size_t i = 0; i < expected.rows(); ++i)
+    for (size_t j = 0; j < expected.cols(); ++j) {
+      if constexpr (std::is_integral_v<T>)
+        ASSERT_EQ(expected.at(i, j), actual.at(i, j))
+            << "at (" << i << ", " << j << ")";
+      else
+        ASSERT_NEAR(double(expected.at(i, j)), double(actual.at(i, j)),
+                    epsilon)
+            << "at (" << i << ", " << j << ")";
+    }
+}
+
+// File in the temporary directory, removed when the test ends
+class TempFile {
+public:
+  explicit TempFile(const std::string &name)
+      : path_((std::filesystem::temp_directory_path() /
+               ("matmul_test_" + std::to_string(::getpid()) + "_" + name))
+                  .string()) {}
+  ~TempFile() { std::remove(path_.c_str()); }
+  const std::string &path() const { return path_; }
+
+private:
+  std::string path_;
+};